@@ -0,0 +1,1046 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "constants.h"
+#include "astrolib.h"
+#include "star.h"
+#include "starbatch.h"
+#include "faststar.h"
+#include "pipeline.h"
+#include "starfield.h"
+#include "psffit.h"
+#include "photometry.h"
+#include "detection.h"
+#include "magnitudesum.h"
+#include "skyindex.h"
+#include "crossmatch.h"
+#include "epoch.h"
+#include "hrdiagram.h"
+#include "derivedcache.h"
+#include "spectrumdictionary.h"
+
+/**
+ * uniformly distributed inputs in [lo, hi]
+ */
+static std::vector<double> uniform(double lo, double hi, std::size_t n = 4096, std::uint64_t seed = 42)
+{
+    std::mt19937_64 random(seed);
+    std::uniform_real_distribution<double> distribution(lo, hi);
+    std::vector<double> values(n);
+    for (double& value : values) {
+        value = distribution(random);
+    }
+    return values;
+}
+
+/**
+ * Measures throughput of f over inputs and reports max error against exact as counter
+ */
+template <class F, class Exact>
+static void run(benchmark::State& state, const std::vector<double>& inputs, F f, Exact exact, bool relative)
+{
+    for (auto _ : state) {
+        for (const double x : inputs) {
+            benchmark::DoNotOptimize(f(x));
+        }
+    }
+    double error = 0.0;
+    for (const double x : inputs) {
+        const double diff = std::fabs(f(x) - exact(x));
+        error             = std::fmax(error, relative ? diff / std::fabs(exact(x)) : diff);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * inputs.size()));
+    state.counters["max_error"] = error;
+}
+
+template <class Policy>
+static void BM_FastStar_colorTemperature(benchmark::State& state)
+{
+    run(
+            state, uniform(-0.4, 2.0), [](double bv) { return FastStar<Policy>::colorTemperature(bv, 8); },
+            [](double bv) { return Star::colorTemperature(bv, 8); }, true);
+}
+
+template <class Policy>
+static void BM_FastStar_bolometricCorrection(benchmark::State& state)
+{
+    run(state, uniform(2000, 100000), FastStar<Policy>::bolometricCorrection, Star::bolometricCorrection, false);
+}
+
+template <class Policy>
+static void BM_FastStar_brightnessRatio(benchmark::State& state)
+{
+    run(state, uniform(-30, 30), FastStar<Policy>::brightnessRatio, Star::brightnessRatio, true);
+}
+
+BENCHMARK_TEMPLATE(BM_FastStar_colorTemperature, ExactPolicy);
+BENCHMARK_TEMPLATE(BM_FastStar_colorTemperature, PrecisePolicy);
+BENCHMARK_TEMPLATE(BM_FastStar_colorTemperature, FastPolicy);
+BENCHMARK_TEMPLATE(BM_FastStar_bolometricCorrection, ExactPolicy);
+BENCHMARK_TEMPLATE(BM_FastStar_bolometricCorrection, PrecisePolicy);
+BENCHMARK_TEMPLATE(BM_FastStar_bolometricCorrection, FastPolicy);
+BENCHMARK_TEMPLATE(BM_FastStar_brightnessRatio, ExactPolicy);
+BENCHMARK_TEMPLATE(BM_FastStar_brightnessRatio, PrecisePolicy);
+BENCHMARK_TEMPLATE(BM_FastStar_brightnessRatio, FastPolicy);
+
+/**
+ * spectral class strings in the forms found in real catalogs
+ */
+static std::vector<std::string> spectra(std::size_t n = 4096)
+{
+    static const char* samples[] = {"G2V",   "K0III",  "M4.5Ve", "B1Ia0",  "A0V",      "F5IV-V", "K3II-III",
+                                    "O9.5Iab", "WC7",  "DA2",    "sdB",    "gK0",      "C5,4",   "M1.5IIIb",
+                                    "A1mA5-F0", "B9.5V", "K2",   "G8III/IV", "kA2hA5mA7V", "S4/2e"};
+    std::mt19937_64 random(42);
+    std::vector<std::string> values(n);
+    for (std::string& value : values) {
+        value = samples[random() % (sizeof(samples) / sizeof(samples[0]))];
+    }
+    return values;
+}
+
+static void BM_Star_parseSpectrum(benchmark::State& state)
+{
+    const std::vector<std::string> inputs = spectra();
+    int spectype, lumclass;
+    for (auto _ : state) {
+        for (const std::string& spectrum : inputs) {
+            benchmark::DoNotOptimize(Star::parseSpectrum(spectrum, spectype, lumclass));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * inputs.size()));
+}
+BENCHMARK(BM_Star_parseSpectrum);
+
+static void BM_StarBatch_parseSpectrum(benchmark::State& state)
+{
+    const std::vector<std::string> inputs = spectra();
+    const std::vector<std::string_view> views(inputs.begin(), inputs.end());
+    std::vector<int> spectype(views.size()), lumclass(views.size());
+    for (auto _ : state) {
+        StarBatch::parseSpectrum(views.data(), spectype.data(), lumclass.data(), views.size());
+        benchmark::DoNotOptimize(spectype.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * views.size()));
+}
+BENCHMARK(BM_StarBatch_parseSpectrum);
+
+/**
+ * Spectra of a million rows looked up in a shared dictionary by as many threads as the benchmark argument
+ */
+static void BM_SpectrumDictionary_Intern(benchmark::State& state)
+{
+    const std::vector<std::string> inputs = spectra(1 << 20);
+    SpectrumDictionary dictionary;
+    std::vector<SpectrumDictionary::Id> ids(inputs.size());
+    ThreadPool pool(static_cast<unsigned>(state.range(0)));
+    for (auto _ : state) {
+        pool.ParallelFor(0, inputs.size(), 16384, [&](const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                ids[i] = dictionary.Intern(inputs[i]);
+            }
+        });
+        benchmark::DoNotOptimize(ids.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * inputs.size()));
+}
+BENCHMARK(BM_SpectrumDictionary_Intern)->RangeMultiplier(2)->Range(1, 64)->UseRealTime();
+
+/**
+ * Stars with interned spectra moved into catalog columns and back, spectral codes come from the dictionary
+ */
+static void BM_StarCatalog_GatherScatter(benchmark::State& state)
+{
+    const std::vector<std::string> inputs = spectra();
+    std::vector<Star> stars(inputs.size());
+    for (std::size_t i = 0; i < stars.size(); i++) {
+        stars[i].SetSpectrum(inputs[i]);
+    }
+    StarCatalog catalog;
+    for (auto _ : state) {
+        catalog.Clear();
+        catalog.Gather(stars);
+        catalog.Scatter(stars);
+        benchmark::DoNotOptimize(stars.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * stars.size()));
+}
+BENCHMARK(BM_StarCatalog_GatherScatter);
+
+/**
+ * Inputs in the ranges of real catalogs: B-V colors, apparent and absolute magnitudes, distances spread over
+ * decades, temperatures, luminosity classes of catalog spectra and Moffat profiles of CCD star images
+ */
+struct Inputs
+{
+    static constexpr std::size_t SIZE = 4096;
+
+    std::vector<double> bmv      = uniform(-0.4, 2.0, SIZE, 1);
+    std::vector<double> appMag   = uniform(-1.5, 16.0, SIZE, 2);
+    std::vector<double> absMag   = uniform(-8.0, 16.0, SIZE, 3);
+    std::vector<double> distance = uniform(0.1, 4.0, SIZE, 4);
+    std::vector<double> magDiff  = uniform(-30.0, 30.0, SIZE, 5);
+    std::vector<double> ratio    = uniform(-12.0, 12.0, SIZE, 6);
+    std::vector<double> temp     = uniform(2000.0, 50000.0, SIZE, 7);
+    std::vector<double> bc       = uniform(-4.5, 0.0, SIZE, 8);
+    std::vector<double> lum      = uniform(-4.0, 6.0, SIZE, 9);
+    std::vector<double> peak     = uniform(100.0, 60000.0, SIZE, 10);
+    std::vector<double> r2       = uniform(0.0, 100.0, SIZE, 11);
+    std::vector<double> beta     = uniform(1.5, 4.5, SIZE, 12);
+    std::vector<double> level    = uniform(0.01, 0.99, SIZE, 13);
+    std::vector<double> ra1      = uniform(0.0, 360.0, SIZE, 14);
+    std::vector<double> dec1     = uniform(-1.0, 1.0, SIZE, 15);
+    std::vector<double> ra2      = uniform(0.0, 360.0, SIZE, 16);
+    std::vector<double> dec2     = uniform(-1.0, 1.0, SIZE, 17);
+    std::vector<double> celsius  = uniform(-273.15, 6000.0, SIZE, 18);
+    std::vector<double> area     = uniform(0.01, 100.0, SIZE, 19);
+    std::vector<std::string> spectrum = spectra(SIZE);
+    std::vector<std::string_view> view{spectrum.begin(), spectrum.end()};
+    std::vector<int> spectype = std::vector<int>(SIZE);
+    std::vector<int> lumclass = std::vector<int>(SIZE);
+
+    Inputs()
+    {
+        // distances, brightness ratios and luminosities span decades, declinations are uniform on the sphere
+        for (std::size_t i = 0; i < SIZE; i++) {
+            distance[i] = std::pow(10.0, distance[i]);
+            ratio[i]    = std::pow(10.0, ratio[i]);
+            lum[i]      = std::pow(10.0, lum[i]);
+            level[i]    = level[i] * peak[i];
+            dec1[i]     = std::asin(dec1[i]) * 180.0 / PI_NUMBER;
+            dec2[i]     = std::asin(dec2[i]) * 180.0 / PI_NUMBER;
+            Star::parseSpectrum(view[i], spectype[i], lumclass[i]);
+        }
+    }
+};
+
+static const Inputs& inputs()
+{
+    static const Inputs instance;
+    return instance;
+}
+
+/**
+ * Measures throughput of scalar f(i) over all inputs
+ */
+template <class F>
+static void loop(benchmark::State& state, F f)
+{
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < Inputs::SIZE; i++) {
+            benchmark::DoNotOptimize(f(i));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * Inputs::SIZE));
+}
+
+/**
+ * Measures throughput of batch call f over all inputs
+ */
+template <class F>
+static void batch(benchmark::State& state, F f)
+{
+    for (auto _ : state) {
+        f(Inputs::SIZE);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * Inputs::SIZE));
+}
+
+static void BM_Star_Luminosity(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<Star> stars(Inputs::SIZE);
+    for (std::size_t i = 0; i < Inputs::SIZE; i++) {
+        stars[i].SetRadius(in.r2[i] + 0.01);
+        stars[i].SetPhotosphereTemperature(in.temp[i]);
+    }
+    loop(state, [&stars](std::size_t i) { return stars[i].Luminosity(); });
+}
+BENCHMARK(BM_Star_Luminosity);
+
+static void BM_Star_bmv2rgb(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) {
+        double r, g, b;
+        Star::bmv2rgb(in.bmv[i], r, g, b);
+        return r + g + b;
+    });
+}
+BENCHMARK(BM_Star_bmv2rgb);
+
+static void BM_Star_bmv2temp(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::bmv2temp(in.bmv[i]); });
+}
+BENCHMARK(BM_Star_bmv2temp);
+
+static void BM_Star_absoluteMagnitude(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::absoluteMagnitude(in.appMag[i], in.distance[i]); });
+}
+BENCHMARK(BM_Star_absoluteMagnitude);
+
+static void BM_Star_apparentMagnitude(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::apparentMagnitude(in.absMag[i], in.distance[i]); });
+}
+BENCHMARK(BM_Star_apparentMagnitude);
+
+static void BM_Star_distanceFromMagnitude(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::distanceFromMagnitude(in.appMag[i], in.absMag[i]); });
+}
+BENCHMARK(BM_Star_distanceFromMagnitude);
+
+static void BM_Star_brightnessRatio(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::brightnessRatio(in.magDiff[i]); });
+}
+BENCHMARK(BM_Star_brightnessRatio);
+
+static void BM_Star_magnitudeDifference(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::magnitudeDifference(in.ratio[i]); });
+}
+BENCHMARK(BM_Star_magnitudeDifference);
+
+static void BM_Star_magnitudeSum(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::magnitudeSum(in.appMag[i], in.absMag[i]); });
+}
+BENCHMARK(BM_Star_magnitudeSum);
+
+static void BM_Star_moffatFunction(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::moffatFunction(in.peak[i], in.r2[i], in.beta[i]); });
+}
+BENCHMARK(BM_Star_moffatFunction);
+
+static void BM_Star_moffatRadius(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::moffatRadius(in.level[i], in.peak[i], in.beta[i]); });
+}
+BENCHMARK(BM_Star_moffatRadius);
+
+static void BM_Star_angularDistance(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::angularDistance(in.ra1[i], in.dec1[i], in.ra2[i], in.dec2[i]); });
+}
+BENCHMARK(BM_Star_angularDistance);
+
+static void BM_Star_spectralType(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::spectralType(in.view[i]); });
+}
+BENCHMARK(BM_Star_spectralType);
+
+static void BM_Star_luminosityClass(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::luminosityClass(in.view[i]); });
+}
+BENCHMARK(BM_Star_luminosityClass);
+
+static void BM_Star_formatSpectrum(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::formatSpectrum(in.spectype[i], in.lumclass[i]); });
+}
+BENCHMARK(BM_Star_formatSpectrum);
+
+static void BM_Star_bolometricCorrection(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::bolometricCorrection(in.temp[i]); });
+}
+BENCHMARK(BM_Star_bolometricCorrection);
+
+static void BM_Star_colorTemperature(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::colorTemperature(in.bmv[i], in.lumclass[i]); });
+}
+BENCHMARK(BM_Star_colorTemperature);
+
+static void BM_Star_luminosity(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::luminosity(in.absMag[i], in.bc[i]); });
+}
+BENCHMARK(BM_Star_luminosity);
+
+static void BM_Star_radius(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Star::radius(in.lum[i], in.temp[i]); });
+}
+BENCHMARK(BM_Star_radius);
+
+static void BM_CelsiusToKelvin(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return CelsiusToKelvin(in.celsius[i]); });
+}
+BENCHMARK(BM_CelsiusToKelvin);
+
+static void BM_KelvinToCelsius(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return KelvinToCelsius(in.temp[i]); });
+}
+BENCHMARK(BM_KelvinToCelsius);
+
+static void BM_Illumination(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    loop(state, [&in](std::size_t i) { return Illumination(in.peak[i], in.area[i]); });
+}
+BENCHMARK(BM_Illumination);
+
+static void BM_StarBatch_Luminosity(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<double> out(Inputs::SIZE);
+    batch(state, [&](std::size_t n) { StarBatch::Luminosity(in.r2.data(), in.temp.data(), out.data(), n); });
+}
+BENCHMARK(BM_StarBatch_Luminosity);
+
+static void BM_StarBatch_bmv2rgb(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<double> r(Inputs::SIZE), g(Inputs::SIZE), b(Inputs::SIZE);
+    batch(state, [&](std::size_t n) { StarBatch::bmv2rgb(in.bmv.data(), r.data(), g.data(), b.data(), n); });
+}
+BENCHMARK(BM_StarBatch_bmv2rgb);
+
+static void BM_StarBatch_bmv2rgb_Interleaved(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<double> rgb(3 * Inputs::SIZE);
+    batch(state, [&](std::size_t n) { StarBatch::bmv2rgb(in.bmv.data(), rgb.data(), n); });
+}
+BENCHMARK(BM_StarBatch_bmv2rgb_Interleaved);
+
+static void BM_StarBatch_bmv2rgb_Float(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<float> rgb(3 * Inputs::SIZE);
+    batch(state, [&](std::size_t n) { StarBatch::bmv2rgb(in.bmv.data(), rgb.data(), n); });
+}
+BENCHMARK(BM_StarBatch_bmv2rgb_Float);
+
+static void BM_StarBatch_absoluteMagnitude(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<double> out(Inputs::SIZE);
+    batch(state, [&](std::size_t n) {
+        StarBatch::absoluteMagnitude(in.appMag.data(), in.distance.data(), out.data(), n);
+    });
+}
+BENCHMARK(BM_StarBatch_absoluteMagnitude);
+
+static void BM_StarBatch_apparentMagnitude(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<double> out(Inputs::SIZE);
+    batch(state, [&](std::size_t n) {
+        StarBatch::apparentMagnitude(in.absMag.data(), in.distance.data(), out.data(), n);
+    });
+}
+BENCHMARK(BM_StarBatch_apparentMagnitude);
+
+static void BM_StarBatch_distanceFromMagnitude(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<double> out(Inputs::SIZE);
+    batch(state, [&](std::size_t n) {
+        StarBatch::distanceFromMagnitude(in.appMag.data(), in.absMag.data(), out.data(), n);
+    });
+}
+BENCHMARK(BM_StarBatch_distanceFromMagnitude);
+
+static void BM_StarBatch_brightnessRatio(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<double> out(Inputs::SIZE);
+    batch(state, [&](std::size_t n) { StarBatch::brightnessRatio(in.magDiff.data(), out.data(), n); });
+}
+BENCHMARK(BM_StarBatch_brightnessRatio);
+
+static void BM_StarBatch_magnitudeDifference(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<double> out(Inputs::SIZE);
+    batch(state, [&](std::size_t n) { StarBatch::magnitudeDifference(in.ratio.data(), out.data(), n); });
+}
+BENCHMARK(BM_StarBatch_magnitudeDifference);
+
+static void BM_StarBatch_colorTemperature(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<double> out(Inputs::SIZE);
+    batch(state, [&](std::size_t n) { StarBatch::colorTemperature(in.bmv.data(), in.lumclass.data(), out.data(), n); });
+}
+BENCHMARK(BM_StarBatch_colorTemperature);
+
+static void BM_StarBatch_bolometricCorrection(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<double> out(Inputs::SIZE);
+    batch(state, [&](std::size_t n) { StarBatch::bolometricCorrection(in.temp.data(), out.data(), n); });
+}
+BENCHMARK(BM_StarBatch_bolometricCorrection);
+
+static void BM_StarBatch_luminosity(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<double> out(Inputs::SIZE);
+    batch(state, [&](std::size_t n) { StarBatch::luminosity(in.absMag.data(), in.bc.data(), out.data(), n); });
+}
+BENCHMARK(BM_StarBatch_luminosity);
+
+static void BM_StarBatch_radius(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<double> out(Inputs::SIZE);
+    batch(state, [&](std::size_t n) { StarBatch::radius(in.lum.data(), in.temp.data(), out.data(), n); });
+}
+BENCHMARK(BM_StarBatch_radius);
+
+/**
+ * Measures batch call f on the instruction set level of the benchmark argument, skipped if the CPU lacks it
+ */
+template <class F>
+static void isaBatch(benchmark::State& state, F f)
+{
+    const StarBatch::Isa initial = StarBatch::isa();
+    const auto wanted            = static_cast<StarBatch::Isa>(state.range(0));
+    if (StarBatch::setIsa(wanted) != wanted) {
+        state.SkipWithError("instruction set not supported");
+    } else {
+        state.SetLabel(StarBatch::isaName(wanted));
+        batch(state, f);
+    }
+    StarBatch::setIsa(initial);
+}
+
+static void BM_StarBatch_Isa_bmv2rgb(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<double> r(Inputs::SIZE), g(Inputs::SIZE), b(Inputs::SIZE);
+    isaBatch(state, [&](std::size_t n) { StarBatch::bmv2rgb(in.bmv.data(), r.data(), g.data(), b.data(), n); });
+}
+BENCHMARK(BM_StarBatch_Isa_bmv2rgb)->DenseRange(StarBatch::Scalar, StarBatch::AVX512);
+
+static void BM_StarBatch_Isa_colorTemperature(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<double> out(Inputs::SIZE);
+    isaBatch(state,
+             [&](std::size_t n) { StarBatch::colorTemperature(in.bmv.data(), in.lumclass.data(), out.data(), n); });
+}
+BENCHMARK(BM_StarBatch_Isa_colorTemperature)->DenseRange(StarBatch::Scalar, StarBatch::AVX512);
+
+static void BM_StarBatch_Isa_bolometricCorrection(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<double> out(Inputs::SIZE);
+    isaBatch(state, [&](std::size_t n) { StarBatch::bolometricCorrection(in.temp.data(), out.data(), n); });
+}
+BENCHMARK(BM_StarBatch_Isa_bolometricCorrection)->DenseRange(StarBatch::Scalar, StarBatch::AVX512);
+
+static void BM_StarBatch_Isa_brightnessRatio(benchmark::State& state)
+{
+    const Inputs& in = inputs();
+    std::vector<double> out(Inputs::SIZE);
+    isaBatch(state, [&](std::size_t n) { StarBatch::brightnessRatio(in.magDiff.data(), out.data(), n); });
+}
+BENCHMARK(BM_StarBatch_Isa_brightnessRatio)->DenseRange(StarBatch::Scalar, StarBatch::AVX512);
+
+/**
+ * Inputs rounded to float, for the single precision batch functions
+ */
+struct SingleInputs
+{
+    std::vector<float> bmv, appMag, absMag, distance, magDiff, ratio, temp, bc;
+
+    SingleInputs()
+    {
+        const Inputs& in = inputs();
+        const auto single = [](const std::vector<double>& column) {
+            return std::vector<float>(column.begin(), column.end());
+        };
+        bmv      = single(in.bmv);
+        appMag   = single(in.appMag);
+        absMag   = single(in.absMag);
+        distance = single(in.distance);
+        magDiff  = single(in.magDiff);
+        ratio    = single(in.ratio);
+        temp     = single(in.temp);
+        bc       = single(in.bc);
+    }
+};
+
+static const SingleInputs& singleInputs()
+{
+    static const SingleInputs instance;
+    return instance;
+}
+
+static void BM_StarBatch_bmv2rgb_Single(benchmark::State& state)
+{
+    const SingleInputs& in = singleInputs();
+    std::vector<float> r(Inputs::SIZE), g(Inputs::SIZE), b(Inputs::SIZE);
+    batch(state, [&](std::size_t n) { StarBatch::bmv2rgb(in.bmv.data(), r.data(), g.data(), b.data(), n); });
+}
+BENCHMARK(BM_StarBatch_bmv2rgb_Single);
+
+static void BM_StarBatch_absoluteMagnitude_Single(benchmark::State& state)
+{
+    const SingleInputs& in = singleInputs();
+    std::vector<float> out(Inputs::SIZE);
+    batch(state, [&](std::size_t n) {
+        StarBatch::absoluteMagnitude(in.appMag.data(), in.distance.data(), out.data(), n);
+    });
+}
+BENCHMARK(BM_StarBatch_absoluteMagnitude_Single);
+
+static void BM_StarBatch_magnitudeDifference_Single(benchmark::State& state)
+{
+    const SingleInputs& in = singleInputs();
+    std::vector<float> out(Inputs::SIZE);
+    batch(state, [&](std::size_t n) { StarBatch::magnitudeDifference(in.ratio.data(), out.data(), n); });
+}
+BENCHMARK(BM_StarBatch_magnitudeDifference_Single);
+
+static void BM_StarBatch_colorTemperature_Single(benchmark::State& state)
+{
+    const SingleInputs& in = singleInputs();
+    const Inputs& lum      = inputs();
+    std::vector<float> out(Inputs::SIZE);
+    batch(state, [&](std::size_t n) {
+        StarBatch::colorTemperature(in.bmv.data(), lum.lumclass.data(), out.data(), n);
+    });
+}
+BENCHMARK(BM_StarBatch_colorTemperature_Single);
+
+static void BM_StarBatch_bolometricCorrection_Single(benchmark::State& state)
+{
+    const SingleInputs& in = singleInputs();
+    std::vector<float> out(Inputs::SIZE);
+    batch(state, [&](std::size_t n) { StarBatch::bolometricCorrection(in.temp.data(), out.data(), n); });
+}
+BENCHMARK(BM_StarBatch_bolometricCorrection_Single);
+
+static void BM_StarBatch_luminosity_Single(benchmark::State& state)
+{
+    const SingleInputs& in = singleInputs();
+    std::vector<float> out(Inputs::SIZE);
+    batch(state, [&](std::size_t n) { StarBatch::luminosity(in.absMag.data(), in.bc.data(), out.data(), n); });
+}
+BENCHMARK(BM_StarBatch_luminosity_Single);
+
+static void BM_StarBatch_Isa_brightnessRatio_Single(benchmark::State& state)
+{
+    const SingleInputs& in = singleInputs();
+    std::vector<float> out(Inputs::SIZE);
+    isaBatch(state, [&](std::size_t n) { StarBatch::brightnessRatio(in.magDiff.data(), out.data(), n); });
+}
+BENCHMARK(BM_StarBatch_Isa_brightnessRatio_Single)->DenseRange(StarBatch::Scalar, StarBatch::AVX512);
+
+/**
+ * catalog with realistic magnitudes, colors, parallaxes and luminosity classes
+ */
+static StarCatalog catalog(std::size_t n)
+{
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> magnitude(-1.0, 15.0), color(-0.3, 1.9), parallax(0.0005, 0.2);
+    StarCatalog stars(n);
+    for (std::size_t i = 0; i < n; i++) {
+        stars.Vmagnitude()[i]      = magnitude(random);
+        stars.Bmagnitude()[i]      = stars.Vmagnitude()[i] + color(random);
+        stars.Parallax()[i]        = parallax(random);
+        stars.LuminosityClass()[i] = static_cast<int>(random() % 10) + 1;
+    }
+    return stars;
+}
+
+static void BM_StarPipeline(benchmark::State& state)
+{
+    const StarCatalog stars = catalog(1 << 20);
+    std::vector<double> lum(stars.Size()), radius(stars.Size());
+    DerivedColumns out;
+    out.luminosity = lum.data();
+    out.radius     = radius.data();
+
+    ThreadPool pool(static_cast<unsigned>(state.range(0)));
+    const StarPipeline pipeline(pool);
+    for (auto _ : state) {
+        pipeline.Run(stars, out);
+        benchmark::DoNotOptimize(radius.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * stars.Size()));
+}
+BENCHMARK(BM_StarPipeline)->RangeMultiplier(2)->Range(1, 64)->UseRealTime();
+
+static void BM_StarFieldRenderer(benchmark::State& state)
+{
+    const std::size_t width = 4096, height = 4096, n = 100000;
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<FieldStar> stars(n);
+    for (FieldStar& star : stars) {
+        star.x    = width * unit(random);
+        star.y    = height * unit(random);
+        star.peak = 10.0 * std::pow(1000.0, unit(random));
+        star.beta = 2.0 + 2.0 * unit(random);
+        star.bmv  = -0.4 + 2.4 * unit(random);
+    }
+
+    std::vector<float> image(width * height);
+    ThreadPool pool(static_cast<unsigned>(state.range(0)));
+    const StarFieldRenderer renderer(width, height, 1.0, pool);
+    for (auto _ : state) {
+        renderer.Render(stars.data(), n, image.data());
+        benchmark::DoNotOptimize(image.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+BENCHMARK(BM_StarFieldRenderer)->RangeMultiplier(2)->Range(1, 64)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_MoffatFitter(benchmark::State& state)
+{
+    const std::size_t width = 15, height = 15, n = 4096, pixels = width * height;
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::vector<float> cutouts(n * pixels);
+    for (std::size_t i = 0; i < n; i++) {
+        const double x = 6.0 + 2.0 * unit(random), y = 6.0 + 2.0 * unit(random), peak = 100.0 + 1000.0 * unit(random);
+        const double alpha = 1.5 + unit(random), beta = 2.0 + unit(random);
+        for (std::size_t k = 0; k < pixels; k++) {
+            const double dx = k % width - x, dy = k / width - y;
+            cutouts[i * pixels + k] = static_cast<float>(
+                    20.0 + noise(random) + Star::moffatFunction(peak, (dx * dx + dy * dy) / (alpha * alpha), beta));
+        }
+    }
+
+    std::vector<MoffatFit> fits(n);
+    ThreadPool pool(static_cast<unsigned>(state.range(0)));
+    const MoffatFitter fitter(50, 1e-8, pool);
+    for (auto _ : state) {
+        fitter.Fit(cutouts.data(), width, height, n, nullptr, fits.data());
+        benchmark::DoNotOptimize(fits.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+BENCHMARK(BM_MoffatFitter)->RangeMultiplier(2)->Range(1, 64)->UseRealTime();
+
+static void BM_AperturePhotometry(benchmark::State& state)
+{
+    const std::size_t width = 4096, height = 4096, n = 20000;
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<float> image(width * height);
+    for (float& pixel : image) {
+        pixel = static_cast<float>(100.0 + 10.0 * unit(random));
+    }
+    std::vector<double> x(n), y(n);
+    for (std::size_t i = 0; i < n; i++) {
+        x[i] = width * unit(random);
+        y[i] = height * unit(random);
+    }
+
+    std::vector<ApertureMeasurement> out(n);
+    ThreadPool pool(static_cast<unsigned>(state.range(0)));
+    const AperturePhotometry photometry(6.0, 10.0, 15.0, 25.0, 3.0, 5, pool);
+    for (auto _ : state) {
+        photometry.Measure(image.data(), width, height, x.data(), y.data(), n, out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+BENCHMARK(BM_AperturePhotometry)->RangeMultiplier(2)->Range(1, 64)->UseRealTime();
+
+static void BM_StarDetector(benchmark::State& state)
+{
+    const std::size_t width = 4096, height = 4096, n = 20000;
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::normal_distribution<float> noise(100.0f, 5.0f);
+    std::vector<FieldStar> stars(n);
+    for (FieldStar& star : stars) {
+        star.x    = width * unit(random);
+        star.y    = height * unit(random);
+        star.peak = 50.0 * std::pow(100.0, unit(random));
+        star.beta = 2.5;
+    }
+    std::vector<float> image(width * height);
+    for (float& pixel : image) {
+        pixel = noise(random);
+    }
+    ThreadPool pool(static_cast<unsigned>(state.range(0)));
+    StarFieldRenderer(width, height, 1.0, pool).Render(stars.data(), n, image.data());
+
+    StarDetector detector(5.0, 3, 128, 64, 2.5, pool);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(detector.Detect(image.data(), width, height));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * image.size() * sizeof(float)));
+}
+BENCHMARK(BM_StarDetector)->RangeMultiplier(2)->Range(1, 64)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_MagnitudeSum(benchmark::State& state)
+{
+    const std::vector<double> mag = uniform(5.0, 25.0, 1 << 23);
+    ThreadPool pool(static_cast<unsigned>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(MagnitudeSum::Total(mag.data(), mag.size(), pool));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * mag.size()));
+}
+BENCHMARK(BM_MagnitudeSum)->RangeMultiplier(2)->Range(1, 64)->UseRealTime();
+
+static void BM_MagnitudeSum_Fold(benchmark::State& state)
+{
+    const std::vector<double> mag = uniform(5.0, 25.0, 1 << 23);
+    for (auto _ : state) {
+        double total = INFINITY;
+        for (const double m : mag) {
+            total = Star::magnitudeSum(total, m);
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * mag.size()));
+}
+BENCHMARK(BM_MagnitudeSum_Fold);
+
+/**
+ * right ascensions and declinations uniformly distributed over the sphere
+ */
+static void skyPositions(std::vector<double>& ra, std::vector<double>& dec, const std::size_t n)
+{
+    std::mt19937_64 random(7);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    ra.resize(n);
+    dec.resize(n);
+    for (std::size_t i = 0; i < n; i++) {
+        ra[i]  = 360.0 * unit(random);
+        dec[i] = std::asin(2.0 * unit(random) - 1.0) * 180.0 / PI_NUMBER;
+    }
+}
+
+/**
+ * index of ten million stars shared by query benchmarks
+ */
+static const SkyIndex& skyIndex()
+{
+    static const SkyIndex index = [] {
+        std::vector<double> ra, dec;
+        skyPositions(ra, dec, 10000000);
+        return SkyIndex(ra.data(), dec.data(), ra.size());
+    }();
+    return index;
+}
+
+static void BM_SkyIndex_Build(benchmark::State& state)
+{
+    std::vector<double> ra, dec;
+    skyPositions(ra, dec, 10000000);
+    ThreadPool pool(static_cast<unsigned>(state.range(0)));
+    for (auto _ : state) {
+        SkyIndex index(ra.data(), dec.data(), ra.size(), pool);
+        benchmark::DoNotOptimize(index.Size());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * ra.size()));
+}
+BENCHMARK(BM_SkyIndex_Build)->RangeMultiplier(2)->Range(1, 64)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/**
+ * cone searches of radius state.range(0) arcminutes at random centres, about 0.07 stars per square arcminute
+ */
+static void BM_SkyIndex_Cone(benchmark::State& state)
+{
+    const SkyIndex& index = skyIndex();
+    std::vector<double> ra, dec;
+    skyPositions(ra, dec, 1024);
+    const double radius = static_cast<double>(state.range(0)) / 60.0;
+    std::vector<std::size_t> found;
+    std::size_t query = 0, total = 0;
+    for (auto _ : state) {
+        found.clear();
+        index.Cone(ra[query % ra.size()], dec[query % dec.size()], radius, found);
+        total += found.size();
+        query++;
+    }
+    state.counters["found"] = benchmark::Counter(static_cast<double>(total) / static_cast<double>(query));
+}
+BENCHMARK(BM_SkyIndex_Cone)->RangeMultiplier(4)->Range(1, 64)->Unit(benchmark::kMicrosecond);
+
+static void BM_SkyIndex_Box(benchmark::State& state)
+{
+    const SkyIndex& index = skyIndex();
+    std::vector<double> ra, dec;
+    skyPositions(ra, dec, 1024);
+    std::vector<std::size_t> found;
+    std::size_t query = 0;
+    for (auto _ : state) {
+        const double r = ra[query % ra.size()], d = std::min(dec[query % dec.size()], 89.0);
+        found.clear();
+        index.Box(r, r + 0.5, d, d + 0.5, found);
+        query++;
+    }
+}
+BENCHMARK(BM_SkyIndex_Box)->Unit(benchmark::kMicrosecond);
+
+static void BM_SkyIndex_Nearest(benchmark::State& state)
+{
+    const SkyIndex& index = skyIndex();
+    std::vector<double> ra, dec;
+    skyPositions(ra, dec, 1024);
+    std::size_t query = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.Nearest(ra[query % ra.size()], dec[query % dec.size()], state.range(0)));
+        query++;
+    }
+}
+BENCHMARK(BM_SkyIndex_Nearest)->RangeMultiplier(8)->Range(1, 64)->Unit(benchmark::kMicrosecond);
+
+/**
+ * Best matches of state.range(0) million stars against state.range(1) million reference stars within one arcsecond,
+ * every reference star has a counterpart displaced by up to half an arcsecond
+ */
+static void BM_CrossMatcher(benchmark::State& state)
+{
+    const std::size_t n1 = static_cast<std::size_t>(state.range(0)) * 1000000;
+    const std::size_t n2 = static_cast<std::size_t>(state.range(1)) * 1000000;
+    std::vector<double> ra1, dec1, ra2, dec2;
+    skyPositions(ra1, dec1, n1);
+    skyPositions(ra2, dec2, n2);
+    for (std::size_t i = 0; i < std::min(n1, n2); i++) {
+        ra2[i]  = ra1[i] + 0.5 / 3600.0 / std::max(std::cos(dec1[i] * PI_NUMBER / 180.0), 1e-3);
+        dec2[i] = dec1[i];
+    }
+    const CrossMatcher matcher(1.0 / 3600.0);
+    std::size_t matches = 0;
+    for (auto _ : state) {
+        matches = matcher.Best(ra1.data(), dec1.data(), n1, ra2.data(), dec2.data(), n2).size();
+    }
+    state.counters["matches"] = static_cast<double>(matches);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n1));
+}
+BENCHMARK(BM_CrossMatcher)->Args({1, 1})->Args({10, 1})->Args({100, 1})->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_EpochPropagator(benchmark::State& state)
+{
+    const std::size_t n = 10000000;
+    StarCatalog catalog(n);
+    std::vector<double> ra, dec;
+    skyPositions(ra, dec, n);
+    const std::vector<double> pm       = uniform(-500.0, 500.0, n);
+    const std::vector<double> parallax = uniform(0.001, 0.5, n);
+    for (std::size_t i = 0; i < n; i++) {
+        catalog.RightAscension()[i]  = ra[i];
+        catalog.Declination()[i]     = dec[i];
+        catalog.ProperMotionRa()[i]  = pm[i];
+        catalog.ProperMotionDec()[i] = pm[n - 1 - i];
+        catalog.Parallax()[i]        = parallax[i];
+        catalog.RadialVelocity()[i]  = 1e-4 * parallax[n - 1 - i];
+    }
+    ThreadPool pool(static_cast<unsigned>(state.range(0)));
+    const EpochPropagator propagator(pool);
+    double years = 1.0;
+    for (auto _ : state) {
+        propagator.Propagate(catalog, years);
+        years = -years;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+BENCHMARK(BM_EpochPropagator)->RangeMultiplier(2)->Range(1, 64)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/**
+ * Temperature-luminosity diagram of 10 million stars on a 512 x 512 grid
+ */
+static void BM_HrDiagram(benchmark::State& state)
+{
+    const StarCatalog stars = catalog(10000000);
+    ThreadPool pool(static_cast<unsigned>(state.range(0)));
+    HrDiagram diagram({HrAxis::Temperature, 40000.0, 2000.0, 512, true}, {HrAxis::Luminosity, 1e-4, 1e6, 512, true},
+                      pool);
+    for (auto _ : state) {
+        diagram.Clear();
+        diagram.Add(stars);
+        benchmark::DoNotOptimize(diagram.Counts().data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * stars.Size()));
+}
+BENCHMARK(BM_HrDiagram)->RangeMultiplier(2)->Range(1, 64)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/**
+ * Catalog of a million stars with radii and photosphere temperatures, for luminosity and radius
+ */
+static StarCatalog editedCatalog()
+{
+    StarCatalog stars = catalog(1 << 20);
+    for (std::size_t i = 0; i < stars.Size(); i++) {
+        stars.Radius()[i]                 = 7e8 * (0.1 + 1e-5 * static_cast<double>(i % 100000));
+        stars.PhotosphereTemperature()[i] = 2500.0 + 0.03 * static_cast<double>(i);
+    }
+    return stars;
+}
+
+/**
+ * Luminosity and radius read after editing as many stars as the benchmark argument, against recomputing both columns
+ */
+static void BM_DerivedCache(benchmark::State& state)
+{
+    StarCatalog stars = editedCatalog();
+    DerivedCache cache(stars);
+    const auto edits  = static_cast<std::size_t>(state.range(0));
+    const std::size_t step = stars.Size() / edits;
+    double temperature = 3000.0;
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < edits; i++) {
+            cache.SetPhotosphereTemperature(i * step, temperature);
+        }
+        temperature += 1.0;
+        benchmark::DoNotOptimize(cache.Get(DerivedCache::Luminosity));
+        benchmark::DoNotOptimize(cache.Get(DerivedCache::Radius));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * edits));
+}
+BENCHMARK(BM_DerivedCache)->RangeMultiplier(16)->Range(1, 1 << 16)->Unit(benchmark::kMicrosecond);
+
+static void BM_DerivedCache_Full(benchmark::State& state)
+{
+    StarCatalog stars = editedCatalog();
+    std::vector<double> lum(stars.Size()), radius(stars.Size());
+    DerivedColumns out;
+    out.luminosity = lum.data();
+    out.radius     = radius.data();
+    const StarPipeline pipeline;
+    for (auto _ : state) {
+        stars.Luminosity(lum.data());
+        pipeline.Run(stars, out);
+        benchmark::DoNotOptimize(radius.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * stars.Size()));
+}
+BENCHMARK(BM_DerivedCache_Full)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""
+Compares two astrobench JSON results and flags benchmarks that got slower than a threshold.
+
+    astrobench --benchmark_out=old.json --benchmark_out_format=json
+    ... update the library ...
+    astrobench --benchmark_out=new.json --benchmark_out_format=json
+    compare.py old.json new.json --threshold 10
+
+With repetitions only the median aggregate is compared. Exits with status 1 if any benchmark regressed.
+"""
+
+import argparse
+import json
+import sys
+
+UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path, metric):
+    """Returns benchmark name to time in nanoseconds"""
+    with open(path) as file:
+        benchmarks = json.load(file)["benchmarks"]
+    medians = any(b.get("aggregate_name") == "median" for b in benchmarks)
+    times = {}
+    for b in benchmarks:
+        if b.get("error_occurred"):
+            continue
+        if medians and b.get("aggregate_name") != "median":
+            continue
+        if not medians and b.get("run_type") == "aggregate":
+            continue
+        name = b.get("run_name", b["name"])
+        times[name] = b[metric] * UNITS[b.get("time_unit", "ns")]
+    return times
+
+
+def format_time(ns):
+    for unit in ("s", "ms", "us"):
+        if ns >= UNITS[unit]:
+            return f"{ns / UNITS[unit]:.3f} {unit}"
+    return f"{ns:.1f} ns"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline", help="JSON results of the reference run")
+    parser.add_argument("contender", help="JSON results of the run to check")
+    parser.add_argument("--threshold", type=float, default=10.0, help="allowed slowdown in percent, default 10")
+    parser.add_argument("--metric", choices=("real_time", "cpu_time"), default="real_time",
+                        help="time compared, default real_time")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline, args.metric)
+    contender = load(args.contender, args.metric)
+    regressions = 0
+    width = max((len(name) for name in baseline), default=9)
+    print(f"{'Benchmark':<{width}}  {'Baseline':>12}  {'Contender':>12}  {'Change':>8}")
+    for name, old in baseline.items():
+        if name not in contender:
+            print(f"{name:<{width}}  {format_time(old):>12}  {'missing':>12}")
+            continue
+        new = contender[name]
+        change = (new - old) / old * 100.0 if old > 0 else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print(f"{name:<{width}}  {format_time(old):>12}  {format_time(new):>12}  {change:>+7.1f}%{flag}")
+    for name in contender:
+        if name not in baseline:
+            print(f"{name:<{width}}  {'new':>12}  {format_time(contender[name]):>12}")
+
+    if regressions:
+        print(f"{regressions} benchmark(s) slower by more than {args.threshold:g}%")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
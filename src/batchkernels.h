@@ -0,0 +1,410 @@
+#ifndef ASTROLIB_BATCHKERNELS_H
+#define ASTROLIB_BATCHKERNELS_H
+
+#include <cstddef>
+#include <iterator>
+#include "include/star.h"
+#include "include/starmath.h"
+#include "simd.h"
+
+/**
+ * StarBatch kernels of one instruction set level, StarBatch dispatches to the best table the CPU runs
+ */
+struct BatchKernels
+{
+    void (*bmv2rgb)(const double* bmv, double* r, double* g, double* b, std::size_t n);
+    void (*bmv2rgbInterleaved)(const double* bmv, double* rgb, std::size_t n);
+    void (*bmv2rgbFloat)(const double* bmv, float* rgb, std::size_t n);
+    void (*absoluteMagnitude)(const double* appMag, const double* distPC, double* out, std::size_t n);
+    void (*apparentMagnitude)(const double* absMag, const double* distPC, double* out, std::size_t n);
+    void (*distanceFromMagnitude)(const double* appMag, const double* absMag, double* out, std::size_t n);
+    void (*brightnessRatio)(const double* magDiff, double* out, std::size_t n);
+    void (*magnitudeDifference)(const double* ratio, double* out, std::size_t n);
+    void (*luminosity)(const double* mv, const double* bc, double* out, std::size_t n);
+    void (*colorTemperature)(const double* bmv, const int* lumClass, double* out, std::size_t n);
+    void (*bolometricCorrection)(const double* temp, double* out, std::size_t n);
+
+    /**
+     * float columns, magnitude conversions run on float lanes, the others in double
+     */
+    void (*bmv2rgbF)(const float* bmv, float* r, float* g, float* b, std::size_t n);
+    void (*absoluteMagnitudeF)(const float* appMag, const float* distPC, float* out, std::size_t n);
+    void (*apparentMagnitudeF)(const float* absMag, const float* distPC, float* out, std::size_t n);
+    void (*distanceFromMagnitudeF)(const float* appMag, const float* absMag, float* out, std::size_t n);
+    void (*brightnessRatioF)(const float* magDiff, float* out, std::size_t n);
+    void (*magnitudeDifferenceF)(const float* ratio, float* out, std::size_t n);
+    void (*luminosityF)(const float* mv, const float* bc, float* out, std::size_t n);
+    void (*colorTemperatureF)(const float* bmv, const int* lumClass, float* out, std::size_t n);
+    void (*bolometricCorrectionF)(const float* temp, float* out, std::size_t n);
+};
+
+/**
+ * Kernel tables, each defined in a translation unit compiled for its instruction set, null if the build or the
+ * target has none
+ */
+const BatchKernels* scalarKernels();
+const BatchKernels* sse2Kernels();
+const BatchKernels* avx2Kernels();
+const BatchKernels* avx512Kernels();
+
+/*
+ * Kernels below are included by every kernel translation unit and have internal linkage only, they call no inline
+ * function outside of the instruction set namespace of simd.h, see there.
+ */
+
+/**
+ * Branchless Star::bmv2rgb, every piecewise segment is evaluated with the same operations as the scalar code and the
+ * one whose range holds bv is selected per lane
+ */
+template <class P>
+static void bmv2rgbPack(typename P::Vec bv, typename P::Vec& r, typename P::Vec& g, typename P::Vec& b)
+{
+    const typename P::Vec zero = P::set1(0.0);
+    const typename P::Vec one  = P::set1(1.0);
+
+    bv = P::min(P::set1(2.0), P::max(P::set1(-0.4), bv));
+
+    const typename P::Mask inA = P::both(P::ge(bv, P::set1(-0.40)), P::lt(bv, P::set1(0.00)));
+    const typename P::Mask inB = P::both(P::ge(bv, P::set1(0.00)), P::lt(bv, P::set1(0.40)));
+    const typename P::Vec tA   = P::div(P::add(bv, P::set1(0.40)), P::set1(0.00 + 0.40));
+    const typename P::Vec tB   = P::div(P::sub(bv, P::set1(0.00)), P::set1(0.40 - 0.00));
+
+    // red
+    {
+        const typename P::Vec rA = P::add(P::add(P::set1(0.61), P::mul(P::set1(0.11), tA)),
+                                          P::mul(P::mul(P::set1(0.1), tA), tA));
+        const typename P::Vec rB = P::add(P::set1(0.83), P::mul(P::set1(0.17), tB));
+        const typename P::Mask inC = P::both(P::ge(bv, P::set1(0.40)), P::lt(bv, P::set1(2.10)));
+        r = P::select(inA, rA, P::select(inB, rB, P::select(inC, one, zero)));
+    }
+
+    // green
+    {
+        const typename P::Vec gA = P::add(P::add(P::set1(0.70), P::mul(P::set1(0.07), tA)),
+                                          P::mul(P::mul(P::set1(0.1), tA), tA));
+        const typename P::Vec gB = P::add(P::set1(0.87), P::mul(P::set1(0.11), tB));
+        const typename P::Mask inC = P::both(P::ge(bv, P::set1(0.40)), P::lt(bv, P::set1(1.60)));
+        const typename P::Vec tC   = P::div(P::sub(bv, P::set1(0.40)), P::set1(1.60 - 0.40));
+        const typename P::Vec gC   = P::sub(P::set1(0.98), P::mul(P::set1(0.16), tC));
+        const typename P::Mask inD = P::both(P::ge(bv, P::set1(1.60)), P::lt(bv, P::set1(2.00)));
+        const typename P::Vec tD   = P::div(P::sub(bv, P::set1(1.60)), P::set1(2.00 - 1.60));
+        const typename P::Vec gD   = P::sub(P::set1(0.82), P::mul(P::mul(P::set1(0.5), tD), tD));
+        g = P::select(inA, gA, P::select(inB, gB, P::select(inC, gC, P::select(inD, gD, zero))));
+    }
+
+    // blue
+    {
+        const typename P::Mask inA = P::both(P::ge(bv, P::set1(-0.40)), P::lt(bv, P::set1(0.40)));
+        const typename P::Mask inB = P::both(P::ge(bv, P::set1(0.40)), P::lt(bv, P::set1(1.50)));
+        const typename P::Vec tB   = P::div(P::sub(bv, P::set1(0.40)), P::set1(1.50 - 0.40));
+        const typename P::Vec bB   = P::add(P::sub(P::set1(1.00), P::mul(P::set1(0.47), tB)),
+                                          P::mul(P::mul(P::set1(0.1), tB), tB));
+        const typename P::Mask inC = P::both(P::ge(bv, P::set1(1.50)), P::lt(bv, P::set1(1.94)));
+        const typename P::Vec tC   = P::div(P::sub(bv, P::set1(1.50)), P::set1(1.94 - 1.50));
+        const typename P::Vec bC   = P::sub(P::set1(0.63), P::mul(P::mul(P::set1(0.6), tC), tC));
+        b = P::select(inA, one, P::select(inB, bB, P::select(inC, bC, zero)));
+    }
+}
+
+/**
+ * Runs bmv2rgbPack over n colors, full packs first then scalar tail, and passes every group of colors to write
+ */
+template <class P, class Write>
+static void bmv2rgbLoop(const double* bmv, std::size_t n, Write write)
+{
+    std::size_t i = 0;
+    for (; i + P::width <= n; i += P::width) {
+        typename P::Vec r, g, b;
+        bmv2rgbPack<P>(P::load(bmv + i), r, g, b);
+
+        double rl[P::width], gl[P::width], bl[P::width];
+        P::store(rl, r);
+        P::store(gl, g);
+        P::store(bl, b);
+        write(i, rl, gl, bl, P::width);
+    }
+    for (; i < n; i++) {
+        double r, g, b;
+        bmv2rgbPack<ScalarPack>(bmv[i], r, g, b);
+        write(i, &r, &g, &b, 1);
+    }
+}
+
+/**
+ * Broadcasts coefficients to vector pack
+ */
+template <class P, std::size_t N>
+static void broadcast(const double (&c)[N], typename P::Vec (&v)[N])
+{
+    for (std::size_t k = 0; k < N; k++) {
+        v[k] = P::set1(c[k]);
+    }
+}
+
+/**
+ * log10 of Star::colorTemperature, both polynomials are evaluated in Horner form and the one matching lumClass is
+ * selected per lane
+ */
+template <class P>
+static typename P::Vec colorTemperaturePack(typename P::Vec bv, typename P::Vec lumClass)
+{
+    typename P::Vec supergiant[std::size(StarMath::COLOR_TEMPERATURE_SUPERGIANT)];
+    typename P::Vec other[std::size(StarMath::COLOR_TEMPERATURE_OTHER)];
+    broadcast<P>(StarMath::COLOR_TEMPERATURE_SUPERGIANT, supergiant);
+    broadcast<P>(StarMath::COLOR_TEMPERATURE_OTHER, other);
+
+    return P::select(P::le(lumClass, P::set1(Star::LumClass::Ib)), horner<P>(bv, supergiant), horner<P>(bv, other));
+}
+
+/**
+ * Star::bolometricCorrection of log10 temperature, all three segments are evaluated in Horner form and the one
+ * holding t is selected per lane at the 3.7 and 3.9 breaks
+ */
+template <class P>
+static typename P::Vec bolometricCorrectionPack(typename P::Vec t)
+{
+    typename P::Vec hot[std::size(StarMath::BOLOMETRIC_CORRECTION_HOT)];
+    typename P::Vec warm[std::size(StarMath::BOLOMETRIC_CORRECTION_WARM)];
+    typename P::Vec cool[std::size(StarMath::BOLOMETRIC_CORRECTION_COOL)];
+    broadcast<P>(StarMath::BOLOMETRIC_CORRECTION_HOT, hot);
+    broadcast<P>(StarMath::BOLOMETRIC_CORRECTION_WARM, warm);
+    broadcast<P>(StarMath::BOLOMETRIC_CORRECTION_COOL, cool);
+
+    return P::select(P::gt(t, P::set1(3.9)), horner<P>(t, hot),
+                     P::select(P::gt(t, P::set1(3.7)), horner<P>(t, warm), horner<P>(t, cool)));
+}
+
+/**
+ * Planar bmv2rgb of double or float columns, computed in double either way
+ */
+template <class P, class T>
+static void bmv2rgbKernel(const T* bmv, T* r, T* g, T* b, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + P::width <= n; i += P::width) {
+        typename P::Vec vr, vg, vb;
+        bmv2rgbPack<P>(P::load(bmv + i), vr, vg, vb);
+        P::store(r + i, vr);
+        P::store(g + i, vg);
+        P::store(b + i, vb);
+    }
+    for (; i < n; i++) {
+        double sr, sg, sb;
+        bmv2rgbPack<ScalarPack>(bmv[i], sr, sg, sb);
+        r[i] = static_cast<T>(sr);
+        g[i] = static_cast<T>(sg);
+        b[i] = static_cast<T>(sb);
+    }
+}
+
+template <class P>
+static void bmv2rgbInterleavedKernel(const double* bmv, double* rgb, std::size_t n)
+{
+    bmv2rgbLoop<P>(bmv, n, [rgb](std::size_t i, const double* r, const double* g, const double* b, std::size_t count) {
+        for (std::size_t k = 0; k < count; k++) {
+            rgb[3 * (i + k) + 0] = r[k];
+            rgb[3 * (i + k) + 1] = g[k];
+            rgb[3 * (i + k) + 2] = b[k];
+        }
+    });
+}
+
+template <class P>
+static void bmv2rgbFloatKernel(const double* bmv, float* rgb, std::size_t n)
+{
+    bmv2rgbLoop<P>(bmv, n, [rgb](std::size_t i, const double* r, const double* g, const double* b, std::size_t count) {
+        for (std::size_t k = 0; k < count; k++) {
+            rgb[3 * (i + k) + 0] = static_cast<float>(r[k]);
+            rgb[3 * (i + k) + 1] = static_cast<float>(g[k]);
+            rgb[3 * (i + k) + 2] = static_cast<float>(b[k]);
+        }
+    });
+}
+
+/**
+ * 5 (log10(dist) - 1), the distance modulus of finite positive distance in parsecs
+ */
+template <class P>
+static typename P::Vec distanceModulusPack(typename P::Vec dist)
+{
+    return P::mul(P::set1(5.0), P::sub(log10<P>(dist), P::set1(1.0)));
+}
+
+/**
+ * Whether dist is positive and finite, for other distances the magnitude conversions return infinities as StarMath
+ */
+template <class P>
+static typename P::Mask knownDistance(typename P::Vec dist)
+{
+    return P::both(P::gt(dist, P::set1(0.0)), P::lt(dist, P::set1(INFINITY)));
+}
+
+template <class P>
+static typename P::Vec absoluteMagnitudePack(typename P::Vec appMag, typename P::Vec dist)
+{
+    return P::select(knownDistance<P>(dist), P::sub(appMag, distanceModulusPack<P>(dist)), P::set1(-INFINITY));
+}
+
+template <class P>
+static typename P::Vec apparentMagnitudePack(typename P::Vec absMag, typename P::Vec dist)
+{
+    const typename P::Vec unknown = P::select(P::le(dist, P::set1(0.0)), P::set1(-INFINITY), P::set1(INFINITY));
+    return P::select(knownDistance<P>(dist), P::add(absMag, distanceModulusPack<P>(dist)), unknown);
+}
+
+template <class P>
+static typename P::Vec distanceFromMagnitudePack(typename P::Vec appMag, typename P::Vec absMag)
+{
+    return exp10<P>(P::add(P::div(P::sub(appMag, absMag), P::set1(5.0)), P::set1(1.0)));
+}
+
+/**
+ * exp10 gives exactly infinity and zero for infinite magnitude differences, as StarMath does explicitly
+ */
+template <class P>
+static typename P::Vec brightnessRatioPack(typename P::Vec magDiff)
+{
+    return exp10<P>(P::div(magDiff, P::set1(2.5)));
+}
+
+template <class P>
+static typename P::Vec magnitudeDifferencePack(typename P::Vec ratio)
+{
+    return P::mul(P::set1(-2.5), log10<P>(ratio));
+}
+
+template <class P>
+static typename P::Vec luminosityPack(typename P::Vec mv, typename P::Vec bc)
+{
+    return brightnessRatioPack<P>(P::sub(P::sub(P::set1(4.725), mv), bc));
+}
+
+/**
+ * Runs f over n elements of column a, full packs first then scalar tail. Columns of T are computed in the scalar type
+ * of P, which may be wider than T.
+ */
+template <class P, class T, class F>
+static void unaryLoop(const T* a, T* out, std::size_t n, F f)
+{
+    using Tail    = ScalarPackOf<typename P::Scalar>;
+    std::size_t i = 0;
+    for (; i + P::width <= n; i += P::width) {
+        P::store(out + i, f(P(), P::load(a + i)));
+    }
+    for (; i < n; i++) {
+        out[i] = static_cast<T>(f(Tail(), a[i]));
+    }
+}
+
+/**
+ * Runs f over n elements of columns a and b as unaryLoop
+ */
+template <class P, class T, class F>
+static void binaryLoop(const T* a, const T* b, T* out, std::size_t n, F f)
+{
+    using Tail    = ScalarPackOf<typename P::Scalar>;
+    std::size_t i = 0;
+    for (; i + P::width <= n; i += P::width) {
+        P::store(out + i, f(P(), P::load(a + i), P::load(b + i)));
+    }
+    for (; i < n; i++) {
+        out[i] = static_cast<T>(f(Tail(), a[i], b[i]));
+    }
+}
+
+template <class P, class T>
+static void absoluteMagnitudeKernel(const T* appMag, const T* distPC, T* out, std::size_t n)
+{
+    binaryLoop<P>(appMag, distPC, out, n, [](auto pack, auto m, auto d) {
+        return absoluteMagnitudePack<decltype(pack)>(m, d);
+    });
+}
+
+template <class P, class T>
+static void apparentMagnitudeKernel(const T* absMag, const T* distPC, T* out, std::size_t n)
+{
+    binaryLoop<P>(absMag, distPC, out, n, [](auto pack, auto m, auto d) {
+        return apparentMagnitudePack<decltype(pack)>(m, d);
+    });
+}
+
+template <class P, class T>
+static void distanceFromMagnitudeKernel(const T* appMag, const T* absMag, T* out, std::size_t n)
+{
+    binaryLoop<P>(appMag, absMag, out, n, [](auto pack, auto app, auto abs) {
+        return distanceFromMagnitudePack<decltype(pack)>(app, abs);
+    });
+}
+
+template <class P, class T>
+static void brightnessRatioKernel(const T* magDiff, T* out, std::size_t n)
+{
+    unaryLoop<P>(magDiff, out, n, [](auto pack, auto m) { return brightnessRatioPack<decltype(pack)>(m); });
+}
+
+template <class P, class T>
+static void magnitudeDifferenceKernel(const T* ratio, T* out, std::size_t n)
+{
+    unaryLoop<P>(ratio, out, n, [](auto pack, auto r) { return magnitudeDifferencePack<decltype(pack)>(r); });
+}
+
+template <class P, class T>
+static void luminosityKernel(const T* mv, const T* bc, T* out, std::size_t n)
+{
+    binaryLoop<P>(mv, bc, out, n, [](auto pack, auto m, auto c) { return luminosityPack<decltype(pack)>(m, c); });
+}
+
+template <class P, class T>
+static void colorTemperatureKernel(const T* bmv, const int* lumClass, T* out, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + P::width <= n; i += P::width) {
+        double lc[P::width];
+        for (std::size_t k = 0; k < P::width; k++) {
+            lc[k] = lumClass[i + k];
+        }
+        P::store(out + i, exp10<P>(colorTemperaturePack<P>(P::load(bmv + i), P::load(lc))));
+    }
+    for (; i < n; i++) {
+        out[i] = static_cast<T>(exp10<ScalarPack>(colorTemperaturePack<ScalarPack>(bmv[i], lumClass[i])));
+    }
+}
+
+template <class P, class T>
+static void bolometricCorrectionKernel(const T* temp, T* out, std::size_t n)
+{
+    unaryLoop<P>(temp, out, n, [](auto pack, auto t) {
+        using Q = decltype(pack);
+        return bolometricCorrectionPack<Q>(log10<Q>(t));
+    });
+}
+
+/**
+ * Kernel table of double pack P and float pack PF of the same instruction set
+ */
+template <class P, class PF>
+static constexpr BatchKernels batchKernels()
+{
+    return {bmv2rgbKernel<P, double>,
+            bmv2rgbInterleavedKernel<P>,
+            bmv2rgbFloatKernel<P>,
+            absoluteMagnitudeKernel<P, double>,
+            apparentMagnitudeKernel<P, double>,
+            distanceFromMagnitudeKernel<P, double>,
+            brightnessRatioKernel<P, double>,
+            magnitudeDifferenceKernel<P, double>,
+            luminosityKernel<P, double>,
+            colorTemperatureKernel<P, double>,
+            bolometricCorrectionKernel<P, double>,
+            bmv2rgbKernel<P, float>,
+            absoluteMagnitudeKernel<PF, float>,
+            apparentMagnitudeKernel<PF, float>,
+            distanceFromMagnitudeKernel<PF, float>,
+            brightnessRatioKernel<PF, float>,
+            magnitudeDifferenceKernel<PF, float>,
+            luminosityKernel<PF, float>,
+            colorTemperatureKernel<P, float>,
+            bolometricCorrectionKernel<P, float>};
+}
+
+#endif // ASTROLIB_BATCHKERNELS_H
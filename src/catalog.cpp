@@ -0,0 +1,273 @@
+#include <cmath>
+#include "include/catalog.h"
+#include "include/spectrumdictionary.h"
+#include "include/starbatch.h"
+
+StarCatalog::StarCatalog() = default;
+
+StarCatalog::StarCatalog(const std::size_t size)
+{
+    Resize(size);
+}
+
+std::size_t StarCatalog::Size() const
+{
+    return this->_mass.size();
+}
+
+void StarCatalog::Resize(const std::size_t size)
+{
+    this->_mass.resize(size);
+    this->_radius.resize(size);
+    this->_photosphereTemperature.resize(size);
+    this->_parallax.resize(size);
+    this->_radvel.resize(size);
+    this->_Vmagnitude.resize(size);
+    this->_Bmagnitude.resize(size);
+    this->_ra.resize(size);
+    this->_dec.resize(size);
+    this->_pmra.resize(size);
+    this->_pmdec.resize(size);
+    this->_spectype.resize(size);
+    this->_lumclass.resize(size);
+}
+
+void StarCatalog::Reserve(const std::size_t capacity)
+{
+    this->_mass.reserve(capacity);
+    this->_radius.reserve(capacity);
+    this->_photosphereTemperature.reserve(capacity);
+    this->_parallax.reserve(capacity);
+    this->_radvel.reserve(capacity);
+    this->_Vmagnitude.reserve(capacity);
+    this->_Bmagnitude.reserve(capacity);
+    this->_ra.reserve(capacity);
+    this->_dec.reserve(capacity);
+    this->_pmra.reserve(capacity);
+    this->_pmdec.reserve(capacity);
+    this->_spectype.reserve(capacity);
+    this->_lumclass.reserve(capacity);
+}
+
+void StarCatalog::Clear()
+{
+    Resize(0);
+}
+
+void StarCatalog::Add(const Star& star)
+{
+    Resize(Size() + 1);
+    Set(Size() - 1, star);
+}
+
+void StarCatalog::Set(const std::size_t index, const Star& star)
+{
+    this->_mass[index]                   = star.GetMass();
+    this->_radius[index]                 = star.GetRadius();
+    this->_photosphereTemperature[index] = star.GetPhotosphereTemperature();
+    this->_parallax[index]               = star.GetParallax();
+    this->_radvel[index]                 = star.GetRadialVelocity();
+    this->_Vmagnitude[index]             = star.GetVmagnitude();
+    this->_Bmagnitude[index]             = star.GetBmagnitude();
+    this->_ra[index]                     = star.GetRightAscension();
+    this->_dec[index]                    = star.GetDeclination();
+    this->_pmra[index]                   = star.GetProperMotionRa();
+    this->_pmdec[index]                  = star.GetProperMotionDec();
+    // codes were parsed once when the spectrum was interned
+    const SpectrumDictionary& spectra = SpectrumDictionary::Default();
+    this->_spectype[index]            = spectra.SpectralType(star.GetSpectrumId());
+    this->_lumclass[index]            = spectra.LuminosityClass(star.GetSpectrumId());
+}
+
+Star StarCatalog::Get(const std::size_t index) const
+{
+    Star star;
+    star.SetMass(this->_mass[index]);
+    star.SetRadius(this->_radius[index]);
+    star.SetPhotosphereTemperature(this->_photosphereTemperature[index]);
+    star.SetParallax(this->_parallax[index]);
+    star.SetRadialVelocity(this->_radvel[index]);
+    star.SetVmagnitude(this->_Vmagnitude[index]);
+    star.SetBmagnitude(this->_Bmagnitude[index]);
+    star.SetRightAscension(this->_ra[index]);
+    star.SetDeclination(this->_dec[index]);
+    star.SetProperMotionRa(this->_pmra[index]);
+    star.SetProperMotionDec(this->_pmdec[index]);
+    star.SetSpectrumId(SpectrumDictionary::Default().Format(this->_spectype[index], this->_lumclass[index]));
+    return star;
+}
+
+void StarCatalog::Gather(const std::vector<Star>& stars)
+{
+    const std::size_t offset = Size();
+    Resize(offset + stars.size());
+    for (std::size_t i = 0; i < stars.size(); i++) {
+        Set(offset + i, stars[i]);
+    }
+}
+
+void StarCatalog::Append(const StarCatalog& other)
+{
+    this->_mass.insert(this->_mass.end(), other._mass.begin(), other._mass.end());
+    this->_radius.insert(this->_radius.end(), other._radius.begin(), other._radius.end());
+    this->_photosphereTemperature.insert(this->_photosphereTemperature.end(), other._photosphereTemperature.begin(),
+                                         other._photosphereTemperature.end());
+    this->_parallax.insert(this->_parallax.end(), other._parallax.begin(), other._parallax.end());
+    this->_radvel.insert(this->_radvel.end(), other._radvel.begin(), other._radvel.end());
+    this->_Vmagnitude.insert(this->_Vmagnitude.end(), other._Vmagnitude.begin(), other._Vmagnitude.end());
+    this->_Bmagnitude.insert(this->_Bmagnitude.end(), other._Bmagnitude.begin(), other._Bmagnitude.end());
+    this->_ra.insert(this->_ra.end(), other._ra.begin(), other._ra.end());
+    this->_dec.insert(this->_dec.end(), other._dec.begin(), other._dec.end());
+    this->_pmra.insert(this->_pmra.end(), other._pmra.begin(), other._pmra.end());
+    this->_pmdec.insert(this->_pmdec.end(), other._pmdec.begin(), other._pmdec.end());
+    this->_spectype.insert(this->_spectype.end(), other._spectype.begin(), other._spectype.end());
+    this->_lumclass.insert(this->_lumclass.end(), other._lumclass.begin(), other._lumclass.end());
+}
+
+void StarCatalog::Scatter(std::vector<Star>& stars) const
+{
+    stars.resize(Size());
+    for (std::size_t i = 0; i < stars.size(); i++) {
+        stars[i] = Get(i);
+    }
+}
+
+double* StarCatalog::Mass()
+{
+    return this->_mass.data();
+}
+double* StarCatalog::Radius()
+{
+    return this->_radius.data();
+}
+double* StarCatalog::PhotosphereTemperature()
+{
+    return this->_photosphereTemperature.data();
+}
+double* StarCatalog::Parallax()
+{
+    return this->_parallax.data();
+}
+double* StarCatalog::RadialVelocity()
+{
+    return this->_radvel.data();
+}
+double* StarCatalog::Vmagnitude()
+{
+    return this->_Vmagnitude.data();
+}
+double* StarCatalog::Bmagnitude()
+{
+    return this->_Bmagnitude.data();
+}
+double* StarCatalog::RightAscension()
+{
+    return this->_ra.data();
+}
+double* StarCatalog::Declination()
+{
+    return this->_dec.data();
+}
+double* StarCatalog::ProperMotionRa()
+{
+    return this->_pmra.data();
+}
+double* StarCatalog::ProperMotionDec()
+{
+    return this->_pmdec.data();
+}
+int* StarCatalog::SpectralType()
+{
+    return this->_spectype.data();
+}
+int* StarCatalog::LuminosityClass()
+{
+    return this->_lumclass.data();
+}
+
+const double* StarCatalog::Mass() const
+{
+    return this->_mass.data();
+}
+const double* StarCatalog::Radius() const
+{
+    return this->_radius.data();
+}
+const double* StarCatalog::PhotosphereTemperature() const
+{
+    return this->_photosphereTemperature.data();
+}
+const double* StarCatalog::Parallax() const
+{
+    return this->_parallax.data();
+}
+const double* StarCatalog::RadialVelocity() const
+{
+    return this->_radvel.data();
+}
+const double* StarCatalog::Vmagnitude() const
+{
+    return this->_Vmagnitude.data();
+}
+const double* StarCatalog::Bmagnitude() const
+{
+    return this->_Bmagnitude.data();
+}
+const double* StarCatalog::RightAscension() const
+{
+    return this->_ra.data();
+}
+const double* StarCatalog::Declination() const
+{
+    return this->_dec.data();
+}
+const double* StarCatalog::ProperMotionRa() const
+{
+    return this->_pmra.data();
+}
+const double* StarCatalog::ProperMotionDec() const
+{
+    return this->_pmdec.data();
+}
+const int* StarCatalog::SpectralType() const
+{
+    return this->_spectype.data();
+}
+const int* StarCatalog::LuminosityClass() const
+{
+    return this->_lumclass.data();
+}
+
+void StarCatalog::Luminosity(double* out) const
+{
+    StarBatch::Luminosity(Radius(), PhotosphereTemperature(), out, Size());
+}
+
+void StarCatalog::Distance(double* out) const
+{
+    const double* parallax = Parallax();
+    for (std::size_t i = 0; i < Size(); i++) {
+        out[i] = parallax[i] > 0.0 ? 1.0 / parallax[i] : INFINITY;
+    }
+}
+
+void StarCatalog::ColorIndex(double* out) const
+{
+    const double* B = Bmagnitude();
+    const double* V = Vmagnitude();
+    for (std::size_t i = 0; i < Size(); i++) {
+        out[i] = B[i] - V[i];
+    }
+}
+
+void StarCatalog::AbsoluteMagnitude(double* out) const
+{
+    Distance(out);
+    StarBatch::absoluteMagnitude(Vmagnitude(), out, out, Size());
+}
+
+void StarCatalog::ColorTemperature(double* out) const
+{
+    ColorIndex(out);
+    StarBatch::colorTemperature(out, LuminosityClass(), out, Size());
+}
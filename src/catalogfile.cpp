@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "include/catalogfile.h"
+
+static_assert(sizeof(int) == 4, "spectral code columns are stored as 32-bit integers");
+
+static constexpr char MAGIC[8]         = {'A', 'S', 'T', 'R', 'O', 'C', 'A', 'T'};
+static constexpr int COLUMNS           = 13;
+static constexpr int DOUBLE_COLUMNS    = 11;
+static constexpr std::size_t ALIGNMENT = 64;
+
+/**
+ * on-disk header at the start of file
+ */
+struct CatalogFileHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t columns;
+    std::uint64_t size;
+    /**
+     * checksum of column data
+     */
+    std::uint64_t checksum;
+    std::uint64_t offsets[COLUMNS];
+    /**
+     * checksum of all preceding header fields
+     */
+    std::uint64_t headerChecksum;
+};
+
+static std::size_t align(std::size_t offset)
+{
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+static std::size_t columnBytes(int column, std::size_t size)
+{
+    return size * (column < DOUBLE_COLUMNS ? sizeof(double) : sizeof(int));
+}
+
+/**
+ * 64-bit word-wise multiplicative hash, continues from seed
+ */
+static std::uint64_t checksum(const std::uint8_t* data, std::size_t length, std::uint64_t seed = 0xcbf29ce484222325)
+{
+    std::uint64_t hash = seed;
+    std::size_t i      = 0;
+    for (; i + 8 <= length; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0x100000001b3;
+        hash ^= hash >> 29;
+    }
+    for (; i < length; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3;
+    }
+    return hash;
+}
+
+static bool littleEndian()
+{
+    const std::uint16_t probe = 1;
+    std::uint8_t first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+/**
+ * Maps whole file at path read-only and stores its length, throws std::runtime_error if it cannot be opened or mapped
+ * or is shorter than the header
+ */
+static const std::uint8_t* mapFile(const std::string& path, std::size_t& length)
+{
+#ifdef _WIN32
+    const HANDLE file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                      FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("catalog file: cannot open " + path);
+    }
+    LARGE_INTEGER fileSize{};
+    if (!::GetFileSizeEx(file, &fileSize) ||
+        static_cast<std::uint64_t>(fileSize.QuadPart) < sizeof(CatalogFileHeader)) {
+        ::CloseHandle(file);
+        throw std::runtime_error("catalog file: " + path + " is too short");
+    }
+    length               = static_cast<std::size_t>(fileSize.QuadPart);
+    const HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    ::CloseHandle(file);
+    void* data = mapping ? ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, length) : nullptr;
+    if (mapping) {
+        ::CloseHandle(mapping);
+    }
+    if (data == nullptr) {
+        throw std::runtime_error("catalog file: cannot map " + path);
+    }
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("catalog file: cannot open " + path);
+    }
+    struct stat status{};
+    if (::fstat(fd, &status) != 0 || static_cast<std::size_t>(status.st_size) < sizeof(CatalogFileHeader)) {
+        ::close(fd);
+        throw std::runtime_error("catalog file: " + path + " is too short");
+    }
+    length     = static_cast<std::size_t>(status.st_size);
+    void* data = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("catalog file: cannot map " + path);
+    }
+#endif
+    return static_cast<const std::uint8_t*>(data);
+}
+
+static void unmapFile(const std::uint8_t* data, std::size_t length)
+{
+#ifdef _WIN32
+    (void)length;
+    ::UnmapViewOfFile(data);
+#else
+    ::munmap(const_cast<std::uint8_t*>(data), length);
+#endif
+}
+
+void CatalogFile::Write(const StarCatalog& catalog, const std::string& path)
+{
+    if (!littleEndian()) {
+        throw std::runtime_error("catalog file: big-endian hosts are not supported");
+    }
+
+    const std::size_t size       = catalog.Size();
+    const void* columns[COLUMNS] = {catalog.Mass(),
+                                    catalog.Radius(),
+                                    catalog.PhotosphereTemperature(),
+                                    catalog.Parallax(),
+                                    catalog.RadialVelocity(),
+                                    catalog.Vmagnitude(),
+                                    catalog.Bmagnitude(),
+                                    catalog.RightAscension(),
+                                    catalog.Declination(),
+                                    catalog.ProperMotionRa(),
+                                    catalog.ProperMotionDec(),
+                                    catalog.SpectralType(),
+                                    catalog.LuminosityClass()};
+
+    CatalogFileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version  = VERSION;
+    header.columns  = COLUMNS;
+    header.size     = size;
+    header.checksum = checksum(nullptr, 0);
+
+    std::size_t offset = align(sizeof(CatalogFileHeader));
+    for (int column = 0; column < COLUMNS; column++) {
+        header.offsets[column] = offset;
+        header.checksum        = checksum(static_cast<const std::uint8_t*>(columns[column]),
+                                          columnBytes(column, size), header.checksum);
+        offset                 = align(offset + columnBytes(column, size));
+    }
+    header.headerChecksum = checksum(reinterpret_cast<const std::uint8_t*>(&header),
+                                     offsetof(CatalogFileHeader, headerChecksum));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("catalog file: cannot create " + path);
+    }
+    const char padding[ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::size_t written = sizeof(header);
+    for (int column = 0; column < COLUMNS; column++) {
+        file.write(padding, static_cast<std::streamsize>(header.offsets[column] - written));
+        file.write(static_cast<const char*>(columns[column]), static_cast<std::streamsize>(columnBytes(column, size)));
+        written = header.offsets[column] + columnBytes(column, size);
+    }
+    file.write(padding, static_cast<std::streamsize>(align(written) - written));
+    if (!file) {
+        throw std::runtime_error("catalog file: cannot write " + path);
+    }
+}
+
+CatalogFile::CatalogFile(const std::string& path)
+{
+    if (!littleEndian()) {
+        throw std::runtime_error("catalog file: big-endian hosts are not supported");
+    }
+
+    this->_data = mapFile(path, this->_length);
+
+    CatalogFileHeader header{};
+    std::memcpy(&header, this->_data, sizeof(header));
+    std::string error;
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = "is not a star catalog";
+    } else if (header.version != VERSION) {
+        error = "has unsupported version " + std::to_string(header.version);
+    } else if (header.headerChecksum != checksum(this->_data, offsetof(CatalogFileHeader, headerChecksum))) {
+        error = "has corrupted header";
+    } else if (header.columns != COLUMNS) {
+        error = "has unexpected column count";
+    } else {
+        // bounds first, so that a corrupt size or offset cannot wrap the end of column around
+        for (int column = 0; column < COLUMNS && error.empty(); column++) {
+            const std::uint64_t offset = header.offsets[column];
+            if (offset % ALIGNMENT != 0 || header.size > this->_length / sizeof(double) || offset > this->_length ||
+                columnBytes(column, static_cast<std::size_t>(header.size)) > this->_length - offset) {
+                error = "is truncated";
+            }
+        }
+    }
+    if (!error.empty()) {
+        unmapFile(this->_data, this->_length);
+        throw std::runtime_error("catalog file: " + path + " " + error);
+    }
+
+    this->_size     = header.size;
+    this->_checksum = header.checksum;
+    std::copy(header.offsets, header.offsets + COLUMNS, this->_offsets);
+}
+
+CatalogFile::~CatalogFile()
+{
+    unmapFile(this->_data, this->_length);
+}
+
+std::size_t CatalogFile::Size() const
+{
+    return this->_size;
+}
+
+bool CatalogFile::Verify() const
+{
+    std::uint64_t hash = checksum(nullptr, 0);
+    for (int column = 0; column < COLUMNS; column++) {
+        hash = checksum(this->_data + this->_offsets[column], columnBytes(column, this->_size), hash);
+    }
+    return hash == this->_checksum;
+}
+
+StarCatalog CatalogFile::ToCatalog() const
+{
+    StarCatalog catalog(this->_size);
+    std::copy(Mass(), Mass() + this->_size, catalog.Mass());
+    std::copy(Radius(), Radius() + this->_size, catalog.Radius());
+    std::copy(PhotosphereTemperature(), PhotosphereTemperature() + this->_size, catalog.PhotosphereTemperature());
+    std::copy(Parallax(), Parallax() + this->_size, catalog.Parallax());
+    std::copy(RadialVelocity(), RadialVelocity() + this->_size, catalog.RadialVelocity());
+    std::copy(Vmagnitude(), Vmagnitude() + this->_size, catalog.Vmagnitude());
+    std::copy(Bmagnitude(), Bmagnitude() + this->_size, catalog.Bmagnitude());
+    std::copy(RightAscension(), RightAscension() + this->_size, catalog.RightAscension());
+    std::copy(Declination(), Declination() + this->_size, catalog.Declination());
+    std::copy(ProperMotionRa(), ProperMotionRa() + this->_size, catalog.ProperMotionRa());
+    std::copy(ProperMotionDec(), ProperMotionDec() + this->_size, catalog.ProperMotionDec());
+    std::copy(SpectralType(), SpectralType() + this->_size, catalog.SpectralType());
+    std::copy(LuminosityClass(), LuminosityClass() + this->_size, catalog.LuminosityClass());
+    return catalog;
+}
+
+const double* CatalogFile::DoubleColumn(const int column) const
+{
+    return reinterpret_cast<const double*>(this->_data + this->_offsets[column]);
+}
+
+const int* CatalogFile::IntColumn(const int column) const
+{
+    return reinterpret_cast<const int*>(this->_data + this->_offsets[column]);
+}
+
+const double* CatalogFile::Mass() const
+{
+    return DoubleColumn(0);
+}
+const double* CatalogFile::Radius() const
+{
+    return DoubleColumn(1);
+}
+const double* CatalogFile::PhotosphereTemperature() const
+{
+    return DoubleColumn(2);
+}
+const double* CatalogFile::Parallax() const
+{
+    return DoubleColumn(3);
+}
+const double* CatalogFile::RadialVelocity() const
+{
+    return DoubleColumn(4);
+}
+const double* CatalogFile::Vmagnitude() const
+{
+    return DoubleColumn(5);
+}
+const double* CatalogFile::Bmagnitude() const
+{
+    return DoubleColumn(6);
+}
+const double* CatalogFile::RightAscension() const
+{
+    return DoubleColumn(7);
+}
+const double* CatalogFile::Declination() const
+{
+    return DoubleColumn(8);
+}
+const double* CatalogFile::ProperMotionRa() const
+{
+    return DoubleColumn(9);
+}
+const double* CatalogFile::ProperMotionDec() const
+{
+    return DoubleColumn(10);
+}
+const int* CatalogFile::SpectralType() const
+{
+    return IntColumn(11);
+}
+const int* CatalogFile::LuminosityClass() const
+{
+    return IntColumn(12);
+}
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include "include/catalogreader.h"
+
+double CatalogReader::Stats::RowsPerSecond() const
+{
+    return this->seconds > 0.0 ? static_cast<double>(this->rows) / this->seconds : 0.0;
+}
+
+CatalogReader::CatalogReader(const CatalogFormat& format, const unsigned threads, const std::size_t chunkBytes)
+    : _format(format), _threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      _chunkBytes(std::max<std::size_t>(chunkBytes, 1))
+{
+}
+
+static std::string_view trim(std::string_view field)
+{
+    while (!field.empty() && (field.front() == ' ' || field.front() == '\t')) {
+        field.remove_prefix(1);
+    }
+    while (!field.empty() && (field.back() == ' ' || field.back() == '\t')) {
+        field.remove_suffix(1);
+    }
+    return field;
+}
+
+/**
+ * Parses number field, empty field is zero
+ */
+static bool parseNumber(std::string_view field, double& value)
+{
+    field = trim(field);
+    value = 0.0;
+    if (field.empty()) {
+        return true;
+    }
+    if (field.front() == '+') {
+        field.remove_prefix(1);
+    }
+    const std::from_chars_result result = std::from_chars(field.data(), field.data() + field.size(), value);
+    return result.ec == std::errc() && result.ptr == field.data() + field.size();
+}
+
+bool CatalogReader::ParseLine(std::string_view line, StarCatalog& batch) const
+{
+    std::string_view fields[CatalogFormat::FieldCount];
+
+    if (this->_format.delimited) {
+        // split once and pick requested columns
+        int index = 0;
+        for (std::size_t begin = 0;; index++) {
+            const std::size_t end       = line.find(this->_format.delimiter, begin);
+            const std::string_view cell = line.substr(begin, end == std::string_view::npos ? end : end - begin);
+            for (int field = 0; field < CatalogFormat::FieldCount; field++) {
+                if (this->_format.column[field] == index) {
+                    fields[field] = cell;
+                }
+            }
+            if (end == std::string_view::npos) {
+                break;
+            }
+            begin = end + 1;
+        }
+    } else {
+        for (int field = 0; field < CatalogFormat::FieldCount; field++) {
+            if (this->_format.width[field] > 0 && this->_format.start[field] < line.size()) {
+                fields[field] = line.substr(this->_format.start[field], this->_format.width[field]);
+            }
+        }
+    }
+
+    double values[CatalogFormat::Spectrum];
+    for (int field = 0; field < CatalogFormat::Spectrum; field++) {
+        if (!parseNumber(fields[field], values[field])) {
+            return false;
+        }
+    }
+
+    const std::size_t i = batch.Size();
+    batch.Resize(i + 1);
+    batch.Mass()[i]                   = values[CatalogFormat::Mass];
+    batch.Radius()[i]                 = values[CatalogFormat::Radius];
+    batch.PhotosphereTemperature()[i] = values[CatalogFormat::PhotosphereTemperature];
+    batch.Parallax()[i]               = values[CatalogFormat::Parallax];
+    batch.RadialVelocity()[i]         = values[CatalogFormat::RadialVelocity];
+    batch.Vmagnitude()[i]             = values[CatalogFormat::Vmagnitude];
+    batch.Bmagnitude()[i]             = values[CatalogFormat::Bmagnitude];
+    batch.RightAscension()[i]         = values[CatalogFormat::RightAscension];
+    batch.Declination()[i]            = values[CatalogFormat::Declination];
+    batch.ProperMotionRa()[i]         = values[CatalogFormat::ProperMotionRa];
+    batch.ProperMotionDec()[i]        = values[CatalogFormat::ProperMotionDec];
+    Star::parseSpectrum(trim(fields[CatalogFormat::Spectrum]), batch.SpectralType()[i], batch.LuminosityClass()[i]);
+    return true;
+}
+
+std::size_t CatalogReader::ParseChunk(const std::string& chunk, StarCatalog& batch) const
+{
+    std::size_t malformed = 0;
+
+    batch.Reserve(static_cast<std::size_t>(std::count(chunk.begin(), chunk.end(), '\n')) + 1);
+    for (std::size_t begin = 0; begin < chunk.size();) {
+        std::size_t end = chunk.find('\n', begin);
+        if (end == std::string::npos) {
+            end = chunk.size();
+        }
+        std::string_view line(chunk.data() + begin, end - begin);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (!line.empty() && line.front() != this->_format.comment && !ParseLine(line, batch)) {
+            malformed++;
+        }
+        begin = end + 1;
+    }
+
+    return malformed;
+}
+
+CatalogReader::Stats CatalogReader::Read(std::istream& input,
+                                         const std::function<void(StarCatalog& batch)>& consumer) const
+{
+    struct Parsed
+    {
+        StarCatalog batch;
+        std::size_t malformed;
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    Stats stats;
+    std::deque<std::future<Parsed>> inflight;
+
+    const auto emit = [&stats, &inflight, &consumer] {
+        Parsed parsed = inflight.front().get();
+        inflight.pop_front();
+        stats.rows += parsed.batch.Size();
+        stats.malformed += parsed.malformed;
+        consumer(parsed.batch);
+    };
+
+    std::string line;
+    for (std::size_t skipped = 0; skipped < this->_format.skipLines && std::getline(input, line); skipped++) {
+        stats.bytes += line.size() + 1;
+    }
+
+    std::string carry;
+    while (input) {
+        // read next block and cut it after its last line end, the rest is carried to the next chunk
+        std::string chunk = std::move(carry);
+        carry.clear();
+        const std::size_t used = chunk.size();
+        chunk.resize(used + this->_chunkBytes);
+        input.read(chunk.data() + used, static_cast<std::streamsize>(this->_chunkBytes));
+        chunk.resize(used + static_cast<std::size_t>(input.gcount()));
+        stats.bytes += static_cast<std::size_t>(input.gcount());
+
+        if (input) {
+            const std::size_t last = chunk.rfind('\n');
+            if (last == std::string::npos) {
+                carry = std::move(chunk);
+                continue;
+            }
+            carry.assign(chunk, last + 1, std::string::npos);
+            chunk.resize(last + 1);
+        }
+
+        if (inflight.size() >= this->_threads) {
+            emit();
+        }
+        inflight.push_back(std::async(std::launch::async, [this, chunk = std::move(chunk)] {
+            Parsed parsed{};
+            parsed.malformed = ParseChunk(chunk, parsed.batch);
+            return parsed;
+        }));
+    }
+    while (!inflight.empty()) {
+        emit();
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+CatalogReader::Stats CatalogReader::Read(const std::string& path, StarCatalog& catalog) const
+{
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("catalog reader: cannot open " + path);
+    }
+    return Read(input, [&catalog](StarCatalog& batch) { catalog.Append(batch); });
+}
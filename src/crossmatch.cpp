@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <cmath>
+#include "include/constants.h"
+#include "include/crossmatch.h"
+#include "include/instrument.h"
+#include "include/skyindex.h"
+
+/**
+ * stars of the first set matched by one task
+ */
+static constexpr std::size_t CHUNK = 65536;
+/**
+ * fewest stars of the second set per zone on average, bounds zone table size for tiny radii
+ */
+static constexpr std::size_t ZONE_STARS = 16;
+
+static constexpr double RADIAN = PI_NUMBER / 180.0;
+
+/**
+ * Star of the second set in zone order
+ */
+struct ZoneStar
+{
+    double v[3]{};
+    std::size_t index = 0;
+};
+
+/**
+ * Second star set split into declination zones, zone z holds stars[offsets[z], offsets[z + 1]) sorted by right
+ * ascension ra in [0, 360), which is kept apart so that window searches touch few cache lines. Window half-width
+ * alpha[z] bounds right ascension difference of stars within radius from any star of zone z, 180 means the whole
+ * circle.
+ */
+struct Zones
+{
+    double height = 0.0;
+    std::vector<std::size_t> offsets{};
+    std::vector<double> alpha{};
+    std::vector<double> ra{};
+    std::vector<ZoneStar> stars{};
+
+    [[nodiscard]] std::size_t Count() const
+    {
+        return this->alpha.size();
+    }
+    [[nodiscard]] std::size_t Zone(const double dec) const
+    {
+        const double zone = std::floor((dec + 90.0) / this->height);
+        return static_cast<std::size_t>(std::clamp(zone, 0.0, static_cast<double>(Count() - 1)));
+    }
+};
+
+static double normalizeRa(const double ra)
+{
+    if (ra >= 0.0 && ra < 360.0) {
+        return ra;
+    }
+    const double wrapped = std::fmod(ra, 360.0);
+    return wrapped < 0.0 ? wrapped + 360.0 : wrapped;
+}
+
+static Zones buildZones(const double* ra, const double* dec, const std::size_t n, const double radius, ThreadPool& pool)
+{
+    Zones zones;
+    // rounded down, so that zones are never lower than radius and the circle reaches at most the adjacent ones
+    const double wanted = std::floor(180.0 / std::max(radius, 1e-12));
+    const double count  = std::clamp(wanted, 1.0, static_cast<double>(std::max<std::size_t>(n / ZONE_STARS, 1)));
+    zones.height        = 180.0 / count;
+    zones.alpha.resize(static_cast<std::size_t>(count));
+
+    // a star at declination d sees stars within r at right ascension difference up to asin(sin r / cos d)
+    for (std::size_t z = 0; z < zones.Count(); z++) {
+        const double lo    = -90.0 + zones.height * static_cast<double>(z);
+        const double worst = std::max(std::fabs(lo), std::fabs(lo + zones.height));
+        if (radius >= 90.0 || worst + radius >= 90.0) {
+            zones.alpha[z] = 180.0;
+        } else {
+            const double sine = std::sin(radius * RADIAN) / std::cos(worst * RADIAN);
+            zones.alpha[z]    = sine >= 1.0 ? 180.0 : std::asin(sine) / RADIAN * (1.0 + 1e-9) + 1e-9;
+        }
+    }
+
+    // positions are converted in input order and scattered to zones once, zones are then sorted independently
+    struct Sorted
+    {
+        double ra = 0.0;
+        ZoneStar star{};
+    };
+    std::vector<std::size_t> zone(n);
+    std::vector<Sorted> converted(n);
+    pool.ParallelFor(0, n, CHUNK, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            if (std::isfinite(ra[i]) && std::isfinite(dec[i])) {
+                zone[i]                 = zones.Zone(dec[i]);
+                converted[i].ra         = normalizeRa(ra[i]);
+                converted[i].star.index = i;
+                SkyIndex::UnitVector(ra[i], dec[i], converted[i].star.v);
+            } else {
+                zone[i] = zones.Count();
+            }
+        }
+    });
+    zones.offsets.assign(zones.Count() + 2, 0);
+    for (std::size_t i = 0; i < n; i++) {
+        zones.offsets[zone[i] + 1]++;
+    }
+    for (std::size_t z = 0; z <= zones.Count(); z++) {
+        zones.offsets[z + 1] += zones.offsets[z];
+    }
+    std::vector<Sorted> sorted(zones.offsets[zones.Count()]);
+    std::vector<std::size_t> cursor(zones.offsets.begin(), zones.offsets.end() - 1);
+    for (std::size_t i = 0; i < n; i++) {
+        if (zone[i] < zones.Count()) {
+            sorted[cursor[zone[i]]++] = converted[i];
+        }
+    }
+    zones.offsets.pop_back();
+    std::vector<Sorted>().swap(converted);
+
+    zones.ra.resize(sorted.size());
+    zones.stars.resize(sorted.size());
+    const std::size_t grain = std::max<std::size_t>(1, zones.Count() / (16 * pool.Concurrency()));
+    pool.ParallelFor(0, zones.Count(), grain, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t z = begin; z < end; z++) {
+            std::sort(sorted.begin() + static_cast<std::ptrdiff_t>(zones.offsets[z]),
+                      sorted.begin() + static_cast<std::ptrdiff_t>(zones.offsets[z + 1]),
+                      [](const Sorted& a, const Sorted& b) {
+                          return a.ra < b.ra || (a.ra == b.ra && a.star.index < b.star.index);
+                      });
+        }
+        for (std::size_t j = zones.offsets[begin]; j < zones.offsets[end]; j++) {
+            zones.ra[j]    = sorted[j].ra;
+            zones.stars[j] = sorted[j].star;
+        }
+    });
+    return zones;
+}
+
+/**
+ * Calls visit(star) for stars of zone z with right ascension in [lo, hi], 0 <= lo and hi < 360
+ */
+template <class Visit>
+static void visitWindow(const Zones& zones, const std::size_t z, const double lo, const double hi, Visit& visit)
+{
+    const double* first = zones.ra.data() + zones.offsets[z];
+    const double* last  = zones.ra.data() + zones.offsets[z + 1];
+    for (const double* ra = std::lower_bound(first, last, lo); ra != last && *ra <= hi; ++ra) {
+        visit(zones.stars[static_cast<std::size_t>(ra - zones.ra.data())]);
+    }
+}
+
+CrossMatcher::CrossMatcher(const double radius, ThreadPool& pool) : _radius(radius), _pool(pool)
+{
+}
+
+std::vector<CrossMatch> CrossMatcher::Match(const double* ra1, const double* dec1, const std::size_t n1,
+                                            const double* ra2, const double* dec2, const std::size_t n2,
+                                            const bool best) const
+{
+    ASTROLIB_PROBE(CrossMatch, n1);
+    if (!(this->_radius >= 0.0) || n1 == 0 || n2 == 0) {
+        return {};
+    }
+    const Zones zones   = buildZones(ra2, dec2, n2, this->_radius, this->_pool);
+    const double chord2 = SkyIndex::ChordSquared(this->_radius);
+
+    std::vector<std::vector<CrossMatch>> chunks((n1 + CHUNK - 1) / CHUNK);
+    this->_pool.ParallelFor(0, chunks.size(), 1, [&](const std::size_t begin, const std::size_t end) {
+        // stars of a chunk are visited in zone order, so that the second set is read in memory order
+        thread_local std::vector<std::pair<std::size_t, std::size_t>> order;
+        for (std::size_t c = begin; c < end; c++) {
+            order.clear();
+            for (std::size_t i = c * CHUNK; i < std::min(n1, (c + 1) * CHUNK); i++) {
+                if (std::isfinite(ra1[i]) && std::isfinite(dec1[i])) {
+                    order.emplace_back(zones.Zone(dec1[i]), i);
+                }
+            }
+            std::sort(order.begin(), order.end());
+
+            // separation holds squared chord length until the chunk is complete
+            std::vector<CrossMatch>& out = chunks[c];
+            for (const auto& [zone, i] : order) {
+                double q[3];
+                SkyIndex::UnitVector(ra1[i], dec1[i], q);
+                CrossMatch nearest{i, 0, INFINITY};
+                const auto visit = [&, i = i](const ZoneStar& star) {
+                    const double dx = star.v[0] - q[0];
+                    const double dy = star.v[1] - q[1];
+                    const double dz = star.v[2] - q[2];
+                    const double d2 = dx * dx + dy * dy + dz * dz;
+                    if (d2 > chord2) {
+                        return;
+                    }
+                    if (!best) {
+                        out.push_back({i, star.index, d2});
+                    } else if (d2 < nearest.separation || (d2 == nearest.separation && star.index < nearest.second)) {
+                        nearest.second     = star.index;
+                        nearest.separation = d2;
+                    }
+                };
+
+                // neighbour zones are searched only if the circle reaches them
+                const double ra    = normalizeRa(ra1[i]);
+                const double alpha = zones.alpha[zone];
+                const double lo    = -90.0 + zones.height * static_cast<double>(zone);
+                const bool below   = zone > 0 && dec1[i] - this->_radius <= lo;
+                const bool above   = zone + 1 < zones.Count() && dec1[i] + this->_radius >= lo + zones.height;
+                for (std::size_t z = below ? zone - 1 : zone; z <= (above ? zone + 1 : zone); z++) {
+                    if (alpha >= 180.0) {
+                        visitWindow(zones, z, 0.0, 360.0, visit);
+                    } else if (ra - alpha < 0.0) {
+                        visitWindow(zones, z, ra - alpha + 360.0, 360.0, visit);
+                        visitWindow(zones, z, 0.0, ra + alpha, visit);
+                    } else if (ra + alpha >= 360.0) {
+                        visitWindow(zones, z, ra - alpha, 360.0, visit);
+                        visitWindow(zones, z, 0.0, ra + alpha - 360.0, visit);
+                    } else {
+                        visitWindow(zones, z, ra - alpha, ra + alpha, visit);
+                    }
+                }
+                if (best && std::isfinite(nearest.separation)) {
+                    out.push_back(nearest);
+                }
+            }
+
+            std::sort(out.begin(), out.end(), [](const CrossMatch& a, const CrossMatch& b) {
+                if (a.first != b.first) {
+                    return a.first < b.first;
+                }
+                return a.separation < b.separation || (a.separation == b.separation && a.second < b.second);
+            });
+            for (CrossMatch& match : out) {
+                match.separation = 2.0 * std::asin(std::min(0.5 * std::sqrt(match.separation), 1.0)) / RADIAN;
+            }
+        }
+    });
+
+    std::size_t total = 0;
+    for (const std::vector<CrossMatch>& chunk : chunks) {
+        total += chunk.size();
+    }
+    std::vector<CrossMatch> matches;
+    matches.reserve(total);
+    for (std::vector<CrossMatch>& chunk : chunks) {
+        matches.insert(matches.end(), chunk.begin(), chunk.end());
+        std::vector<CrossMatch>().swap(chunk);
+    }
+    return matches;
+}
+
+std::vector<CrossMatch> CrossMatcher::Best(const double* ra1, const double* dec1, const std::size_t n1,
+                                           const double* ra2, const double* dec2, const std::size_t n2) const
+{
+    return Match(ra1, dec1, n1, ra2, dec2, n2, true);
+}
+
+std::vector<CrossMatch> CrossMatcher::Best(const StarCatalog& first, const StarCatalog& second) const
+{
+    return Best(first.RightAscension(), first.Declination(), first.Size(), second.RightAscension(),
+                second.Declination(), second.Size());
+}
+
+std::vector<CrossMatch> CrossMatcher::All(const double* ra1, const double* dec1, const std::size_t n1,
+                                          const double* ra2, const double* dec2, const std::size_t n2) const
+{
+    return Match(ra1, dec1, n1, ra2, dec2, n2, false);
+}
+
+std::vector<CrossMatch> CrossMatcher::All(const StarCatalog& first, const StarCatalog& second) const
+{
+    return All(first.RightAscension(), first.Declination(), first.Size(), second.RightAscension(),
+               second.Declination(), second.Size());
+}
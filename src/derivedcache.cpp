@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <cmath>
+#include "include/derivedcache.h"
+#include "include/instrument.h"
+#include "include/starbatch.h"
+
+/**
+ * stars gathered into one batch call, sized so that the gathered inputs stay in L1 cache
+ */
+static constexpr std::size_t BLOCK = 512;
+/**
+ * a column is recomputed whole once more than one in FULL_REFRESH of its stars are marked, then a contiguous pass is
+ * cheaper than gathering the marked ones
+ */
+static constexpr std::size_t FULL_REFRESH = 4;
+
+static constexpr unsigned bit(const DerivedCache::Column column)
+{
+    return 1u << column;
+}
+static constexpr unsigned ALL_COLUMNS = (1u << DerivedCache::ColumnCount) - 1;
+
+DerivedCache::DerivedCache(StarCatalog& catalog)
+    : _catalog(catalog), _dirty(catalog.Size(), 0)
+{
+}
+
+/**
+ * Follows catalog size changes, stars appended are marked in every computed column, a shrunk catalog drops all
+ */
+void DerivedCache::Sync()
+{
+    const std::size_t size = this->_catalog.Size();
+    const std::size_t rows = this->_dirty.size();
+    if (size < rows) {
+        Invalidate();
+    } else if (size > rows) {
+        this->_dirty.resize(size, 0);
+        for (std::size_t index = rows; index < size; index++) {
+            Mark(index, ALL_COLUMNS);
+        }
+    }
+}
+
+void DerivedCache::Mark(const std::size_t index, const unsigned columns)
+{
+    for (int column = 0; column < ColumnCount; column++) {
+        const unsigned flag = bit(static_cast<Column>(column));
+        if ((columns & flag) && this->_valid[column] && !(this->_dirty[index] & flag)) {
+            this->_dirty[index] |= flag;
+            this->_pending[column].push_back(index);
+        }
+    }
+}
+
+void DerivedCache::Refresh(const Column column)
+{
+    Sync();
+    std::vector<std::size_t>& pending = this->_pending[column];
+    if (this->_valid[column] && pending.empty()) {
+        return;
+    }
+    if (column == Radius) {
+        Refresh(BolometricCorrection);
+    }
+    const std::size_t size = this->_catalog.Size();
+    this->_columns[column].resize(size);
+    if (!this->_valid[column] || pending.size() > size / FULL_REFRESH) {
+        Compute(column, nullptr, size);
+        this->_recomputed[column] += size;
+        this->_valid[column] = true;
+    } else {
+        Compute(column, pending.data(), pending.size());
+        this->_recomputed[column] += pending.size();
+    }
+    for (const std::size_t index : pending) {
+        this->_dirty[index] &= ~bit(column);
+    }
+    pending.clear();
+}
+
+/**
+ * Computes column for stars rows[0, n), or for stars [0, n) if rows is null
+ */
+void DerivedCache::Compute(const Column column, const std::size_t* rows, const std::size_t n)
+{
+    ASTROLIB_PROBE(DerivedRefresh, n);
+    const StarCatalog& catalog = this->_catalog;
+    double* values             = this->_columns[column].data();
+    const double* bc           = this->_columns[BolometricCorrection].data();
+    double a[BLOCK], b[BLOCK], out[BLOCK];
+    int lumclass[BLOCK];
+
+    for (std::size_t first = 0; first < n; first += BLOCK) {
+        const std::size_t m = std::min(BLOCK, n - first);
+        const auto row      = [rows, first](const std::size_t k) { return rows ? rows[first + k] : first + k; };
+
+        switch (column) {
+            case Luminosity:
+                for (std::size_t k = 0; k < m; k++) {
+                    a[k] = catalog.Radius()[row(k)];
+                    b[k] = catalog.PhotosphereTemperature()[row(k)];
+                }
+                StarBatch::Luminosity(a, b, out, m);
+                break;
+            case BolometricCorrection:
+                for (std::size_t k = 0; k < m; k++) {
+                    a[k] = catalog.PhotosphereTemperature()[row(k)];
+                }
+                StarBatch::bolometricCorrection(a, out, m);
+                break;
+            case ColorTemperature:
+                for (std::size_t k = 0; k < m; k++) {
+                    a[k]        = catalog.Bmagnitude()[row(k)] - catalog.Vmagnitude()[row(k)];
+                    lumclass[k] = catalog.LuminosityClass()[row(k)];
+                }
+                StarBatch::colorTemperature(a, lumclass, out, m);
+                break;
+            default:
+                for (std::size_t k = 0; k < m; k++) {
+                    const double parallax = catalog.Parallax()[row(k)];
+                    a[k]                  = parallax > 0.0 ? 1.0 / parallax : INFINITY;
+                    b[k]                  = catalog.Vmagnitude()[row(k)];
+                }
+                StarBatch::absoluteMagnitude(b, a, a, m);
+                for (std::size_t k = 0; k < m; k++) {
+                    b[k] = bc[row(k)];
+                }
+                StarBatch::luminosity(a, b, a, m);
+                for (std::size_t k = 0; k < m; k++) {
+                    b[k] = catalog.PhotosphereTemperature()[row(k)];
+                }
+                StarBatch::radius(a, b, out, m);
+                break;
+        }
+        for (std::size_t k = 0; k < m; k++) {
+            values[row(k)] = out[k];
+        }
+    }
+}
+
+const double* DerivedCache::Get(const Column column)
+{
+    Refresh(column);
+    return this->_columns[column].data();
+}
+
+double DerivedCache::Get(const Column column, const std::size_t index)
+{
+    return Get(column)[index];
+}
+
+void DerivedCache::SetRadius(const std::size_t index, const double radius)
+{
+    Sync();
+    this->_catalog.Radius()[index] = radius;
+    Mark(index, bit(Luminosity));
+}
+
+void DerivedCache::SetPhotosphereTemperature(const std::size_t index, const double photosphereTemperature)
+{
+    Sync();
+    this->_catalog.PhotosphereTemperature()[index] = photosphereTemperature;
+    Mark(index, bit(Luminosity) | bit(BolometricCorrection) | bit(Radius));
+}
+
+void DerivedCache::SetMass(const std::size_t index, const double mass)
+{
+    Sync();
+    this->_catalog.Mass()[index] = mass;
+}
+
+void DerivedCache::SetParallax(const std::size_t index, const double parallax)
+{
+    Sync();
+    this->_catalog.Parallax()[index] = parallax;
+    Mark(index, bit(Radius));
+}
+
+void DerivedCache::SetVmagnitude(const std::size_t index, const double Vmagnitude)
+{
+    Sync();
+    this->_catalog.Vmagnitude()[index] = Vmagnitude;
+    Mark(index, bit(ColorTemperature) | bit(Radius));
+}
+
+void DerivedCache::SetBmagnitude(const std::size_t index, const double Bmagnitude)
+{
+    Sync();
+    this->_catalog.Bmagnitude()[index] = Bmagnitude;
+    Mark(index, bit(ColorTemperature));
+}
+
+void DerivedCache::SetLuminosityClass(const std::size_t index, const int lumclass)
+{
+    Sync();
+    this->_catalog.LuminosityClass()[index] = lumclass;
+    Mark(index, bit(ColorTemperature));
+}
+
+void DerivedCache::Set(const std::size_t index, const Star& star)
+{
+    Sync();
+    this->_catalog.Set(index, star);
+    Mark(index, ALL_COLUMNS);
+}
+
+void DerivedCache::Invalidate(const std::size_t index)
+{
+    Sync();
+    Mark(index, ALL_COLUMNS);
+}
+
+void DerivedCache::Invalidate()
+{
+    for (int column = 0; column < ColumnCount; column++) {
+        this->_valid[column] = false;
+        this->_pending[column].clear();
+    }
+    this->_dirty.assign(this->_catalog.Size(), 0);
+}
+
+std::size_t DerivedCache::Recomputed(const Column column) const
+{
+    return this->_recomputed[column];
+}
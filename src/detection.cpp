@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include "include/detection.h"
+
+static constexpr std::size_t NONE = static_cast<std::size_t>(-1);
+
+/**
+ * Root of union-find tree with path halving
+ */
+static std::size_t findRoot(std::vector<std::size_t>& parent, std::size_t i)
+{
+    while (parent[i] != i) {
+        i = parent[i] = parent[parent[i]];
+    }
+    return i;
+}
+
+/**
+ * Joins trees of a and b, the smaller root wins so that labels follow scan order
+ */
+static void unite(std::vector<std::size_t>& parent, const std::size_t a, const std::size_t b)
+{
+    const std::size_t ra = findRoot(parent, a);
+    const std::size_t rb = findRoot(parent, b);
+    if (ra < rb) {
+        parent[rb] = ra;
+    } else {
+        parent[ra] = rb;
+    }
+}
+
+/**
+ * Calls join(i, j) for every run i of upper and run j of lower which touch diagonally or share a column, both rows
+ * sorted by column
+ */
+template <class Runs, class Join>
+static void touchingRuns(const Runs& upper, const std::size_t upperBegin, const std::size_t upperEnd,
+                         const Runs& lower, const std::size_t lowerBegin, const std::size_t lowerEnd, Join join)
+{
+    std::size_t first = upperBegin;
+    for (std::size_t j = lowerBegin; j < lowerEnd; j++) {
+        while (first < upperEnd && upper[first].end + 1 < lower[j].begin) {
+            first++;
+        }
+        for (std::size_t i = first; i < upperEnd && upper[i].begin <= lower[j].end + 1; i++) {
+            join(i, j);
+        }
+    }
+}
+
+void StarDetector::Moments::Add(const Moments& other)
+{
+    flux += other.flux;
+    sumX += other.sumX;
+    sumY += other.sumY;
+    sumXX += other.sumXX;
+    sumYY += other.sumYY;
+    pixels += other.pixels;
+    if (other.peak > peak) {
+        peak       = other.peak;
+        background = other.background;
+    }
+}
+
+StarDetector::StarDetector(const double thresholdSigma, const std::size_t minPixels, const std::size_t stripRows,
+                           const std::size_t backgroundCell, const double beta, ThreadPool& pool)
+    : _thresholdSigma(thresholdSigma), _minPixels(minPixels), _stripRows(std::max<std::size_t>(stripRows, 1)),
+      _backgroundCell(std::max<std::size_t>(backgroundCell, 1)), _beta(beta), _pool(pool)
+{
+}
+
+StarDetector::Strip StarDetector::Label(const float* rows, const std::size_t count, const std::size_t firstRow) const
+{
+    const std::size_t width  = this->_width;
+    const std::size_t cell   = this->_backgroundCell;
+    const std::size_t blocks = (width + cell - 1) / cell;
+
+    // background as median and noise as 1.4826 median absolute deviation, which equals sigma of normal noise
+    thread_local std::vector<float> sample;
+    std::vector<float> background(blocks), threshold(blocks);
+    for (std::size_t b = 0; b < blocks; b++) {
+        sample.clear();
+        for (std::size_t r = 0; r < count; r++) {
+            const float* row = rows + r * width;
+            sample.insert(sample.end(), row + b * cell, row + std::min(width, (b + 1) * cell));
+        }
+        const auto middle = sample.begin() + sample.size() / 2;
+        std::nth_element(sample.begin(), middle, sample.end());
+        const float median = *middle;
+        for (float& value : sample) {
+            value = std::fabs(value - median);
+        }
+        std::nth_element(sample.begin(), middle, sample.end());
+        background[b] = median;
+        threshold[b]  = static_cast<float>(median + this->_thresholdSigma * 1.4826 * *middle);
+    }
+
+    std::vector<Run> runs;
+    std::vector<Moments> moments;
+    std::vector<std::size_t> parent;
+    std::size_t previousBegin = 0, previousEnd = 0, topEnd = 0;
+    for (std::size_t r = 0; r < count; r++) {
+        const float* row           = rows + r * width;
+        const double y             = static_cast<double>(firstRow + r);
+        const std::size_t rowBegin = runs.size();
+        for (std::size_t c = 0; c < width;) {
+            if (!(row[c] > threshold[c / cell])) {
+                c++;
+                continue;
+            }
+            Run run;
+            Moments m;
+            run.begin = c;
+            for (; c < width && row[c] > threshold[c / cell]; c++) {
+                const double w = row[c] - background[c / cell];
+                const double x = static_cast<double>(c);
+                m.flux += w;
+                m.sumX += w * x;
+                m.sumY += w * y;
+                m.sumXX += w * x * x;
+                m.sumYY += w * y * y;
+                m.pixels++;
+                if (w > m.peak) {
+                    m.peak       = w;
+                    m.background = background[c / cell];
+                }
+            }
+            run.end = c - 1;
+            parent.push_back(runs.size());
+            runs.push_back(run);
+            moments.push_back(m);
+        }
+        touchingRuns(runs, previousBegin, previousEnd, runs, rowBegin, runs.size(),
+                     [&parent](const std::size_t i, const std::size_t j) { unite(parent, i, j); });
+        previousBegin = rowBegin;
+        previousEnd   = runs.size();
+        topEnd        = r == 0 ? runs.size() : topEnd;
+    }
+
+    Strip strip;
+    std::vector<std::size_t> label(runs.size(), NONE);
+    for (std::size_t i = 0; i < runs.size(); i++) {
+        const std::size_t root = findRoot(parent, i);
+        if (label[root] == NONE) {
+            label[root] = strip.components.size();
+            strip.components.emplace_back();
+        }
+        runs[i].component = label[root];
+        strip.components[label[root]].Add(moments[i]);
+    }
+    strip.top.assign(runs.begin(), runs.begin() + static_cast<std::ptrdiff_t>(topEnd));
+    strip.bottom.assign(runs.begin() + static_cast<std::ptrdiff_t>(previousBegin), runs.end());
+    return strip;
+}
+
+void StarDetector::Merge(Strip& strip)
+{
+    const std::size_t open  = this->_open.size();
+    const std::size_t nodes = open + strip.components.size();
+    std::vector<std::size_t> parent(nodes);
+    std::iota(parent.begin(), parent.end(), 0);
+    touchingRuns(this->_openRuns, 0, this->_openRuns.size(), strip.top, 0, strip.top.size(),
+                 [&](const std::size_t i, const std::size_t j) {
+                     unite(parent, this->_openRuns[i].component, open + strip.top[j].component);
+                 });
+
+    std::vector<std::size_t> group(nodes, NONE);
+    std::vector<Moments> merged;
+    for (std::size_t node = 0; node < nodes; node++) {
+        const std::size_t root = findRoot(parent, node);
+        if (group[root] == NONE) {
+            group[root] = merged.size();
+            merged.emplace_back();
+        }
+        merged[group[root]].Add(node < open ? this->_open[node] : strip.components[node - open]);
+    }
+
+    // groups reaching the last row of the strip may continue in the next one, the rest are complete
+    std::vector<std::size_t> next(merged.size(), NONE);
+    for (const Run& run : strip.bottom) {
+        next[group[findRoot(parent, open + run.component)]] = 0;
+    }
+    this->_open.clear();
+    for (std::size_t g = 0; g < merged.size(); g++) {
+        if (next[g] == NONE) {
+            Emit(merged[g]);
+        } else {
+            next[g] = this->_open.size();
+            this->_open.push_back(merged[g]);
+        }
+    }
+    this->_openRuns = std::move(strip.bottom);
+    for (Run& run : this->_openRuns) {
+        run.component = next[group[findRoot(parent, open + run.component)]];
+    }
+}
+
+void StarDetector::Emit(const Moments& moments)
+{
+    if (moments.pixels < this->_minPixels || !(moments.flux > 0.0)) {
+        return;
+    }
+    DetectedSource source;
+    source.x      = moments.sumX / moments.flux;
+    source.y      = moments.sumY / moments.flux;
+    source.flux   = moments.flux;
+    source.pixels = moments.pixels;
+
+    // second moment of a single pixel is 1/12, Moffat width follows from full width at half maximum 2.3548 sigma
+    const double varianceX = moments.sumXX / moments.flux - source.x * source.x;
+    const double varianceY = moments.sumYY / moments.flux - source.y * source.y;
+    const double sigma     = std::sqrt(std::max(0.5 * (varianceX + varianceY), 1.0 / 12.0));
+
+    source.moffat.x          = source.x;
+    source.moffat.y          = source.y;
+    source.moffat.peak       = moments.peak;
+    source.moffat.beta       = this->_beta;
+    source.moffat.width      = 1.1774100225154747 * sigma / std::sqrt(std::pow(2.0, 1.0 / this->_beta) - 1.0);
+    source.moffat.background = moments.background;
+    this->_sources.push_back(source);
+}
+
+void StarDetector::Process(const float* rows, const std::size_t count)
+{
+    const std::size_t stripRows = this->_stripRows;
+    std::vector<Strip> strips((count + stripRows - 1) / stripRows);
+    this->_pool.ParallelFor(0, strips.size(), 1, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t s = begin; s < end; s++) {
+            const std::size_t first = s * stripRows;
+            strips[s] = Label(rows + first * this->_width, std::min(stripRows, count - first), this->_rows + first);
+        }
+    });
+    for (Strip& strip : strips) {
+        Merge(strip);
+    }
+    this->_rows += count;
+}
+
+void StarDetector::Begin(const std::size_t width)
+{
+    this->_width = width;
+    this->_rows  = 0;
+    this->_pending.clear();
+    this->_open.clear();
+    this->_openRuns.clear();
+    this->_sources.clear();
+}
+
+void StarDetector::Push(const float* rows, const std::size_t count)
+{
+    if (this->_width == 0) {
+        return;
+    }
+    this->_pending.insert(this->_pending.end(), rows, rows + count * this->_width);
+
+    const std::size_t batch   = this->_stripRows * this->_pool.Concurrency();
+    const std::size_t pending = this->_pending.size() / this->_width;
+    const std::size_t ready   = pending / batch * batch;
+    if (ready > 0) {
+        Process(this->_pending.data(), ready);
+        this->_pending.erase(this->_pending.begin(),
+                             this->_pending.begin() + static_cast<std::ptrdiff_t>(ready * this->_width));
+    }
+}
+
+std::vector<DetectedSource> StarDetector::Finish()
+{
+    if (this->_width > 0 && !this->_pending.empty()) {
+        Process(this->_pending.data(), this->_pending.size() / this->_width);
+        this->_pending.clear();
+    }
+    for (const Moments& moments : this->_open) {
+        Emit(moments);
+    }
+    this->_open.clear();
+    this->_openRuns.clear();
+    return std::move(this->_sources);
+}
+
+std::vector<DetectedSource> StarDetector::Detect(const float* image, const std::size_t width, const std::size_t height)
+{
+    Begin(width);
+    const std::size_t batch = this->_stripRows * this->_pool.Concurrency();
+    for (std::size_t row = 0; row < height && width > 0; row += batch) {
+        Process(image + row * width, std::min(batch, height - row));
+    }
+    return Finish();
+}
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cmath>
+#include "include/constants.h"
+#include "include/epoch.h"
+#include "include/instrument.h"
+#include "simd.h"
+
+/**
+ * stars propagated at once, sized so that all intermediate columns stay in L1/L2 cache
+ */
+static constexpr std::size_t BLOCK = 512;
+
+static constexpr double RADIAN         = PI_NUMBER / 180.0;
+static constexpr double MAS_PER_RADIAN = 180.0 / PI_NUMBER * 3600.0 * 1000.0;
+
+/**
+ * Columns of a block of stars between the trigonometric steps
+ */
+struct MotionBlock
+{
+    /**
+     * input: sines and cosines of right ascension and declination, proper motions in radians per year, parallax in
+     * arcseconds and radial motion in distances per year, zero if unknown
+     */
+    double sinRa[BLOCK], cosRa[BLOCK], sinDec[BLOCK], cosDec[BLOCK];
+    double pmra[BLOCK], pmdec[BLOCK], parallax[BLOCK], radial[BLOCK];
+    /**
+     * output: direction, proper motions in milliarcseconds per year, parallax, radial motion and magnitude change
+     */
+    double x[BLOCK], y[BLOCK], z[BLOCK];
+    double pmraOut[BLOCK], pmdecOut[BLOCK], parallaxOut[BLOCK], radialOut[BLOCK], magnitude[BLOCK];
+};
+
+/**
+ * Rigorous propagation of whole packs of stars [first, last) of block by t years, returns end of stars done. With
+ * direction r, tangential motion m and radial motion w the position after t years is r (1 + w t) + m t, whose
+ * length relative to the initial distance is 1 / f with f = (1 + 2 w t + (m^2 + w^2) t^2)^(-1/2).
+ */
+template <class P>
+static std::size_t motionKernel(MotionBlock& b, const std::size_t first, const std::size_t last, const double t)
+{
+    using Vec = typename P::Vec;
+    const Vec time = P::set1(t);
+    const Vec zero = P::set1(0.0);
+    const Vec one  = P::set1(1.0);
+    const Vec mas  = P::set1(MAS_PER_RADIAN);
+
+    std::size_t i = first;
+    for (; i + P::width <= last; i += P::width) {
+        const Vec sa = P::load(b.sinRa + i), ca = P::load(b.cosRa + i);
+        const Vec sd = P::load(b.sinDec + i), cd = P::load(b.cosDec + i);
+        const Vec pa = P::load(b.pmra + i), pd = P::load(b.pmdec + i);
+        const Vec w  = P::load(b.radial + i);
+
+        // direction r = (cd ca, cd sa, sd), east p = (-sa, ca, 0), north q = (-sd ca, -sd sa, cd), m = p pa + q pd
+        const Vec rx = P::mul(cd, ca), ry = P::mul(cd, sa);
+        const Vec mx = P::sub(zero, P::add(P::mul(sa, pa), P::mul(P::mul(sd, ca), pd)));
+        const Vec my = P::sub(P::mul(ca, pa), P::mul(P::mul(sd, sa), pd));
+        const Vec mz = P::mul(cd, pd);
+
+        const Vec m2    = P::add(P::mul(pa, pa), P::mul(pd, pd));
+        const Vec total = P::add(m2, P::mul(w, w));
+        const Vec grow  = P::add(one, P::mul(w, time));
+        const Vec f     = P::div(one, P::sqrt(P::add(P::add(one, P::mul(P::add(w, w), time)),
+                                                     P::mul(total, P::mul(time, time)))));
+        const Vec f3    = P::mul(f, P::mul(f, f));
+
+        const Vec ux = P::mul(P::add(P::mul(rx, grow), P::mul(mx, time)), f);
+        const Vec uy = P::mul(P::add(P::mul(ry, grow), P::mul(my, time)), f);
+        const Vec uz = P::mul(P::add(P::mul(sd, grow), P::mul(mz, time)), f);
+
+        // tangential motion at the new epoch is projected onto east and north directions there
+        const Vec back  = P::mul(m2, time);
+        const Vec nx    = P::mul(P::sub(P::mul(mx, grow), P::mul(rx, back)), f3);
+        const Vec ny    = P::mul(P::sub(P::mul(my, grow), P::mul(ry, back)), f3);
+        const Vec nz    = P::mul(P::sub(P::mul(mz, grow), P::mul(sd, back)), f3);
+        const Vec rho   = P::sqrt(P::add(P::mul(ux, ux), P::mul(uy, uy)));
+        const auto pole = P::eq(rho, zero);
+        const Vec sinA  = P::select(pole, zero, P::div(uy, rho));
+        const Vec cosA  = P::select(pole, one, P::div(ux, rho));
+        const Vec east  = P::sub(P::mul(ny, cosA), P::mul(nx, sinA));
+        const Vec north = P::sub(P::mul(nz, rho), P::mul(uz, P::add(P::mul(nx, cosA), P::mul(ny, sinA))));
+
+        // known distance scales with 1 / f, magnitude changes by -5 log10 f
+        const auto known = P::gt(P::load(b.parallax + i), zero);
+        const Vec radial = P::mul(P::add(w, P::mul(total, time)), P::mul(f, f));
+        const Vec shift  = P::mul(P::set1(-5.0 * 0.30102999566398120), log2<P>(f));
+
+        P::store(b.x + i, ux);
+        P::store(b.y + i, uy);
+        P::store(b.z + i, uz);
+        P::store(b.pmraOut + i, P::mul(east, mas));
+        P::store(b.pmdecOut + i, P::mul(north, mas));
+        P::store(b.parallaxOut + i, P::mul(P::load(b.parallax + i), P::select(known, f, one)));
+        P::store(b.radialOut + i, radial);
+        P::store(b.magnitude + i, P::select(known, shift, zero));
+    }
+    return i;
+}
+
+EpochPropagator::EpochPropagator(ThreadPool& pool, const std::size_t grain) : _pool(pool), _grain(grain)
+{
+}
+
+void EpochPropagator::Propagate(StarCatalog& catalog, const double years) const
+{
+    ASTROLIB_PROBE(EpochPropagate, catalog.Size());
+    this->_pool.ParallelFor(0, catalog.Size(), this->_grain,
+                            [this, &catalog, years](std::size_t begin, std::size_t end) {
+                                Propagate(catalog, years, begin, end);
+                            });
+}
+
+void EpochPropagator::Propagate(StarCatalog& catalog, const double years, const std::size_t begin,
+                                const std::size_t end) const
+{
+    thread_local MotionBlock block;
+    double* ra       = catalog.RightAscension();
+    double* dec      = catalog.Declination();
+    double* pmra     = catalog.ProperMotionRa();
+    double* pmdec    = catalog.ProperMotionDec();
+    double* parallax = catalog.Parallax();
+    double* radvel   = catalog.RadialVelocity();
+    double* V        = catalog.Vmagnitude();
+    double* B        = catalog.Bmagnitude();
+
+    for (std::size_t first = begin; first < end; first += BLOCK) {
+        const std::size_t n = std::min(BLOCK, end - first);
+
+        // radial motion per year in units of distance is radial velocity in light years per year over distance
+        for (std::size_t i = 0; i < n; i++) {
+            const std::size_t s = first + i;
+            block.sinRa[i]      = std::sin(ra[s] * RADIAN);
+            block.cosRa[i]      = std::cos(ra[s] * RADIAN);
+            block.sinDec[i]     = std::sin(dec[s] * RADIAN);
+            block.cosDec[i]     = std::cos(dec[s] * RADIAN);
+            block.pmra[i]       = pmra[s] / MAS_PER_RADIAN;
+            block.pmdec[i]      = pmdec[s] / MAS_PER_RADIAN;
+            block.parallax[i]   = parallax[s];
+            block.radial[i]     = parallax[s] > 0.0 && std::isfinite(radvel[s])
+                                          ? radvel[s] * parallax[s] / LIGHT_YEARS_PER_PARSEC
+                                          : 0.0;
+        }
+
+        motionKernel<ScalarPack>(block, motionKernel<NativePack>(block, 0, n, years), n, years);
+
+        for (std::size_t i = 0; i < n; i++) {
+            const std::size_t s = first + i;
+            const double alpha  = std::atan2(block.y[i], block.x[i]) / RADIAN;
+            ra[s]               = alpha < 0.0 ? alpha + 360.0 : alpha;
+            dec[s]              = std::atan2(block.z[i], std::hypot(block.x[i], block.y[i])) / RADIAN;
+            pmra[s]             = block.pmraOut[i];
+            pmdec[s]            = block.pmdecOut[i];
+            if (parallax[s] > 0.0) {
+                parallax[s] = block.parallaxOut[i];
+                if (std::isfinite(radvel[s])) {
+                    radvel[s] = block.radialOut[i] / parallax[s] * LIGHT_YEARS_PER_PARSEC;
+                }
+                V[s] += block.magnitude[i];
+                B[s] += block.magnitude[i];
+            }
+        }
+    }
+}
@@ -0,0 +1,128 @@
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include "include/faststar.h"
+
+SplineTable::SplineTable(const std::function<double(double)>& f, const double lo, const double hi,
+                         const double tolerance, const bool relative)
+    : _lo(lo), _hi(hi)
+{
+    // points between nodes where the interpolation error is checked
+    static const double probes[] = {0.125, 0.25, 0.375, 0.5, 0.625, 0.75, 0.875};
+
+    for (std::size_t intervals = 8;; intervals *= 2) {
+        const double step = (hi - lo) / static_cast<double>(intervals);
+        const double h    = step * 1e-3;
+
+        // node values and slopes per interval width, slopes from second order differences kept inside [lo, hi]
+        std::vector<double> value(intervals + 1), slope(intervals + 1);
+        for (std::size_t i = 0; i <= intervals; i++) {
+            const double x = lo + step * static_cast<double>(i);
+            value[i]       = f(x);
+            if (i == 0) {
+                slope[i] = (-3.0 * value[i] + 4.0 * f(x + h) - f(x + 2.0 * h)) / (2.0 * h) * step;
+            } else if (i == intervals) {
+                slope[i] = (3.0 * value[i] - 4.0 * f(x - h) + f(x - 2.0 * h)) / (2.0 * h) * step;
+            } else {
+                slope[i] = (f(x + h) - f(x - h)) / (2.0 * h) * step;
+            }
+        }
+
+        _scale = static_cast<double>(intervals) / (hi - lo);
+        _coef.resize(4 * intervals);
+        for (std::size_t i = 0; i < intervals; i++) {
+            const double p0 = value[i], p1 = value[i + 1];
+            const double m0 = slope[i], m1 = slope[i + 1];
+            _coef[4 * i + 0] = p0;
+            _coef[4 * i + 1] = m0;
+            _coef[4 * i + 2] = 3.0 * (p1 - p0) - 2.0 * m0 - m1;
+            _coef[4 * i + 3] = 2.0 * (p0 - p1) + m0 + m1;
+        }
+
+        double error = 0.0;
+        for (std::size_t i = 0; i < intervals; i++) {
+            for (const double probe : probes) {
+                const double x     = lo + step * (static_cast<double>(i) + probe);
+                const double exact = f(x);
+                const double diff  = std::fabs((*this)(x) - exact);
+                error              = std::fmax(error, relative ? diff / std::fabs(exact) : diff);
+            }
+        }
+        // leave half of tolerance as margin for points between probes
+        if (error <= tolerance / 2 || intervals >= (1u << 20)) {
+            break;
+        }
+    }
+}
+
+double SplineTable::Lo() const
+{
+    return this->_lo;
+}
+
+double SplineTable::Hi() const
+{
+    return this->_hi;
+}
+
+std::size_t SplineTable::Intervals() const
+{
+    return this->_coef.size() / 4;
+}
+
+bool SplineTable::Contains(const double x) const
+{
+    return x >= this->_lo && x <= this->_hi;
+}
+
+/**
+ * Returns table identified by kind and tolerance, building it with make on first request
+ */
+template <class Make>
+static const SplineTable& cachedTable(int kind, double tolerance, Make make)
+{
+    static std::mutex mutex;
+    static std::map<std::pair<int, double>, std::unique_ptr<SplineTable>> tables;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<SplineTable>& table = tables[{kind, tolerance}];
+    if (!table) {
+        table = std::make_unique<SplineTable>(make());
+    }
+    return *table;
+}
+
+const SplineTable& FastStarTables::colorTemperature(const double tolerance, const bool supergiant)
+{
+    const int lumClass = supergiant ? Star::LumClass::Ib : Star::LumClass::V;
+    return cachedTable(supergiant ? 1 : 2, tolerance, [tolerance, lumClass] {
+        return SplineTable([lumClass](double bmv) { return Star::colorTemperature(bmv, lumClass); }, BMV_LO, BMV_HI,
+                           tolerance, true);
+    });
+}
+
+const SplineTable& FastStarTables::bolometricCorrection(const double tolerance, const int segment)
+{
+    // segment bounds at log temperature 3.7 and 3.9
+    const double bounds[] = {TEMP_LO, std::pow(10.0, 3.7), std::pow(10.0, 3.9), TEMP_HI};
+    const double lo       = bounds[segment];
+    const double hi       = bounds[segment + 1];
+    return cachedTable(3 + segment, tolerance, [tolerance, lo, hi] {
+        // nudge the bounds inside the segment so that the polynomial of neighbour segment is never evaluated
+        const double inner = (hi - lo) * 1e-12;
+        return SplineTable(
+                [lo, hi, inner](double temp) {
+                    return Star::bolometricCorrection(std::fmin(std::fmax(temp, lo + inner), hi - inner));
+                },
+                lo, hi, tolerance, false);
+    });
+}
+
+const SplineTable& FastStarTables::exp2(const double tolerance)
+{
+    return cachedTable(6, tolerance, [tolerance] {
+        return SplineTable([](double f) { return std::exp2(f); }, 0.0, 1.0, tolerance, true);
+    });
+}
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cmath>
+#include "include/hrdiagram.h"
+#include "include/instrument.h"
+#include "include/starbatch.h"
+
+/**
+ * stars pushed through the chain at once, sized so that all intermediate columns stay in L1/L2 cache
+ */
+static constexpr std::size_t BLOCK = 512;
+
+/**
+ * Maps quantity values to bin coordinates, offset + scale * value lies in [0, bins) for values on the axis
+ */
+struct AxisScale
+{
+    double offset = 0.0;
+    double scale  = 0.0;
+    bool log      = false;
+
+    explicit AxisScale(const HrAxis& axis)
+        : log(axis.logarithmic)
+    {
+        const double lo = log ? std::log10(axis.min) : axis.min;
+        const double hi = log ? std::log10(axis.max) : axis.max;
+        scale           = static_cast<double>(axis.bins) / (hi - lo);
+        offset          = -lo * scale;
+    }
+    [[nodiscard]] double operator()(const double value) const
+    {
+        return offset + scale * (log ? std::log10(value) : value);
+    }
+};
+
+HrDiagram::HrDiagram(const HrAxis& x, const HrAxis& y, ThreadPool& pool, const std::size_t grain)
+    : _x(x), _y(y), _pool(pool), _grain(std::max<std::size_t>(grain, 1)), _counts(x.bins * y.bins, 0.0)
+{
+}
+
+void HrDiagram::Accumulate(const StarCatalog& catalog, const double* weight, const std::size_t begin,
+                           const std::size_t end, double* counts, double& dropped) const
+{
+    double bmv[BLOCK], temperature[BLOCK], bc[BLOCK], distance[BLOCK], mv[BLOCK], lum[BLOCK];
+    const auto needs = [this](const HrAxis::Quantity quantity) {
+        return this->_x.quantity == quantity || this->_y.quantity == quantity;
+    };
+    const bool needLuminosity  = needs(HrAxis::Luminosity);
+    const bool needMagnitude   = needLuminosity || needs(HrAxis::AbsoluteMagnitude);
+    const bool needTemperature = needLuminosity || needs(HrAxis::Temperature);
+    const AxisScale scaleX(this->_x);
+    const AxisScale scaleY(this->_y);
+    const auto column = [&](const HrAxis::Quantity quantity) -> const double* {
+        switch (quantity) {
+            case HrAxis::ColorIndex:
+                return bmv;
+            case HrAxis::Temperature:
+                return temperature;
+            case HrAxis::AbsoluteMagnitude:
+                return mv;
+            default:
+                return lum;
+        }
+    };
+    const double* valuesX = column(this->_x.quantity);
+    const double* valuesY = column(this->_y.quantity);
+    const double binsX    = static_cast<double>(this->_x.bins);
+    const double binsY    = static_cast<double>(this->_y.bins);
+
+    for (std::size_t first = begin; first < end; first += BLOCK) {
+        const std::size_t n = std::min(BLOCK, end - first);
+
+        for (std::size_t i = 0; i < n; i++) {
+            const double parallax = catalog.Parallax()[first + i];
+            bmv[i]                = catalog.Bmagnitude()[first + i] - catalog.Vmagnitude()[first + i];
+            distance[i]           = parallax > 0.0 ? 1.0 / parallax : INFINITY;
+        }
+        if (needTemperature) {
+            StarBatch::colorTemperature(bmv, catalog.LuminosityClass() + first, temperature, n);
+        }
+        if (needMagnitude) {
+            StarBatch::absoluteMagnitude(catalog.Vmagnitude() + first, distance, mv, n);
+        }
+        if (needLuminosity) {
+            StarBatch::bolometricCorrection(temperature, bc, n);
+            StarBatch::luminosity(mv, bc, lum, n);
+        }
+
+        // negated comparisons drop NaN coordinates together with those off the grid
+        for (std::size_t i = 0; i < n; i++) {
+            const double w  = weight ? weight[first + i] : 1.0;
+            const double bx = scaleX(valuesX[i]);
+            const double by = scaleY(valuesY[i]);
+            if (!(bx >= 0.0 && bx < binsX && by >= 0.0 && by < binsY)) {
+                dropped += w;
+                continue;
+            }
+            counts[static_cast<std::size_t>(by) * this->_x.bins + static_cast<std::size_t>(bx)] += w;
+        }
+    }
+}
+
+void HrDiagram::Add(const StarCatalog& catalog, const double* weight)
+{
+    ASTROLIB_PROBE(HrDiagramAdd, catalog.Size());
+    const std::size_t n     = catalog.Size();
+    const std::size_t parts = std::clamp<std::size_t>(n / this->_grain, 1, this->_pool.Concurrency());
+    if (parts == 1) {
+        Accumulate(catalog, weight, 0, n, this->_counts.data(), this->_dropped);
+        return;
+    }
+
+    // part zero bins into the shared grid, the others into private grids merged afterwards
+    std::vector<std::vector<double>> grids(parts - 1);
+    std::vector<double> dropped(parts, 0.0);
+    this->_pool.ParallelFor(0, parts, 1, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t part = begin; part < end; part++) {
+            double* counts = this->_counts.data();
+            if (part > 0) {
+                grids[part - 1].assign(this->_counts.size(), 0.0);
+                counts = grids[part - 1].data();
+            }
+            Accumulate(catalog, weight, part * n / parts, (part + 1) * n / parts, counts, dropped[part]);
+        }
+    });
+
+    const std::size_t cells = this->_counts.size();
+    this->_pool.ParallelFor(0, cells, std::max<std::size_t>(4096, cells / (4 * this->_pool.Concurrency())),
+                            [&](const std::size_t begin, const std::size_t end) {
+                                for (const std::vector<double>& grid : grids) {
+                                    for (std::size_t cell = begin; cell < end; cell++) {
+                                        this->_counts[cell] += grid[cell];
+                                    }
+                                }
+                            });
+    for (const double part : dropped) {
+        this->_dropped += part;
+    }
+}
+
+void HrDiagram::Clear()
+{
+    std::fill(this->_counts.begin(), this->_counts.end(), 0.0);
+    this->_dropped = 0.0;
+}
+
+double HrDiagram::Count(const std::size_t x, const std::size_t y) const
+{
+    return this->_counts[y * this->_x.bins + x];
+}
+
+const std::vector<double>& HrDiagram::Counts() const
+{
+    return this->_counts;
+}
+
+double HrDiagram::Dropped() const
+{
+    return this->_dropped;
+}
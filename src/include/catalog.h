@@ -0,0 +1,123 @@
+#ifndef ASTROLIB_CATALOG_H
+#define ASTROLIB_CATALOG_H
+
+#include <cstddef>
+#include <vector>
+#include "star.h"
+
+/**
+ * Structure-of-arrays container of stars, every Star field is kept in its own contiguous column
+ */
+class StarCatalog
+{
+private:
+    std::vector<double> _mass{};
+    std::vector<double> _radius{};
+    std::vector<double> _photosphereTemperature{};
+    std::vector<double> _parallax{};
+    std::vector<double> _radvel{};
+    std::vector<double> _Vmagnitude{};
+    std::vector<double> _Bmagnitude{};
+    std::vector<double> _ra{};
+    std::vector<double> _dec{};
+    std::vector<double> _pmra{};
+    std::vector<double> _pmdec{};
+    /**
+     * spectral type and luminosity class codes parsed from spectral type string, see Star::parseSpectrum
+     */
+    std::vector<int> _spectype{};
+    std::vector<int> _lumclass{};
+
+public:
+    /**
+     * default constructor
+     */
+    StarCatalog();
+    /**
+     * @param size number of default initialized stars
+     */
+    explicit StarCatalog(std::size_t size);
+
+    [[nodiscard]] std::size_t Size() const;
+    void Resize(std::size_t size);
+    void Reserve(std::size_t capacity);
+    void Clear();
+
+    /**
+     * Appends star to the end of catalog
+     */
+    void Add(const Star& star);
+    /**
+     * Overwrites star at index
+     */
+    void Set(std::size_t index, const Star& star);
+    /**
+     * Returns star at index, spectrum string is formatted back from spectral codes
+     */
+    [[nodiscard]] Star Get(std::size_t index) const;
+    /**
+     * Appends all stars to the end of catalog
+     */
+    void Gather(const std::vector<Star>& stars);
+    /**
+     * Appends all stars of other catalog to the end of catalog
+     */
+    void Append(const StarCatalog& other);
+    /**
+     * Writes all catalog stars to vector resized to catalog size
+     */
+    void Scatter(std::vector<Star>& stars) const;
+
+    /**
+     * Columns, each one holds Size() elements
+     */
+    double* Mass();
+    double* Radius();
+    double* PhotosphereTemperature();
+    double* Parallax();
+    double* RadialVelocity();
+    double* Vmagnitude();
+    double* Bmagnitude();
+    double* RightAscension();
+    double* Declination();
+    double* ProperMotionRa();
+    double* ProperMotionDec();
+    int* SpectralType();
+    int* LuminosityClass();
+    [[nodiscard]] const double* Mass() const;
+    [[nodiscard]] const double* Radius() const;
+    [[nodiscard]] const double* PhotosphereTemperature() const;
+    [[nodiscard]] const double* Parallax() const;
+    [[nodiscard]] const double* RadialVelocity() const;
+    [[nodiscard]] const double* Vmagnitude() const;
+    [[nodiscard]] const double* Bmagnitude() const;
+    [[nodiscard]] const double* RightAscension() const;
+    [[nodiscard]] const double* Declination() const;
+    [[nodiscard]] const double* ProperMotionRa() const;
+    [[nodiscard]] const double* ProperMotionDec() const;
+    [[nodiscard]] const int* SpectralType() const;
+    [[nodiscard]] const int* LuminosityClass() const;
+
+    /**
+     * Derived quantities for every star, out must hold Size() elements
+     */
+    void Luminosity(double* out) const;
+    /**
+     * Distances in parsecs from parallax column, infinite if parallax is unknown
+     */
+    void Distance(double* out) const;
+    /**
+     * B-V color indices from blue and visual magnitude columns
+     */
+    void ColorIndex(double* out) const;
+    /**
+     * Absolute visual magnitudes from visual magnitude and parallax columns
+     */
+    void AbsoluteMagnitude(double* out) const;
+    /**
+     * Surface temperatures from B-V color indices and luminosity classes
+     */
+    void ColorTemperature(double* out) const;
+};
+
+#endif // ASTROLIB_CATALOG_H
@@ -0,0 +1,85 @@
+#ifndef ASTROLIB_CATALOGFILE_H
+#define ASTROLIB_CATALOGFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "catalog.h"
+
+/**
+ * Memory mapped binary star catalog. File holds a versioned header followed by StarCatalog columns, each one aligned
+ * to 64 bytes, so columns are read in place without deserialization and opening does not depend on catalog size.
+ * Numbers are stored little-endian. Errors are reported with std::runtime_error.
+ */
+class CatalogFile
+{
+public:
+    /**
+     * current file format version
+     */
+    static constexpr std::uint32_t VERSION = 3;
+
+private:
+    const std::uint8_t* _data{};
+    std::size_t _length{};
+    std::size_t _size{};
+    std::uint64_t _checksum{};
+    /**
+     * column offsets in file order: mass, radius, photosphere temperature, parallax, radial velocity, V and B
+     * magnitudes, right ascension, declination, proper motions in right ascension and declination, spectral type and
+     * luminosity class codes
+     */
+    std::uint64_t _offsets[13]{};
+
+    [[nodiscard]] const double* DoubleColumn(int column) const;
+    [[nodiscard]] const int* IntColumn(int column) const;
+
+public:
+    /**
+     * Maps catalog file read-only and validates its header
+     * @param path file path
+     */
+    explicit CatalogFile(const std::string& path);
+    /**
+     * unmaps file
+     */
+    ~CatalogFile();
+    CatalogFile(const CatalogFile&)            = delete;
+    CatalogFile& operator=(const CatalogFile&) = delete;
+
+    /**
+     * Writes catalog to file
+     * @param catalog stars to write
+     * @param path file path
+     */
+    static void Write(const StarCatalog& catalog, const std::string& path);
+
+    [[nodiscard]] std::size_t Size() const;
+    /**
+     * Checks column data against checksum stored in header, reads the whole file
+     */
+    [[nodiscard]] bool Verify() const;
+    /**
+     * Copies all columns into catalog
+     */
+    [[nodiscard]] StarCatalog ToCatalog() const;
+
+    /**
+     * Columns mapped from file, each one holds Size() elements
+     */
+    [[nodiscard]] const double* Mass() const;
+    [[nodiscard]] const double* Radius() const;
+    [[nodiscard]] const double* PhotosphereTemperature() const;
+    [[nodiscard]] const double* Parallax() const;
+    [[nodiscard]] const double* RadialVelocity() const;
+    [[nodiscard]] const double* Vmagnitude() const;
+    [[nodiscard]] const double* Bmagnitude() const;
+    [[nodiscard]] const double* RightAscension() const;
+    [[nodiscard]] const double* Declination() const;
+    [[nodiscard]] const double* ProperMotionRa() const;
+    [[nodiscard]] const double* ProperMotionDec() const;
+    [[nodiscard]] const int* SpectralType() const;
+    [[nodiscard]] const int* LuminosityClass() const;
+};
+
+#endif // ASTROLIB_CATALOGFILE_H
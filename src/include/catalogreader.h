@@ -0,0 +1,107 @@
+#ifndef ASTROLIB_CATALOGREADER_H
+#define ASTROLIB_CATALOGREADER_H
+
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <string>
+#include "catalog.h"
+
+/**
+ * Layout of text star catalog lines
+ */
+struct CatalogFormat
+{
+    /**
+     * catalog fields in the order used by column and start/width arrays
+     */
+    enum Field
+    {
+        Mass = 0,
+        Radius,
+        PhotosphereTemperature,
+        Parallax,
+        RadialVelocity,
+        Vmagnitude,
+        Bmagnitude,
+        RightAscension,
+        Declination,
+        ProperMotionRa,
+        ProperMotionDec,
+        Spectrum,
+        FieldCount
+    };
+
+    /**
+     * delimiter separated fields when true, fixed width fields otherwise
+     */
+    bool delimited = true;
+    char delimiter = ',';
+    /**
+     * lines starting with comment character are skipped, as well as empty lines
+     */
+    char comment = '#';
+    /**
+     * number of leading lines to skip, e.g. column titles
+     */
+    std::size_t skipLines = 0;
+    /**
+     * delimited format: index of field column, negative if field is absent
+     */
+    int column[FieldCount] = {0, 1, 2, 3, 4, 5, 6, -1, -1, -1, -1, 7};
+    /**
+     * fixed width format: first character and width of every field, zero width if field is absent
+     */
+    std::size_t start[FieldCount] = {};
+    std::size_t width[FieldCount] = {};
+};
+
+/**
+ * Streaming reader of text star catalogs. Input is split into chunks at line ends and chunks are parsed on several
+ * threads into StarCatalog batches, which are passed on in file order. At most one chunk per thread is in flight, so
+ * memory stays bounded regardless of input size. Absent fields are zero, malformed lines are skipped and counted.
+ */
+class CatalogReader
+{
+public:
+    struct Stats
+    {
+        std::size_t rows      = 0;
+        std::size_t malformed = 0;
+        std::size_t bytes     = 0;
+        double seconds        = 0.0;
+
+        [[nodiscard]] double RowsPerSecond() const;
+    };
+
+private:
+    CatalogFormat _format{};
+    unsigned _threads{};
+    std::size_t _chunkBytes{};
+
+    /**
+     * Parses complete lines of chunk and appends them to batch, returns number of malformed lines
+     */
+    std::size_t ParseChunk(const std::string& chunk, StarCatalog& batch) const;
+    bool ParseLine(std::string_view line, StarCatalog& batch) const;
+
+public:
+    /**
+     * @param format line layout
+     * @param threads number of parsing threads, zero to use all hardware threads
+     * @param chunkBytes approximate size of input chunk parsed at once
+     */
+    explicit CatalogReader(const CatalogFormat& format = CatalogFormat(), unsigned threads = 0,
+                           std::size_t chunkBytes = 4 << 20);
+
+    /**
+     * Reads whole input and passes every parsed batch to consumer, in input order
+     */
+    Stats Read(std::istream& input, const std::function<void(StarCatalog& batch)>& consumer) const;
+    /**
+     * Reads whole file and appends all stars to catalog
+     */
+    Stats Read(const std::string& path, StarCatalog& catalog) const;
+};
+
+#endif // ASTROLIB_CATALOGREADER_H
@@ -1,14 +1,14 @@
 #ifndef ASTROLIB_CONSTANTS_H
 #define ASTROLIB_CONSTANTS_H
 
-#include <cmath>
 #include <cstdint>
 
-constexpr double PI_NUMBER       = 3.14159;
-constexpr double EULER_NUMBER    = 2.71828;
-constexpr int SPEED_OF_LIGHT_MPS = 299792458;
+constexpr double PI_NUMBER              = 3.141592653589793;
+constexpr double EULER_NUMBER           = 2.718281828459045;
+constexpr int SPEED_OF_LIGHT_MPS        = 299792458;
+constexpr double LIGHT_YEARS_PER_PARSEC = 3.2615637771674337;
 
-constexpr double ABSOLUTE_ZERO_CELSIUS = -273.15;
-const double STEFAN_BOLTZMANN_CONSTANT = 5.6704 * (1 / std::pow(10, 8));
+constexpr double ABSOLUTE_ZERO_CELSIUS     = -273.15;
+constexpr double STEFAN_BOLTZMANN_CONSTANT = 5.670374419e-8;
 
 #endif // ASTROLIB_CONSTANTS_H
@@ -0,0 +1,66 @@
+#ifndef ASTROLIB_CROSSMATCH_H
+#define ASTROLIB_CROSSMATCH_H
+
+#include <cstddef>
+#include <vector>
+#include "catalog.h"
+#include "threadpool.h"
+
+/**
+ * Pair of stars closer than the match radius
+ */
+struct CrossMatch
+{
+    /**
+     * index into the first and the second star set
+     */
+    std::size_t first  = 0;
+    std::size_t second = 0;
+    /**
+     * angular distance in degrees
+     */
+    double separation  = 0.0;
+};
+
+/**
+ * Positional cross-match of two star sets by the zones algorithm. The second set is split into declination zones at
+ * least one radius high and every zone is sorted by right ascension once, so that a star of the first set is compared
+ * only with the right ascension window of three zones. The first set is streamed in chunks over a thread pool without
+ * being copied, memory grows with the second set and the output only, so the larger set should come first.
+ *
+ * Matches are ordered by first index, then by separation, and do not depend on the number of threads. Stars with
+ * non-finite position match nothing. All angles are in degrees.
+ */
+class CrossMatcher
+{
+private:
+    double _radius{};
+    ThreadPool& _pool;
+
+    [[nodiscard]] std::vector<CrossMatch> Match(const double* ra1, const double* dec1, std::size_t n1,
+                                                const double* ra2, const double* dec2, std::size_t n2,
+                                                bool best) const;
+
+public:
+    /**
+     * @param radius largest separation of matching stars
+     * @param pool threads to run on
+     */
+    explicit CrossMatcher(double radius, ThreadPool& pool = ThreadPool::Default());
+
+    /**
+     * Nearest star of the second set for every star of the first set which has one within radius
+     */
+    [[nodiscard]] std::vector<CrossMatch> Best(const double* ra1, const double* dec1, std::size_t n1, const double* ra2,
+                                               const double* dec2, std::size_t n2) const;
+    [[nodiscard]] std::vector<CrossMatch> Best(const StarCatalog& first, const StarCatalog& second) const;
+
+    /**
+     * All pairs of stars within radius
+     */
+    [[nodiscard]] std::vector<CrossMatch> All(const double* ra1, const double* dec1, std::size_t n1, const double* ra2,
+                                              const double* dec2, std::size_t n2) const;
+    [[nodiscard]] std::vector<CrossMatch> All(const StarCatalog& first, const StarCatalog& second) const;
+};
+
+#endif // ASTROLIB_CROSSMATCH_H
@@ -0,0 +1,98 @@
+#ifndef ASTROLIB_DERIVEDCACHE_H
+#define ASTROLIB_DERIVEDCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "catalog.h"
+
+/**
+ * Derived quantities of catalog stars computed on first read and kept until their inputs change. Inputs written
+ * through the setters mark the dependent columns of that star only, a read of a column recomputes its marked stars in
+ * one batch call, or the whole column when most stars are marked. Stars added to the catalog are computed on the next
+ * read. Inputs written to catalog columns directly must be reported with Invalidate.
+ *
+ * Dependencies:
+ * Luminosity           - radius and photosphere temperature, see Star::Luminosity
+ * BolometricCorrection - photosphere temperature, see Star::bolometricCorrection
+ * ColorTemperature     - B-V color index and luminosity class, see Star::colorTemperature
+ * Radius               - visual magnitude, parallax and photosphere temperature, see Star::radius of Star::luminosity
+ * Mass is input of no column, SetMass only writes it.
+ */
+class DerivedCache
+{
+public:
+    enum Column
+    {
+        Luminosity = 0,
+        BolometricCorrection,
+        ColorTemperature,
+        Radius,
+        ColumnCount
+    };
+
+private:
+    StarCatalog& _catalog;
+    std::vector<double> _columns[ColumnCount]{};
+    /**
+     * whether column has been computed, columns never read are not tracked
+     */
+    bool _valid[ColumnCount]{};
+    /**
+     * stars marked per column, each at most once, and bit 1 << column of every marked star
+     */
+    std::vector<std::size_t> _pending[ColumnCount]{};
+    std::vector<std::uint8_t> _dirty{};
+    std::size_t _recomputed[ColumnCount]{};
+
+    void Sync();
+    void Mark(std::size_t index, unsigned columns);
+    void Refresh(Column column);
+    void Compute(Column column, const std::size_t* rows, std::size_t n);
+
+public:
+    /**
+     * @param catalog stars to derive quantities of, must outlive the cache
+     */
+    explicit DerivedCache(StarCatalog& catalog);
+
+    /**
+     * Columns, each one holds catalog Size() elements valid until the next setter or catalog change
+     */
+    const double* Get(Column column);
+    /**
+     * Value of column for star at index
+     */
+    double Get(Column column, std::size_t index);
+
+    /**
+     * Write the catalog input of star at index and mark its dependent columns
+     */
+    void SetRadius(std::size_t index, double radius);
+    void SetPhotosphereTemperature(std::size_t index, double photosphereTemperature);
+    void SetMass(std::size_t index, double mass);
+    void SetParallax(std::size_t index, double parallax);
+    void SetVmagnitude(std::size_t index, double Vmagnitude);
+    void SetBmagnitude(std::size_t index, double Bmagnitude);
+    void SetLuminosityClass(std::size_t index, int lumclass);
+    /**
+     * Overwrites star at index and marks all its columns
+     */
+    void Set(std::size_t index, const Star& star);
+
+    /**
+     * Marks all columns of star at index, after its inputs were written to the catalog directly
+     */
+    void Invalidate(std::size_t index);
+    /**
+     * Drops all columns, they are computed from scratch on the next read
+     */
+    void Invalidate();
+
+    /**
+     * Number of star values computed for column since construction
+     */
+    [[nodiscard]] std::size_t Recomputed(Column column) const;
+};
+
+#endif // ASTROLIB_DERIVEDCACHE_H
@@ -0,0 +1,127 @@
+#ifndef ASTROLIB_DETECTION_H
+#define ASTROLIB_DETECTION_H
+
+#include <cstddef>
+#include <vector>
+#include "psffit.h"
+#include "threadpool.h"
+
+/**
+ * Connected group of pixels above detection threshold, pixel centres lie at integer coordinates
+ */
+struct DetectedSource
+{
+    /**
+     * centroid weighted by background subtracted values
+     */
+    double x             = 0.0;
+    double y             = 0.0;
+    /**
+     * sum of background subtracted values
+     */
+    double flux          = 0.0;
+    std::size_t pixels   = 0;
+    /**
+     * Moffat starting point for MoffatFitter in image coordinates: centroid, brightest value above background, beta
+     * of the detector and width matching the second moments of the group
+     */
+    MoffatParameters moffat{};
+};
+
+/**
+ * Source detector working on strips of image rows. Background and noise are estimated per block of strip rows and
+ * background cell columns as median and scaled median absolute deviation, pixels above background plus threshold
+ * noise sigmas are grouped into 8-connected components by run-length labelling. Strips are labelled in parallel and
+ * components cut by strip boundaries are merged in row order, so results do not depend on the number of threads.
+ * Rows may be pushed incrementally, then memory is bounded by a strip per thread regardless of image height.
+ */
+class StarDetector
+{
+private:
+    struct Moments
+    {
+        double flux        = 0.0;
+        double sumX        = 0.0;
+        double sumY        = 0.0;
+        double sumXX       = 0.0;
+        double sumYY       = 0.0;
+        double peak        = 0.0;
+        double background  = 0.0;
+        std::size_t pixels = 0;
+
+        void Add(const Moments& other);
+    };
+
+    /**
+     * columns [begin, end] of a row above threshold, end is inclusive so that runs of adjacent rows touch when
+     * upper.begin <= lower.end + 1 and lower.begin <= upper.end + 1
+     */
+    struct Run
+    {
+        std::size_t begin     = 0;
+        std::size_t end       = 0;
+        std::size_t component = 0;
+    };
+
+    struct Strip
+    {
+        std::vector<Moments> components{};
+        std::vector<Run> top{};
+        std::vector<Run> bottom{};
+    };
+
+    double _thresholdSigma{};
+    std::size_t _minPixels{};
+    std::size_t _stripRows{};
+    std::size_t _backgroundCell{};
+    double _beta{};
+    ThreadPool& _pool;
+
+    std::size_t _width{};
+    std::size_t _rows{};
+    std::vector<float> _pending{};
+    /**
+     * components touching the last row labelled so far and their runs on that row
+     */
+    std::vector<Moments> _open{};
+    std::vector<Run> _openRuns{};
+    std::vector<DetectedSource> _sources{};
+
+    [[nodiscard]] Strip Label(const float* rows, std::size_t count, std::size_t firstRow) const;
+    void Merge(Strip& strip);
+    void Emit(const Moments& moments);
+    void Process(const float* rows, std::size_t count);
+
+public:
+    /**
+     * @param thresholdSigma detection threshold in noise standard deviations above background
+     * @param minPixels smallest component reported as source
+     * @param stripRows rows labelled by one task
+     * @param backgroundCell columns of one background block
+     * @param beta Moffat beta of source seeds
+     * @param pool threads to run on
+     */
+    explicit StarDetector(double thresholdSigma = 5.0, std::size_t minPixels = 3, std::size_t stripRows = 128,
+                          std::size_t backgroundCell = 64, double beta = 2.5,
+                          ThreadPool& pool = ThreadPool::Default());
+
+    /**
+     * Starts new image of given width, drops state of unfinished one
+     */
+    void Begin(std::size_t width);
+    /**
+     * Appends count rows of width values, full strips are labelled as soon as there is one for every thread
+     */
+    void Push(const float* rows, std::size_t count);
+    /**
+     * Labels the remaining rows and returns all sources of the image in order of their last row
+     */
+    std::vector<DetectedSource> Finish();
+
+    /**
+     * Detects sources on whole image of width * height values in row-major order without copying it
+     */
+    std::vector<DetectedSource> Detect(const float* image, std::size_t width, std::size_t height);
+};
+
+#endif // ASTROLIB_DETECTION_H
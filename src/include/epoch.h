@@ -0,0 +1,41 @@
+#ifndef ASTROLIB_EPOCH_H
+#define ASTROLIB_EPOCH_H
+
+#include <cstddef>
+#include "catalog.h"
+#include "threadpool.h"
+
+/**
+ * Moves catalog stars to another epoch along straight lines in space. Position, parallax and radial velocity define
+ * the space motion, which is propagated rigorously, so that foreshortening and perspective acceleration are included.
+ * Right ascension, declination, proper motions, parallax, radial velocity and V and B magnitudes are updated in place,
+ * magnitudes follow the change of distance as Star::apparentMagnitude of the unchanged absolute magnitude.
+ *
+ * Stars with unknown distance (parallax not above zero) keep parallax and magnitudes and move by proper motion only,
+ * non-finite radial velocity counts as zero and is kept. Trigonometry runs per star, the rest of the motion in SIMD
+ * lanes over blocks of stars, and blocks are spread over a thread pool.
+ */
+class EpochPropagator
+{
+private:
+    ThreadPool& _pool;
+    std::size_t _grain{};
+
+public:
+    /**
+     * @param pool threads to run on
+     * @param grain number of stars processed by one task
+     */
+    explicit EpochPropagator(ThreadPool& pool = ThreadPool::Default(), std::size_t grain = 16384);
+
+    /**
+     * Propagates all stars of catalog by years, which may be negative
+     */
+    void Propagate(StarCatalog& catalog, double years) const;
+    /**
+     * Propagates stars [begin, end) of catalog by years on the calling thread
+     */
+    void Propagate(StarCatalog& catalog, double years, std::size_t begin, std::size_t end) const;
+};
+
+#endif // ASTROLIB_EPOCH_H
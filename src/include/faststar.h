@@ -0,0 +1,186 @@
+#ifndef ASTROLIB_FASTSTAR_H
+#define ASTROLIB_FASTSTAR_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include "star.h"
+
+/**
+ * Piecewise cubic Hermite interpolation of a function on a uniform grid over [lo, hi]. The grid is refined by
+ * doubling until the interpolation error checked between nodes is within tolerance.
+ */
+class SplineTable
+{
+private:
+    double _lo{};
+    double _hi{};
+    /**
+     * intervals per unit of x
+     */
+    double _scale{};
+    /**
+     * cubic coefficients of every interval, four per interval in ascending powers
+     */
+    std::vector<double> _coef{};
+
+public:
+    /**
+     * @param f function to interpolate
+     * @param lo lower bound of domain
+     * @param hi upper bound of domain
+     * @param tolerance max interpolation error
+     * @param relative whether tolerance is relative to |f(x)| or absolute
+     */
+    SplineTable(const std::function<double(double)>& f, double lo, double hi, double tolerance, bool relative);
+
+    [[nodiscard]] double Lo() const;
+    [[nodiscard]] double Hi() const;
+    [[nodiscard]] std::size_t Intervals() const;
+    [[nodiscard]] bool Contains(double x) const;
+
+    /**
+     * Interpolated value at x, x must be within [Lo(), Hi()]
+     */
+    double operator()(double x) const
+    {
+        const std::size_t intervals = _coef.size() / 4;
+
+        const double u = (x - _lo) * _scale;
+        std::size_t i  = static_cast<std::size_t>(u);
+        if (i >= intervals) {
+            i = intervals - 1;
+        }
+        const double f  = u - static_cast<double>(i);
+        const double* c = &_coef[4 * i];
+        return c[0] + f * (c[1] + f * (c[2] + f * c[3]));
+    }
+};
+
+/**
+ * precision policies for FastStar, tolerance is relative except for bolometric correction where it is in magnitudes
+ */
+struct ExactPolicy
+{
+    static constexpr bool exact       = true;
+    static constexpr double tolerance = 0.0;
+};
+struct PrecisePolicy
+{
+    static constexpr bool exact       = false;
+    static constexpr double tolerance = 1e-6;
+};
+struct FastPolicy
+{
+    static constexpr bool exact       = false;
+    static constexpr double tolerance = 1e-3;
+};
+
+/**
+ * Tables used by FastStar, built lazily on first use for every tolerance
+ */
+class FastStarTables
+{
+public:
+    /**
+     * valid B-V domain of the tables, same as clamp range of Star::bmv2rgb
+     */
+    static constexpr double BMV_LO = -0.4;
+    static constexpr double BMV_HI = 2.0;
+    /**
+     * valid temperature domain of bolometric correction tables in Kelvins
+     */
+    static constexpr double TEMP_LO = 2000.0;
+    static constexpr double TEMP_HI = 100000.0;
+
+    /**
+     * @param supergiant whether table is for luminosity classes up to Ib
+     */
+    static const SplineTable& colorTemperature(double tolerance, bool supergiant);
+    /**
+     * @param segment 0, 1 or 2 for log temperature below 3.7, up to 3.9 and above 3.9
+     */
+    static const SplineTable& bolometricCorrection(double tolerance, int segment);
+    /**
+     * 2^f for f in [0, 1]
+     */
+    static const SplineTable& exp2(double tolerance);
+};
+
+/**
+ * Fast approximations of Star temperature and magnitude conversions with selectable precision. Inputs outside of the
+ * table domains fall back to the exact Star function.
+ * @tparam Policy ExactPolicy, PrecisePolicy or FastPolicy
+ */
+template <class Policy>
+class FastStar
+{
+public:
+    /**
+     * see Star::bmv2temp, exact for every policy since two divisions are cheaper than a table lookup
+     */
+    static double bmv2temp(double bmv)
+    {
+        return Star::bmv2temp(bmv);
+    }
+    /**
+     * see Star::colorTemperature
+     */
+    static double colorTemperature(double bmv, int lumClass)
+    {
+        if constexpr (!Policy::exact) {
+            static const SplineTable& supergiant = FastStarTables::colorTemperature(Policy::tolerance, true);
+            static const SplineTable& other      = FastStarTables::colorTemperature(Policy::tolerance, false);
+            const SplineTable& table             = lumClass <= Star::LumClass::Ib ? supergiant : other;
+            if (table.Contains(bmv)) {
+                return table(bmv);
+            }
+        }
+        return Star::colorTemperature(bmv, lumClass);
+    }
+    /**
+     * see Star::bolometricCorrection
+     */
+    static double bolometricCorrection(double temp)
+    {
+        if constexpr (!Policy::exact) {
+            static const SplineTable* tables[] = {
+                    &FastStarTables::bolometricCorrection(Policy::tolerance, 0),
+                    &FastStarTables::bolometricCorrection(Policy::tolerance, 1),
+                    &FastStarTables::bolometricCorrection(Policy::tolerance, 2),
+            };
+            const SplineTable& table = temp > tables[2]->Lo()   ? *tables[2]
+                                       : temp > tables[1]->Lo() ? *tables[1]
+                                                                : *tables[0];
+            if (table.Contains(temp)) {
+                return table(temp);
+            }
+        }
+        return Star::bolometricCorrection(temp);
+    }
+    /**
+     * see Star::brightnessRatio
+     */
+    static double brightnessRatio(double magDiff)
+    {
+        if constexpr (!Policy::exact) {
+            static const SplineTable& table = FastStarTables::exp2(Policy::tolerance);
+            // 10^(magDiff / 2.5) = 2^x, split x into integer exponent k and fraction in [0, 1)
+            const double x = magDiff * (3.321928094887362 / 2.5);
+            if (x > -1022.0 && x < 1023.0) {
+                std::int64_t k = static_cast<std::int64_t>(x);
+                k -= k > x;
+                const std::uint64_t bits = static_cast<std::uint64_t>(k + 1023) << 52;
+                double scale;
+                std::memcpy(&scale, &bits, sizeof(scale));
+                return table(x - static_cast<double>(k)) * scale;
+            }
+        }
+        return Star::brightnessRatio(magDiff);
+    }
+};
+
+#endif // ASTROLIB_FASTSTAR_H
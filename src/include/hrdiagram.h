@@ -0,0 +1,101 @@
+#ifndef ASTROLIB_HRDIAGRAM_H
+#define ASTROLIB_HRDIAGRAM_H
+
+#include <cstddef>
+#include <vector>
+#include "catalog.h"
+#include "threadpool.h"
+
+/**
+ * Axis of a Hertzsprung-Russell or colour-magnitude diagram
+ */
+struct HrAxis
+{
+    enum Quantity
+    {
+        /**
+         * B-V color index
+         */
+        ColorIndex = 0,
+        /**
+         * surface temperature in kelvins from B-V color index, see Star::colorTemperature
+         */
+        Temperature,
+        /**
+         * absolute visual magnitude from parallax distance, see Star::absoluteMagnitude
+         */
+        AbsoluteMagnitude,
+        /**
+         * total luminosity in solar luminosities, see Star::luminosity
+         */
+        Luminosity
+    };
+
+    Quantity quantity = ColorIndex;
+    /**
+     * range [min, max) split into bins, min may exceed max for axes drawn backwards
+     */
+    double min        = 0.0;
+    double max        = 1.0;
+    std::size_t bins  = 100;
+    /**
+     * bins of equal width in log10 of the quantity, min and max stay in units of the quantity
+     */
+    bool logarithmic  = false;
+};
+
+/**
+ * Two dimensional histogram of catalog stars over derived quantities. The chain colorTemperature,
+ * bolometricCorrection, absoluteMagnitude and luminosity runs on blocks of stars in cache as far as the axes need it,
+ * so no per-star column is ever materialized. Every thread bins its part of the catalog into a private grid, grids
+ * are merged at the end. Adding more stars accumulates into the same grid.
+ */
+class HrDiagram
+{
+private:
+    HrAxis _x{};
+    HrAxis _y{};
+    ThreadPool& _pool;
+    std::size_t _grain{};
+    /**
+     * y.bins rows of x.bins columns
+     */
+    std::vector<double> _counts{};
+    double _dropped{};
+
+    void Accumulate(const StarCatalog& catalog, const double* weight, std::size_t begin, std::size_t end,
+                    double* counts, double& dropped) const;
+
+public:
+    /**
+     * @param x horizontal axis
+     * @param y vertical axis
+     * @param pool threads to run on
+     * @param grain smallest number of stars binned by one thread
+     */
+    HrDiagram(const HrAxis& x, const HrAxis& y, ThreadPool& pool = ThreadPool::Default(), std::size_t grain = 65536);
+
+    /**
+     * Bins all stars of catalog, with weight[i] for star i or unit weights if weight is null
+     */
+    void Add(const StarCatalog& catalog, const double* weight = nullptr);
+    /**
+     * Empties the grid
+     */
+    void Clear();
+
+    /**
+     * Sum of weights of stars in column x and row y
+     */
+    [[nodiscard]] double Count(std::size_t x, std::size_t y) const;
+    /**
+     * Whole grid, row y starts at y * x.bins
+     */
+    [[nodiscard]] const std::vector<double>& Counts() const;
+    /**
+     * Sum of weights of stars outside of the grid or with undefined quantities
+     */
+    [[nodiscard]] double Dropped() const;
+};
+
+#endif // ASTROLIB_HRDIAGRAM_H
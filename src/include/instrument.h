@@ -0,0 +1,203 @@
+#ifndef ASTROLIB_INSTRUMENT_H
+#define ASTROLIB_INSTRUMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Call counters of library entry points, built in with the ASTROLIB_INSTRUMENT CMake option. Every thread counts
+ * into its own counters without locks or atomic read-modify-write, a snapshot sums them over all threads including
+ * those which have exited. Without the option the probes compile to nothing and snapshots stay empty.
+ *
+ * Time of a probe includes probes called inside it, e.g. StarPipeline::Run includes the StarBatch calls it makes and
+ * StarBatch::parseSpectrum the Star::parseSpectrum calls. Calls of single elements are cheap enough that reading the
+ * clock would dominate, so only one in 16 of them per thread is timed and time of the rest is extrapolated. Timed calls
+ * are also counted in a latency histogram of each probe with buckets of powers of two nanoseconds.
+ */
+class Instrument
+{
+public:
+    /**
+     * instrumented functions
+     */
+    enum Probe
+    {
+        StarRadiusLuminosity = 0,
+        StarBmv2rgb,
+        StarBmv2temp,
+        StarAbsoluteMagnitude,
+        StarApparentMagnitude,
+        StarDistanceFromMagnitude,
+        StarBrightnessRatio,
+        StarMagnitudeDifference,
+        StarMagnitudeSum,
+        StarMoffatFunction,
+        StarMoffatRadius,
+        StarAngularDistance,
+        StarSpectralType,
+        StarLuminosityClass,
+        StarParseSpectrum,
+        StarFormatSpectrum,
+        StarBolometricCorrection,
+        StarColorTemperature,
+        StarLuminosity,
+        StarRadius,
+        BatchRadiusLuminosity,
+        BatchBmv2rgb,
+        BatchParseSpectrum,
+        BatchAbsoluteMagnitude,
+        BatchApparentMagnitude,
+        BatchDistanceFromMagnitude,
+        BatchBrightnessRatio,
+        BatchMagnitudeDifference,
+        BatchColorTemperature,
+        BatchBolometricCorrection,
+        BatchLuminosity,
+        BatchRadius,
+        PipelineRun,
+        HrDiagramAdd,
+        EpochPropagate,
+        CrossMatch,
+        DerivedRefresh,
+        ProbeCount
+    };
+
+    /**
+     * branches and piecewise segments taken, counted per element
+     */
+    enum Segment
+    {
+        /**
+         * bolometricCorrection polynomial for log10 temperature above 3.9, between 3.7 and 3.9 and below 3.7
+         */
+        BolometricCorrectionHot = 0,
+        BolometricCorrectionWarm,
+        BolometricCorrectionCool,
+        /**
+         * colorTemperature polynomial for luminosity classes up to Ib and for the others
+         */
+        ColorTemperatureSupergiant,
+        ColorTemperatureOther,
+        /**
+         * bmv2rgb color index clamped to [-0.4, 2.0]
+         */
+        Bmv2rgbClamped,
+        /**
+         * absoluteMagnitude or apparentMagnitude of distance that is not positive and finite
+         */
+        UnknownDistance,
+        /**
+         * brightnessRatio or magnitudeSum of infinite magnitude
+         */
+        InfiniteMagnitude,
+        /**
+         * parseSpectrum luminosity class taken from lowercase prefix or from roman numeral
+         */
+        SpectrumPrefixClass,
+        SpectrumRomanClass,
+        /**
+         * parseSpectrum found no spectral type or no luminosity class
+         */
+        SpectrumNoType,
+        SpectrumNoClass,
+        SegmentCount
+    };
+
+    /**
+     * buckets of latency histograms, the last one also holds all longer calls
+     */
+    static constexpr std::size_t LATENCY_BUCKETS = 40;
+
+    struct ProbeStats
+    {
+        std::uint64_t calls       = 0;
+        std::uint64_t elements    = 0;
+        std::uint64_t nanoseconds = 0;
+        /**
+         * timed calls by latency, bucket b holds calls of [2^b, 2^(b+1)) nanoseconds and bucket 0 the ones below 2
+         */
+        std::uint64_t latency[LATENCY_BUCKETS]{};
+    };
+
+    /**
+     * Counters summed over all threads since start or the last Reset
+     */
+    struct Snapshot
+    {
+        ProbeStats probes[ProbeCount]{};
+        std::uint64_t segments[SegmentCount]{};
+
+        /**
+         * Table of probes and segments which were hit
+         */
+        [[nodiscard]] std::string Text() const;
+        /**
+         * JSON object with all probes and segments by name
+         */
+        [[nodiscard]] std::string Json() const;
+    };
+
+    /**
+     * Scoped probe, counts one call of elements and time until destruction
+     */
+    class Scope
+    {
+    private:
+        Probe _probe;
+        std::uint64_t _elements;
+        std::uint64_t _start = 0;
+
+    public:
+        Scope(Probe probe, std::size_t elements);
+        ~Scope();
+        Scope(const Scope&)            = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    /**
+     * Whether the library was built with ASTROLIB_INSTRUMENT
+     */
+    static constexpr bool Enabled()
+    {
+#ifdef ASTROLIB_INSTRUMENT
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * Returns current counters, may run concurrently with instrumented calls
+     */
+    static Snapshot Collect();
+    /**
+     * Starts counting from zero
+     */
+    static void Reset();
+    /**
+     * Adds hits to segment on the calling thread
+     */
+    static void Count(Segment segment, std::size_t hits = 1);
+
+    /**
+     * Function name of probe, e.g. "Star::bolometricCorrection"
+     */
+    static const char* Name(Probe probe);
+    /**
+     * Name of segment, e.g. "bolometricCorrection.hot"
+     */
+    static const char* Name(Segment segment);
+};
+
+#ifdef ASTROLIB_INSTRUMENT
+#define ASTROLIB_PROBE(probe, elements) const Instrument::Scope astrolibProbe(Instrument::probe, elements)
+#define ASTROLIB_SEGMENT(segment) Instrument::Count(Instrument::segment)
+#define ASTROLIB_SEGMENTS(segment, hits) Instrument::Count(Instrument::segment, hits)
+#else
+#define ASTROLIB_PROBE(probe, elements) ((void)0)
+#define ASTROLIB_SEGMENT(segment) ((void)0)
+#define ASTROLIB_SEGMENTS(segment, hits) ((void)0)
+#endif
+
+#endif // ASTROLIB_INSTRUMENT_H
@@ -0,0 +1,32 @@
+#ifndef ASTROLIB_MAGNITUDESUM_H
+#define ASTROLIB_MAGNITUDESUM_H
+
+#include <cstddef>
+#include <cstdint>
+#include "threadpool.h"
+
+/**
+ * Integrated magnitudes of many stars, -2.5 log10 of the sum of their fluxes. Every magnitude is converted to flux
+ * relative to the brightest member once, fluxes are added with compensated summation in fixed order, so that results
+ * do not depend on the number of threads, and the total is converted back once.
+ *
+ * Infinite magnitudes follow Star::magnitudeSum: they are skipped, a set with no finite magnitude keeps its first one,
+ * NaN propagates, and an empty set has infinite magnitude.
+ */
+class MagnitudeSum
+{
+public:
+    /**
+     * Integrated magnitude of n stars
+     */
+    static double Total(const double* mag, std::size_t n, ThreadPool& pool = ThreadPool::Default());
+
+    /**
+     * Integrated magnitudes of groups of stars, star i belongs to group[i] and out[k] receives the magnitude of group k
+     * for k < groups. Stars with group index not below groups are ignored.
+     */
+    static void Grouped(const double* mag, const std::uint32_t* group, std::size_t n, double* out, std::size_t groups,
+                        ThreadPool& pool = ThreadPool::Default());
+};
+
+#endif // ASTROLIB_MAGNITUDESUM_H
@@ -0,0 +1,76 @@
+#ifndef ASTROLIB_PHOTOMETRY_H
+#define ASTROLIB_PHOTOMETRY_H
+
+#include <cstddef>
+#include "threadpool.h"
+
+/**
+ * Measurement of one source, pixel centres of the image lie at integer coordinates
+ */
+struct ApertureMeasurement
+{
+    /**
+     * sum of pixel values weighted by aperture overlap minus background
+     */
+    double flux             = 0.0;
+    /**
+     * aperture area inside the image in pixels
+     */
+    double area             = 0.0;
+    /**
+     * sigma clipped median of annulus pixels, NaN and not subtracted from flux if the annulus has no pixels
+     */
+    double background       = 0.0;
+    /**
+     * standard deviation of annulus pixels left after clipping
+     */
+    double backgroundSigma  = 0.0;
+    std::size_t annulusSize = 0;
+    /**
+     * instrumental magnitude zeroPoint + Star::magnitudeDifference(flux), infinite for zero flux and NaN for negative
+     */
+    double magnitude        = 0.0;
+};
+
+/**
+ * Circular aperture photometry. Every pixel is weighted by the exact area of its overlap with the aperture circle,
+ * rows of pixels lying wholly inside are summed in SIMD lanes, and the background is the sigma clipped median of pixels
+ * whose centres fall into an annulus around the aperture. Sources are spread over a thread pool.
+ */
+class AperturePhotometry
+{
+private:
+    double _radius{};
+    double _innerRadius{};
+    double _outerRadius{};
+    double _zeroPoint{};
+    double _clipSigma{};
+    int _clipIterations{};
+    ThreadPool& _pool;
+
+public:
+    /**
+     * @param radius aperture radius in pixels
+     * @param innerRadius inner radius of background annulus in pixels
+     * @param outerRadius outer radius of background annulus in pixels
+     * @param zeroPoint magnitude of unit flux
+     * @param clipSigma annulus pixels further than clipSigma standard deviations from median are rejected
+     * @param clipIterations limit of clipping passes
+     * @param pool threads to run on
+     */
+    AperturePhotometry(double radius, double innerRadius, double outerRadius, double zeroPoint = 0.0,
+                       double clipSigma = 3.0, int clipIterations = 5, ThreadPool& pool = ThreadPool::Default());
+
+    /**
+     * Measures n sources centred at (x[i], y[i]) on image of width * height values in row-major order
+     */
+    void Measure(const float* image, std::size_t width, std::size_t height, const double* x, const double* y,
+                 std::size_t n, ApertureMeasurement* out) const;
+
+    /**
+     * Exact area of intersection of circle of radius r centred at the origin with rectangle [x0, x1] x [y0, y1]
+     */
+    static double Overlap(double x0, double y0, double x1, double y1, double r);
+};
+
+#endif // ASTROLIB_PHOTOMETRY_H
@@ -0,0 +1,69 @@
+#ifndef ASTROLIB_PIPELINE_H
+#define ASTROLIB_PIPELINE_H
+
+#include <cstddef>
+#include <string_view>
+#include "catalog.h"
+#include "threadpool.h"
+
+/**
+ * Output columns of StarPipeline, every non-null array receives one value per star
+ */
+struct DerivedColumns
+{
+    /**
+     * surface temperature from B-V color index, see Star::colorTemperature
+     */
+    double* temperature = nullptr;
+    /**
+     * see Star::bolometricCorrection
+     */
+    double* bolometricCorrection = nullptr;
+    /**
+     * absolute visual magnitude from parallax distance, see Star::absoluteMagnitude
+     */
+    double* absoluteMagnitude = nullptr;
+    /**
+     * total luminosity in solar luminosities, see Star::luminosity
+     */
+    double* luminosity = nullptr;
+    /**
+     * radius in solar radii, see Star::radius
+     */
+    double* radius = nullptr;
+};
+
+/**
+ * Derives physical quantities of catalog stars with the fixed chain parseSpectrum, colorTemperature,
+ * bolometricCorrection, absoluteMagnitude, luminosity and radius. All stages are fused, a block of stars runs through
+ * the whole chain while it is in cache, and blocks are spread over a work-stealing thread pool.
+ */
+class StarPipeline
+{
+private:
+    ThreadPool& _pool;
+    std::size_t _grain{};
+
+public:
+    /**
+     * @param pool threads to run on
+     * @param grain number of stars processed by one task
+     */
+    explicit StarPipeline(ThreadPool& pool = ThreadPool::Default(), std::size_t grain = 16384);
+
+    /**
+     * Runs the chain over all stars of catalog, luminosity classes are taken from catalog codes
+     */
+    void Run(const StarCatalog& catalog, const DerivedColumns& out) const;
+    /**
+     * Runs the chain over all stars of catalog, luminosity classes are parsed from spectra, one string per star
+     */
+    void Run(const StarCatalog& catalog, const std::string_view* spectra, const DerivedColumns& out) const;
+    /**
+     * Runs the chain over stars [begin, end) of catalog writing to out at the same indices
+     */
+    void Run(const StarCatalog& catalog, const std::string_view* spectra, const DerivedColumns& out,
+             std::size_t begin, std::size_t end) const;
+};
+
+#endif // ASTROLIB_PIPELINE_H
@@ -0,0 +1,77 @@
+#ifndef ASTROLIB_PSFFIT_H
+#define ASTROLIB_PSFFIT_H
+
+#include <cstddef>
+#include "threadpool.h"
+
+/**
+ * Moffat point spread function background + Star::moffatFunction(peak, r^2 / width^2, beta), where r is the distance
+ * from centre (x, y) in pixels. Pixel centres of a cutout lie at integer coordinates starting from 0.
+ */
+struct MoffatParameters
+{
+    double x          = 0.0;
+    double y          = 0.0;
+    double peak       = 0.0;
+    /**
+     * core width alpha in pixels, full width at half maximum is 2 * width * sqrt(2^(1 / beta) - 1)
+     */
+    double width      = 1.0;
+    double beta       = 2.5;
+    double background = 0.0;
+};
+
+struct MoffatFit
+{
+    MoffatParameters parameters{};
+    /**
+     * sum of squared residuals
+     */
+    double chi2    = 0.0;
+    int iterations = 0;
+    /**
+     * false if iteration limit was reached before relative change fell below tolerance
+     */
+    bool converged = false;
+};
+
+/**
+ * Levenberg-Marquardt least squares fitter of the Moffat model to small image cutouts. The Jacobian is analytic, model
+ * and derivatives are evaluated in SIMD lanes into per-thread scratch buffers reused between fits, and batches of
+ * cutouts are spread over a thread pool.
+ */
+class MoffatFitter
+{
+private:
+    int _maxIterations{};
+    double _tolerance{};
+    ThreadPool& _pool;
+
+public:
+    /**
+     * @param maxIterations limit of accepted steps per fit
+     * @param tolerance relative change of chi2 and parameters at which a fit is converged
+     * @param pool threads to run on
+     */
+    explicit MoffatFitter(int maxIterations = 50, double tolerance = 1e-8, ThreadPool& pool = ThreadPool::Default());
+
+    /**
+     * Starting point estimated from cutout moments, background from the cutout border
+     */
+    static MoffatParameters Guess(const float* cutout, std::size_t width, std::size_t height);
+
+    /**
+     * Fits one cutout of width * height pixels in row-major order
+     */
+    [[nodiscard]] MoffatFit Fit(const float* cutout, std::size_t width, std::size_t height,
+                                const MoffatParameters& initial) const;
+    /**
+     * Fits n cutouts of width * height pixels stored back to back
+     * @param initial starting points, one per cutout, or nullptr to start from Guess
+     * @param fits receives one result per cutout
+     */
+    void Fit(const float* cutouts, std::size_t width, std::size_t height, std::size_t n,
+             const MoffatParameters* initial, MoffatFit* fits) const;
+};
+
+#endif // ASTROLIB_PSFFIT_H
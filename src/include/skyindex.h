@@ -0,0 +1,85 @@
+#ifndef ASTROLIB_SKYINDEX_H
+#define ASTROLIB_SKYINDEX_H
+
+#include <cstddef>
+#include <vector>
+#include "catalog.h"
+#include "threadpool.h"
+
+/**
+ * Spatial index of sky positions for cone, box and nearest neighbour searches. Positions are stored as unit vectors
+ * in a balanced k-d tree split at the median of the widest axis, leaves hold a few dozen stars and every node keeps
+ * the bounding box of its stars, so searches have no singularities at the poles or at right ascension 0. Halves of
+ * the tree are built in parallel. Stars with non-finite position are not indexed.
+ *
+ * All angles are in degrees, searches return indices into the arrays the index was built from.
+ */
+class SkyIndex
+{
+private:
+    struct Entry
+    {
+        double v[3]{};
+        std::size_t index = 0;
+    };
+
+    /**
+     * bounding box of node stars, widened to the nearest float values outside of it
+     */
+    struct Node
+    {
+        float lo[3]{};
+        float hi[3]{};
+    };
+
+    std::vector<Entry> _entries{};
+    std::vector<Node> _nodes{};
+    /**
+     * level of leaves, the tree is complete and node k has children 2k + 1 and 2k + 2
+     */
+    std::size_t _depth{};
+
+    void Build(std::size_t node, std::size_t level, ThreadPool& pool);
+    [[nodiscard]] std::size_t RangeBegin(std::size_t node, std::size_t level) const;
+
+public:
+    /**
+     * Indexes n stars at right ascension ra[i] and declination dec[i]
+     */
+    SkyIndex(const double* ra, const double* dec, std::size_t n, ThreadPool& pool = ThreadPool::Default());
+    explicit SkyIndex(const StarCatalog& catalog, ThreadPool& pool = ThreadPool::Default());
+
+    /**
+     * number of indexed stars
+     */
+    [[nodiscard]] std::size_t Size() const;
+
+    /**
+     * Appends stars within angular distance radius of (ra, dec) to out, in no particular order
+     */
+    void Cone(double ra, double dec, double radius, std::vector<std::size_t>& out) const;
+    [[nodiscard]] std::vector<std::size_t> Cone(double ra, double dec, double radius) const;
+
+    /**
+     * Appends stars with raMin <= ra <= raMax and decMin <= dec <= decMax to out, in no particular order. The right
+     * ascension range wraps through 0 when raMin > raMax and covers the whole circle when raMax - raMin >= 360.
+     */
+    void Box(double raMin, double raMax, double decMin, double decMax, std::vector<std::size_t>& out) const;
+    [[nodiscard]] std::vector<std::size_t> Box(double raMin, double raMax, double decMin, double decMax) const;
+
+    /**
+     * Up to k stars closest to (ra, dec), nearest first
+     */
+    [[nodiscard]] std::vector<std::size_t> Nearest(double ra, double dec, std::size_t k) const;
+
+    /**
+     * Unit vector pointing to (ra, dec)
+     */
+    static void UnitVector(double ra, double dec, double v[3]);
+    /**
+     * Squared length of chord between unit vectors separated by angle, see Star::angularDistance
+     */
+    static double ChordSquared(double angle);
+};
+
+#endif // ASTROLIB_SKYINDEX_H
@@ -0,0 +1,125 @@
+#ifndef ASTROLIB_SPECTRUMDICTIONARY_H
+#define ASTROLIB_SPECTRUMDICTIONARY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * Interned spectral type strings. Every distinct string gets a 32-bit id once, together with its spectral type and
+ * luminosity class codes and its formatted form, so that catalogs repeating a few thousand spectra over millions of
+ * stars parse and allocate each of them once. Ids are dense from 0, the empty string is always id 0.
+ *
+ * All functions may be called concurrently. Every thread first looks strings up in a small cache of its own without
+ * locks, misses go to one of SHARDS hash maps under a shared lock and new strings are inserted under an exclusive lock
+ * of that shard only. Entries never move or change once their id is handed out, so reading them by id takes no lock.
+ */
+class SpectrumDictionary
+{
+public:
+    using Id = std::uint32_t;
+
+    /**
+     * id of the empty spectrum
+     */
+    static constexpr Id EMPTY = 0;
+
+private:
+    struct Entry
+    {
+        std::string spectrum{};
+        std::string formatted{};
+        int spectype = 0;
+        int lumclass = 0;
+        bool parsed  = false;
+        /**
+         * set once all fields are written
+         */
+        std::atomic<bool> ready{false};
+    };
+
+    static constexpr unsigned SHARD_BITS    = 6;
+    static constexpr std::size_t SHARDS     = std::size_t{1} << SHARD_BITS;
+    static constexpr unsigned CHUNK_BITS    = 10;
+    static constexpr std::size_t CHUNK      = std::size_t{1} << CHUNK_BITS;
+    static constexpr std::size_t MAX_CHUNKS = 4096;
+    /**
+     * codes formatted by Format, spectral types [0, 140) times luminosity classes [0, 11)
+     */
+    static constexpr int SPECTYPES  = 140;
+    static constexpr int LUMCLASSES = 11;
+
+    struct alignas(64) Shard
+    {
+        std::shared_mutex mutex{};
+        std::unordered_map<std::string_view, Id> ids{};
+    };
+
+    std::unique_ptr<Shard[]> _shards;
+    /**
+     * entries in chunks of CHUNK allocated on first use, chunk k holds ids [k * CHUNK, (k + 1) * CHUNK)
+     */
+    std::unique_ptr<std::atomic<Entry*>[]> _chunks;
+    std::atomic<Id> _size{0};
+    std::unique_ptr<std::atomic<Id>[]> _formats;
+    /**
+     * unique over all dictionaries ever constructed, tags entries of thread caches
+     */
+    std::uint64_t _serial{};
+
+    Entry& Allocate(Id id);
+    [[nodiscard]] const Entry* Find(Id id) const;
+    [[nodiscard]] const Entry& At(Id id) const;
+
+public:
+    SpectrumDictionary();
+    ~SpectrumDictionary();
+    SpectrumDictionary(const SpectrumDictionary&)            = delete;
+    SpectrumDictionary& operator=(const SpectrumDictionary&) = delete;
+
+    /**
+     * Returns id of spectrum, adding it if new. Throws std::length_error past 2^22 distinct strings.
+     */
+    Id Intern(std::string_view spectrum);
+    /**
+     * Returns id of Star::formatSpectrum(spectype, lumclass), formatted once per pair of codes
+     */
+    Id Format(int spectype, int lumclass);
+
+    /**
+     * Whether id was returned by this dictionary
+     */
+    [[nodiscard]] bool Contains(Id id) const;
+    /**
+     * Entry of id returned by this dictionary, references stay valid for the lifetime of the dictionary. Throws
+     * std::out_of_range for other ids.
+     */
+    [[nodiscard]] const std::string& Spectrum(Id id) const;
+    /**
+     * codes and result of Star::parseSpectrum
+     */
+    [[nodiscard]] int SpectralType(Id id) const;
+    [[nodiscard]] int LuminosityClass(Id id) const;
+    [[nodiscard]] bool Parsed(Id id) const;
+    /**
+     * Spectrum formatted back from its codes, e.g. "G2V" for "dG2"
+     */
+    [[nodiscard]] const std::string& Formatted(Id id) const;
+
+    /**
+     * Number of ids handed out
+     */
+    [[nodiscard]] std::size_t Size() const;
+
+    /**
+     * Dictionary shared by all Star objects, never destroyed
+     */
+    static SpectrumDictionary& Default();
+};
+
+#endif // ASTROLIB_SPECTRUMDICTIONARY_H
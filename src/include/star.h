@@ -1,7 +1,9 @@
 #ifndef ASTROLIB_STAR_H
 #define ASTROLIB_STAR_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 class Star
 {
@@ -35,9 +37,25 @@ private:
      */
     double _Bmagnitude{};
     /**
-     * spectral type string
+     * right ascension in degrees, ICRS at J2000
      */
-    std::string _spectrum{};
+    double _ra{};
+    /**
+     * declination in degrees, ICRS at J2000
+     */
+    double _dec{};
+    /**
+     * proper motion in right ascension times cosine of declination, in milliarcseconds per year
+     */
+    double _pmra{};
+    /**
+     * proper motion in declination in milliarcseconds per year
+     */
+    double _pmdec{};
+    /**
+     * id of spectral type string in SpectrumDictionary::Default()
+     */
+    std::uint32_t _spectrum{};
 
 public:
     /**
@@ -61,10 +79,60 @@ public:
      * @param photosphereTemperature in kelvin
      */
     void SetPhotosphereTemperature(double photosphereTemperature);
+    /**
+     * @param parallax in arcseconds, zero if unknown
+     */
+    void SetParallax(double parallax);
+    /**
+     * @param radvel as fraction of light speed, infinite if unknown
+     */
+    void SetRadialVelocity(double radvel);
+    /**
+     * @param Vmagnitude visual magnitude at J2000
+     */
+    void SetVmagnitude(double Vmagnitude);
+    /**
+     * @param Bmagnitude blue magnitude at J2000
+     */
+    void SetBmagnitude(double Bmagnitude);
+    /**
+     * @param ra right ascension in degrees
+     */
+    void SetRightAscension(double ra);
+    /**
+     * @param dec declination in degrees
+     */
+    void SetDeclination(double dec);
+    /**
+     * @param pmra proper motion in right ascension times cosine of declination, in milliarcseconds per year
+     */
+    void SetProperMotionRa(double pmra);
+    /**
+     * @param pmdec proper motion in declination in milliarcseconds per year
+     */
+    void SetProperMotionDec(double pmdec);
+    /**
+     * @param spectrum spectral type string
+     */
+    void SetSpectrum(const std::string& spectrum);
+    /**
+     * @param id spectral type string id in SpectrumDictionary::Default(), throws std::out_of_range for ids not in it
+     */
+    void SetSpectrumId(std::uint32_t id);
 
     [[nodiscard]] double GetMass() const;
     [[nodiscard]] double GetRadius() const;
     [[nodiscard]] double GetPhotosphereTemperature() const;
+    [[nodiscard]] double GetParallax() const;
+    [[nodiscard]] double GetRadialVelocity() const;
+    [[nodiscard]] double GetVmagnitude() const;
+    [[nodiscard]] double GetBmagnitude() const;
+    [[nodiscard]] double GetRightAscension() const;
+    [[nodiscard]] double GetDeclination() const;
+    [[nodiscard]] double GetProperMotionRa() const;
+    [[nodiscard]] double GetProperMotionDec() const;
+    [[nodiscard]] const std::string& GetSpectrum() const;
+    [[nodiscard]] std::uint32_t GetSpectrumId() const;
 
     /**
      * Measure of the total amount of energy radiated by a star or other celestial object per second
@@ -132,6 +200,16 @@ public:
      */
     static double moffatRadius(double z, double max, double beta);
 
+    /**
+     * Returns angle between two sky positions, accurate at any separation
+     * @param ra1 right ascension of the first position in degrees
+     * @param dec1 declination of the first position in degrees
+     * @param ra2 right ascension of the second position in degrees
+     * @param dec2 declination of the second position in degrees
+     * @return angular distance in degrees
+     */
+    static double angularDistance(double ra1, double dec1, double ra2, double dec2);
+
     /**
      * spectral types
      */
@@ -173,15 +251,15 @@ public:
     /**
      * Given a stellar spectral class string, returns integer code for spectral type
      */
-    static int spectralType(const std::string& spectrum);
+    static int spectralType(std::string_view spectrum);
     /**
      * Given a stellar spectral class string, returns integer code for luminosity class
      */
-    static int luminosityClass(const std::string& spectrum);
+    static int luminosityClass(std::string_view spectrum);
     /**
-     * Given a stellar spectral class string, parses integer code for spectral type and luminosity class
+     * Given a stellar spectral class string, parses integer code for spectral type and luminosity class in one pass
      */
-    static bool parseSpectrum(const std::string& spectrum, int& spectype, int& lumclass);
+    static bool parseSpectrum(std::string_view spectrum, int& spectype, int& lumclass);
     /**
      * Given an integer spectral type and luminosity class code, formats and returns equivalent spectral class string
      */
@@ -0,0 +1,67 @@
+#ifndef ASTROLIB_STARFIELD_H
+#define ASTROLIB_STARFIELD_H
+
+#include <cstddef>
+#include "threadpool.h"
+
+/**
+ * Star image on a frame, pixel centres lie at integer coordinates
+ */
+struct FieldStar
+{
+    double x    = 0.0;
+    double y    = 0.0;
+    /**
+     * value of the profile at the centre
+     */
+    double peak = 0.0;
+    /**
+     * Moffat beta, see Star::moffatFunction
+     */
+    double beta = 1.0;
+    /**
+     * B-V color index used for RGB frames, see Star::bmv2rgb
+     */
+    double bmv  = 0.0;
+};
+
+/**
+ * Renders synthetic star fields with Moffat profiles. Every star is cut at the radius where its profile drops to the
+ * threshold, see Star::moffatRadius, and binned into square tiles it overlaps. Tiles are rendered independently on a
+ * thread pool so that one tile of the frame stays in cache and no two threads write the same pixel, the profile along a
+ * row is evaluated in SIMD lanes.
+ */
+class StarFieldRenderer
+{
+private:
+    std::size_t _width{};
+    std::size_t _height{};
+    double _threshold{};
+    ThreadPool& _pool;
+    std::size_t _tile{};
+
+    template <std::size_t Channels>
+    void RenderTiles(const FieldStar* stars, std::size_t n, float* image) const;
+
+public:
+    /**
+     * @param width frame width in pixels
+     * @param height frame height in pixels
+     * @param threshold smallest profile value rendered, any pixel of a star below it is dropped
+     * @param pool threads to run on
+     * @param tile side of a square tile in pixels
+     */
+    StarFieldRenderer(std::size_t width, std::size_t height, double threshold = 1e-3,
+                      ThreadPool& pool = ThreadPool::Default(), std::size_t tile = 64);
+
+    /**
+     * Adds stars to grey frame of width * height values in row-major order
+     */
+    void Render(const FieldStar* stars, std::size_t n, float* image) const;
+    /**
+     * Adds stars colored by Star::bmv2rgb to interleaved RGB frame of 3 * width * height values in row-major order
+     */
+    void RenderRgb(const FieldStar* stars, std::size_t n, float* rgb) const;
+};
+
+#endif // ASTROLIB_STARFIELD_H
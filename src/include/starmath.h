@@ -0,0 +1,324 @@
+#ifndef ASTROLIB_STARMATH_H
+#define ASTROLIB_STARMATH_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "constants.h"
+
+/**
+ * Header-only core of Star calculations on scalar type T, double or float. Pure arithmetic functions are constexpr
+ * and fold for constant inputs, the ones needing libm are inline, so that hot loops inline the whole calculation. Star
+ * functions forward to StarMath and give the same results, StarMathF runs the same arithmetic in single precision.
+ */
+template <class T>
+class BasicStarMath
+{
+public:
+    /**
+     * colorTemperature log10 polynomial coefficients in ascending powers of B-V, for luminosity classes up to Ib
+     */
+    static constexpr double COLOR_TEMPERATURE_SUPERGIANT[] = {4.012559732366214,  -1.055043117465989,
+                                                              2.133394538571825,  -2.459769794654992,
+                                                              1.349423943497744,  -0.283942579112032};
+    /**
+     * colorTemperature log10 polynomial coefficients in ascending powers of B-V, for other luminosity classes
+     */
+    static constexpr double COLOR_TEMPERATURE_OTHER[] = {3.979145106714099,  -0.654992268598245, 1.740690042385095,
+                                                         -4.608815154057166, 6.792599779944473,  -5.396909891322525,
+                                                         2.192970376522490,  -0.359495739295671};
+    /**
+     * bolometricCorrection polynomial coefficients in ascending powers of log10 temperature, for log10 temperature
+     * above 3.9, between 3.7 and 3.9 and below 3.7
+     */
+    static constexpr double BOLOMETRIC_CORRECTION_HOT[]  = {-0.118115450538963E+06, 0.137145973583929E+06,
+                                                            -0.636233812100225E+05, 0.147412923562646E+05,
+                                                            -0.170587278406872E+04, 0.788731721804990E+02};
+    static constexpr double BOLOMETRIC_CORRECTION_WARM[] = {-0.370510203809015E+05, 0.385672629965804E+05,
+                                                            -0.150651486316025E+05, 0.261724637119416E+04,
+                                                            -0.170623810323864E+03};
+    static constexpr double BOLOMETRIC_CORRECTION_COOL[] = {-0.190537291496456E+05, 0.155144866764412E+05,
+                                                            -0.421278819301717E+04, 0.381476328422343E+03};
+
+    /**
+     * spectral type letters in order of Star::SpecType codes
+     */
+    static constexpr char SPECTRAL_TYPES[] = "WOBAFGKMLTCRNS";
+    /**
+     * luminosity class names indexed by Star::LumClass code, white dwarfs are written as D prefix instead
+     */
+    static constexpr const char* LUMINOSITY_CLASSES[] = {"",    "Ia0", "Ia", "Iab", "Ib", "II",
+                                                         "III", "IV",  "V",  "VI",  ""};
+
+    /**
+     * character classes used by spectrum parser, low bits hold index + 1 of spectral type letter, ROMAN_START marks I
+     * and V which start a luminosity class numeral
+     */
+    static constexpr std::uint8_t SPECTRAL_TYPE_MASK = 0x0F;
+    static constexpr std::uint8_t ROMAN_START        = 0x10;
+    static constexpr std::array<std::uint8_t, 256> SPECTRUM_CHAR_CLASS = [] {
+        std::array<std::uint8_t, 256> table{};
+        for (std::uint8_t k = 0; k < sizeof(SPECTRAL_TYPES) - 1; k++) {
+            table[static_cast<unsigned char>(SPECTRAL_TYPES[k])] = k + 1;
+        }
+        table['I'] = ROMAN_START;
+        table['V'] = ROMAN_START;
+        return table;
+    }();
+
+    /**
+     * Returns spectral type code of letter at subclass 0, negative if letter is not a spectral type
+     */
+    static constexpr int spectralTypeCode(char letter)
+    {
+        const int k = SPECTRUM_CHAR_CLASS[static_cast<unsigned char>(letter)] & SPECTRAL_TYPE_MASK;
+        return k ? (k - 1) * 10 : -1;
+    }
+    /**
+     * Returns spectral type letter of spectral type code
+     */
+    static constexpr char spectralTypeLetter(int spectype)
+    {
+        return SPECTRAL_TYPES[spectype / 10];
+    }
+
+    /**
+     * Sum c[0] + c[1] x + c[2] x x + ... evaluated left to right with every power as repeated product
+     */
+    template <std::size_t N>
+    static constexpr double powerSum(const double (&c)[N], double x)
+    {
+        double sum = c[0];
+        for (std::size_t k = 1; k < N; k++) {
+            double term = c[k];
+            for (std::size_t j = 0; j < k; j++) {
+                term = term * x;
+            }
+            sum = sum + term;
+        }
+        return sum;
+    }
+
+    /**
+     * see Star::Luminosity
+     */
+    static constexpr T Luminosity(T radius, T photosphereTemperature)
+    {
+        const T t2 = photosphereTemperature * photosphereTemperature;
+        return 4 * T(PI_NUMBER) * (radius * radius) * T(STEFAN_BOLTZMANN_CONSTANT) * (t2 * t2);
+    }
+
+    /**
+     * see Star::bmv2rgb
+     */
+    static constexpr void bmv2rgb(T bv, T& r, T& g, T& b)
+    {
+        T t = r = g = b = T(0.0);
+
+        if (bv < T(-0.4)) {
+            bv = T(-0.4);
+        }
+
+        if (bv > T(2.0)) {
+            bv = T(2.0);
+        }
+
+        // red
+        if (bv >= T(-0.40) && bv < T(0.00)) {
+            t = (bv + T(0.40)) / (T(0.00) + T(0.40));
+            r = T(0.61) + (T(0.11) * t) + (T(0.1) * t * t);
+        } else if (bv >= T(0.00) && bv < T(0.40)) {
+            t = (bv - T(0.00)) / (T(0.40) - T(0.00));
+            r = T(0.83) + (T(0.17) * t);
+        } else if (bv >= T(0.40) && bv < T(2.10)) {
+            r = T(1.00);
+        }
+
+        // green
+        if (bv >= T(-0.40) && bv < T(0.00)) {
+            t = (bv + T(0.40)) / (T(0.00) + T(0.40));
+            g = T(0.70) + (T(0.07) * t) + (T(0.1) * t * t);
+        } else if (bv >= T(0.00) && bv < T(0.40)) {
+            t = (bv - T(0.00)) / (T(0.40) - T(0.00));
+            g = T(0.87) + (T(0.11) * t);
+        } else if (bv >= T(0.40) && bv < T(1.60)) {
+            t = (bv - T(0.40)) / (T(1.60) - T(0.40));
+            g = T(0.98) - (T(0.16) * t);
+        } else if (bv >= T(1.60) && bv < T(2.00)) {
+            t = (bv - T(1.60)) / (T(2.00) - T(1.60));
+            g = T(0.82) - (T(0.5) * t * t);
+        }
+
+        // blue
+        if (bv >= T(-0.40) && bv < T(0.40)) {
+            b = T(1.00);
+        } else if (bv >= T(0.40) && bv < T(1.50)) {
+            t = (bv - T(0.40)) / (T(1.50) - T(0.40));
+            b = T(1.00) - (T(0.47) * t) + (T(0.1) * t * t);
+        } else if (bv >= T(1.50) && bv < T(1.94)) {
+            t = (bv - T(1.50)) / (T(1.94) - T(1.50));
+            b = T(0.63) - (T(0.6) * t * t);
+        }
+    }
+
+    /**
+     * see Star::bmv2temp
+     */
+    static constexpr T bmv2temp(T bv)
+    {
+        return T(4600.0) * ((T(1.0) / ((T(0.92) * bv) + T(1.7))) + (T(1.0) / ((T(0.92) * bv) + T(0.62))));
+    }
+
+    /**
+     * log10 of Star::colorTemperature. The polynomial fits cancel to many digits, so they are evaluated in double
+     * also for float and only the result is rounded.
+     */
+    static constexpr T colorTemperatureLog(T bv, int lumClass)
+    {
+        // luminosity classes up to Ib are supergiants
+        const double x = bv;
+        return T(lumClass <= 4 ? powerSum(COLOR_TEMPERATURE_SUPERGIANT, x) : powerSum(COLOR_TEMPERATURE_OTHER, x));
+    }
+    /**
+     * see Star::colorTemperature
+     */
+    static T colorTemperature(T bv, int lumClass)
+    {
+        return T(std::pow(10.0, BasicStarMath<double>::colorTemperatureLog(bv, lumClass)));
+    }
+
+    /**
+     * Star::bolometricCorrection of log10 temperature, evaluated in double as colorTemperatureLog
+     */
+    static constexpr T bolometricCorrectionLog(double t)
+    {
+        if (t > 3.9) {
+            return T(powerSum(BOLOMETRIC_CORRECTION_HOT, t));
+        } else if (t > 3.7) {
+            return T(powerSum(BOLOMETRIC_CORRECTION_WARM, t));
+        } else {
+            return T(powerSum(BOLOMETRIC_CORRECTION_COOL, t));
+        }
+    }
+    /**
+     * see Star::bolometricCorrection
+     */
+    static T bolometricCorrection(T temp)
+    {
+        return bolometricCorrectionLog(std::log10(double(temp)));
+    }
+
+    /**
+     * see Star::absoluteMagnitude
+     */
+    static T absoluteMagnitude(T appMag, T dist)
+    {
+        if (dist > T(0.0) && dist < T(INFINITY)) {
+            return appMag - T(5.0) * (std::log10(dist) - T(1.0));
+        } else {
+            return T(-INFINITY);
+        }
+    }
+    /**
+     * see Star::apparentMagnitude
+     */
+    static T apparentMagnitude(T absMag, T dist)
+    {
+        if (dist > T(0.0) && dist < T(INFINITY)) {
+            return absMag + T(5.0) * (std::log10(dist) - T(1.0));
+        } else {
+            return dist <= T(0.0) ? T(-INFINITY) : T(INFINITY);
+        }
+    }
+    /**
+     * see Star::distanceFromMagnitude
+     */
+    static T distanceFromMagnitude(T appMag, T absMag)
+    {
+        return std::pow(T(10.0), (appMag - absMag) / T(5.0) + T(1.0));
+    }
+    /**
+     * see Star::brightnessRatio
+     */
+    static T brightnessRatio(T magDiff)
+    {
+        if (std::isinf(magDiff)) {
+            return magDiff > T(0.0) ? T(INFINITY) : T(0.0);
+        } else {
+            return std::pow(T(10.0), magDiff / T(2.5));
+        }
+    }
+    /**
+     * see Star::magnitudeDifference
+     */
+    static T magnitudeDifference(T ratio)
+    {
+        return T(-2.5) * std::log10(ratio);
+    }
+    /**
+     * see Star::magnitudeSum
+     */
+    static T magnitudeSum(T mag1, T mag2)
+    {
+        if (std::isinf(mag2)) {
+            return mag1;
+        } else if (std::isinf(mag1)) {
+            return mag2;
+        } else {
+            return mag2 + magnitudeDifference(T(1.0) + brightnessRatio(mag1 - mag2));
+        }
+    }
+
+    /**
+     * see Star::moffatFunction
+     */
+    static T moffatFunction(T max, T r2, T beta)
+    {
+        return max / std::pow(T(1.0) + r2, beta);
+    }
+    /**
+     * see Star::moffatRadius
+     */
+    static T moffatRadius(T z, T max, T beta)
+    {
+        return std::sqrt(std::pow(max / z, T(1.0) / beta) - T(1.0));
+    }
+
+    /**
+     * see Star::angularDistance, Vincenty formula
+     */
+    static T angularDistance(T ra1, T dec1, T ra2, T dec2)
+    {
+        constexpr T RADIAN = T(PI_NUMBER / 180.0);
+        const T dra        = (ra2 - ra1) * RADIAN;
+        const T sin1       = std::sin(dec1 * RADIAN);
+        const T cos1       = std::cos(dec1 * RADIAN);
+        const T sin2       = std::sin(dec2 * RADIAN);
+        const T cos2       = std::cos(dec2 * RADIAN);
+        const T east       = cos2 * std::sin(dra);
+        const T north      = cos1 * sin2 - sin1 * cos2 * std::cos(dra);
+        return std::atan2(std::hypot(east, north), sin1 * sin2 + cos1 * cos2 * std::cos(dra)) / RADIAN;
+    }
+
+    /**
+     * see Star::luminosity
+     */
+    static T luminosity(T mv, T bc)
+    {
+        return brightnessRatio(T(4.725) - mv - bc);
+    }
+    /**
+     * see Star::radius
+     */
+    static T radius(T lum, T temp)
+    {
+        temp = T(5770.0) / temp;
+        return temp * temp * std::sqrt(lum);
+    }
+};
+
+using StarMath  = BasicStarMath<double>;
+using StarMathF = BasicStarMath<float>;
+
+#endif // ASTROLIB_STARMATH_H
@@ -0,0 +1,85 @@
+#ifndef ASTROLIB_THREADPOOL_H
+#define ASTROLIB_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Work-stealing thread pool for data parallel loops. A range is split in halves down to the grain size, every worker
+ * keeps its own deque of ranges, works on the newest one and steals the oldest, i.e. the largest, ranges from other
+ * workers when it runs out of work. Threads calling ParallelFor take part in the work, nested calls are allowed.
+ */
+class ThreadPool
+{
+private:
+    struct Job;
+
+    struct Task
+    {
+        Job* job;
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    /**
+     * one queue per worker plus a shared one for threads outside of pool
+     */
+    std::vector<std::unique_ptr<Queue>> _queues{};
+    std::vector<std::thread> _workers{};
+    std::atomic<std::size_t> _queued{0};
+    std::atomic<bool> _stop{false};
+    std::mutex _sleepMutex{};
+    std::condition_variable _wake{};
+
+    void Push(std::size_t queue, const Task& task);
+    bool Pop(std::size_t queue, Task& task);
+    bool Steal(std::size_t queue, Task& task);
+    void Execute(std::size_t queue, Task task);
+    void WorkerLoop(std::size_t queue);
+    [[nodiscard]] std::size_t CurrentQueue() const;
+
+public:
+    /**
+     * @param threads number of threads working on a loop including the calling one, zero to use all hardware threads
+     */
+    explicit ThreadPool(unsigned threads = 0);
+    /**
+     * waits for workers to finish
+     */
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * number of threads working on a loop, workers and the calling thread
+     */
+    [[nodiscard]] unsigned Concurrency() const;
+
+    /**
+     * Calls body(rangeBegin, rangeEnd) over disjoint subranges of [begin, end) no larger than grain and returns when
+     * all of them are done. The first exception thrown by body is rethrown.
+     */
+    void ParallelFor(std::size_t begin, std::size_t end, std::size_t grain,
+                     const std::function<void(std::size_t, std::size_t)>& body);
+
+    /**
+     * pool shared by library algorithms, sized to hardware threads
+     */
+    static ThreadPool& Default();
+};
+
+#endif // ASTROLIB_THREADPOOL_H
@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+#include "include/instrument.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define ASTROLIB_TSC 1
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define ASTROLIB_TSC 1
+#endif
+
+static const char* const PROBE_NAMES[] = {
+        "Star::Luminosity",
+        "Star::bmv2rgb",
+        "Star::bmv2temp",
+        "Star::absoluteMagnitude",
+        "Star::apparentMagnitude",
+        "Star::distanceFromMagnitude",
+        "Star::brightnessRatio",
+        "Star::magnitudeDifference",
+        "Star::magnitudeSum",
+        "Star::moffatFunction",
+        "Star::moffatRadius",
+        "Star::angularDistance",
+        "Star::spectralType",
+        "Star::luminosityClass",
+        "Star::parseSpectrum",
+        "Star::formatSpectrum",
+        "Star::bolometricCorrection",
+        "Star::colorTemperature",
+        "Star::luminosity",
+        "Star::radius",
+        "StarBatch::Luminosity",
+        "StarBatch::bmv2rgb",
+        "StarBatch::parseSpectrum",
+        "StarBatch::absoluteMagnitude",
+        "StarBatch::apparentMagnitude",
+        "StarBatch::distanceFromMagnitude",
+        "StarBatch::brightnessRatio",
+        "StarBatch::magnitudeDifference",
+        "StarBatch::colorTemperature",
+        "StarBatch::bolometricCorrection",
+        "StarBatch::luminosity",
+        "StarBatch::radius",
+        "StarPipeline::Run",
+        "HrDiagram::Add",
+        "EpochPropagator::Propagate",
+        "CrossMatcher::Match",
+        "DerivedCache::Refresh",
+};
+static_assert(sizeof(PROBE_NAMES) / sizeof(PROBE_NAMES[0]) == Instrument::ProbeCount);
+
+static const char* const SEGMENT_NAMES[] = {
+        "bolometricCorrection.hot",
+        "bolometricCorrection.warm",
+        "bolometricCorrection.cool",
+        "colorTemperature.supergiant",
+        "colorTemperature.other",
+        "bmv2rgb.clamped",
+        "magnitude.unknownDistance",
+        "magnitude.infinite",
+        "parseSpectrum.prefixClass",
+        "parseSpectrum.romanClass",
+        "parseSpectrum.noType",
+        "parseSpectrum.noClass",
+};
+static_assert(sizeof(SEGMENT_NAMES) / sizeof(SEGMENT_NAMES[0]) == Instrument::SegmentCount);
+
+/**
+ * single element calls timed, one in SAMPLE per thread and probe, time of the others is extrapolated
+ */
+static constexpr std::uint64_t SAMPLE = 16;
+
+/**
+ * Plain sums of counters, time in ticks of timed calls
+ */
+struct Totals
+{
+    std::uint64_t calls[Instrument::ProbeCount]{};
+    std::uint64_t elements[Instrument::ProbeCount]{};
+    std::uint64_t ticks[Instrument::ProbeCount]{};
+    std::uint64_t timed[Instrument::ProbeCount]{};
+    std::uint64_t latency[Instrument::ProbeCount][Instrument::LATENCY_BUCKETS]{};
+    std::uint64_t segments[Instrument::SegmentCount]{};
+};
+
+/**
+ * Counters of one thread, written by that thread only and read by snapshots. Writes are relaxed load and store
+ * rather than read-modify-write, as nobody else writes.
+ */
+struct ThreadCounters
+{
+    std::atomic<std::uint64_t> calls[Instrument::ProbeCount]{};
+    std::atomic<std::uint64_t> elements[Instrument::ProbeCount]{};
+    std::atomic<std::uint64_t> ticks[Instrument::ProbeCount]{};
+    std::atomic<std::uint64_t> timed[Instrument::ProbeCount]{};
+    /**
+     * timed calls by latency in buckets of powers of two ticks
+     */
+    std::atomic<std::uint64_t> latency[Instrument::ProbeCount][Instrument::LATENCY_BUCKETS]{};
+    std::atomic<std::uint64_t> segments[Instrument::SegmentCount]{};
+
+    static void Add(std::atomic<std::uint64_t>& counter, const std::uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+    void AddTo(Totals& totals) const
+    {
+        for (std::size_t k = 0; k < Instrument::ProbeCount; k++) {
+            totals.calls[k] += this->calls[k].load(std::memory_order_relaxed);
+            totals.elements[k] += this->elements[k].load(std::memory_order_relaxed);
+            totals.ticks[k] += this->ticks[k].load(std::memory_order_relaxed);
+            totals.timed[k] += this->timed[k].load(std::memory_order_relaxed);
+            for (std::size_t b = 0; b < Instrument::LATENCY_BUCKETS; b++) {
+                totals.latency[k][b] += this->latency[k][b].load(std::memory_order_relaxed);
+            }
+        }
+        for (std::size_t k = 0; k < Instrument::SegmentCount; k++) {
+            totals.segments[k] += this->segments[k].load(std::memory_order_relaxed);
+        }
+    }
+};
+
+/**
+ * Counters of running threads, sums of exited ones and sums at the last Reset. The lock is taken only when threads
+ * start and exit and by snapshots.
+ */
+struct Registry
+{
+    std::mutex mutex{};
+    std::vector<const ThreadCounters*> live{};
+    Totals exited{};
+    Totals baseline{};
+
+    [[nodiscard]] Totals Sum() const
+    {
+        Totals totals = this->exited;
+        for (const ThreadCounters* counters : this->live) {
+            counters->AddTo(totals);
+        }
+        return totals;
+    }
+};
+
+/**
+ * Never destroyed, so that threads exiting after static destruction still find it
+ */
+static Registry& registry()
+{
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+static ThreadCounters& local()
+{
+    struct Slot
+    {
+        ThreadCounters counters{};
+
+        Slot()
+        {
+            Registry& r = registry();
+            const std::lock_guard<std::mutex> lock(r.mutex);
+            r.live.push_back(&this->counters);
+        }
+        ~Slot()
+        {
+            Registry& r = registry();
+            const std::lock_guard<std::mutex> lock(r.mutex);
+            this->counters.AddTo(r.exited);
+            r.live.erase(std::find(r.live.begin(), r.live.end(), &this->counters));
+        }
+    };
+    thread_local Slot slot;
+    return slot.counters;
+}
+
+static std::uint64_t steadyNanoseconds()
+{
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+/**
+ * Time stamp counter where available, it costs a fraction of a clock call and is scaled to nanoseconds by snapshots
+ */
+static std::uint64_t ticks()
+{
+#ifdef ASTROLIB_TSC
+    return __rdtsc();
+#else
+    return steadyNanoseconds();
+#endif
+}
+
+/**
+ * Clock readings at start up, against which ticks are calibrated
+ */
+static const std::uint64_t START_NANOSECONDS = steadyNanoseconds();
+static const std::uint64_t START_TICKS       = ticks();
+
+static double nanosecondsPerTick()
+{
+#ifdef ASTROLIB_TSC
+    const std::uint64_t elapsedTicks = ticks() - START_TICKS;
+    const std::uint64_t elapsed      = steadyNanoseconds() - START_NANOSECONDS;
+    return elapsedTicks > 0 ? static_cast<double>(elapsed) / static_cast<double>(elapsedTicks) : 0.0;
+#else
+    return 1.0;
+#endif
+}
+
+/**
+ * Latency bucket of elapsed ticks, floor of log2
+ */
+static std::size_t latencyBucket(std::uint64_t elapsed)
+{
+    std::size_t bucket = 0;
+    while (elapsed >>= 1) {
+        bucket++;
+    }
+    return std::min(bucket, Instrument::LATENCY_BUCKETS - 1);
+}
+
+Instrument::Scope::Scope(const Probe probe, const std::size_t elements)
+    : _probe(probe), _elements(elements)
+{
+    ThreadCounters& counters  = local();
+    const std::uint64_t calls = counters.calls[probe].load(std::memory_order_relaxed);
+    counters.calls[probe].store(calls + 1, std::memory_order_relaxed);
+    this->_start = elements > 1 || calls % SAMPLE == 0 ? ticks() : 0;
+}
+
+Instrument::Scope::~Scope()
+{
+    ThreadCounters& counters = local();
+    ThreadCounters::Add(counters.elements[this->_probe], this->_elements);
+    if (this->_start) {
+        const std::uint64_t elapsed = ticks() - this->_start;
+        ThreadCounters::Add(counters.ticks[this->_probe], elapsed);
+        ThreadCounters::Add(counters.timed[this->_probe], 1);
+        ThreadCounters::Add(counters.latency[this->_probe][latencyBucket(elapsed)], 1);
+    }
+}
+
+void Instrument::Count(const Segment segment, const std::size_t hits)
+{
+    ThreadCounters::Add(local().segments[segment], hits);
+}
+
+Instrument::Snapshot Instrument::Collect()
+{
+    Snapshot snapshot;
+    if (!Enabled()) {
+        return snapshot;
+    }
+    Registry& r = registry();
+    Totals totals, baseline;
+    {
+        const std::lock_guard<std::mutex> lock(r.mutex);
+        totals   = r.Sum();
+        baseline = r.baseline;
+    }
+    const double scale = nanosecondsPerTick();
+    for (std::size_t k = 0; k < ProbeCount; k++) {
+        snapshot.probes[k].calls       = totals.calls[k] - baseline.calls[k];
+        snapshot.probes[k].elements    = totals.elements[k] - baseline.elements[k];
+        const std::uint64_t timed      = totals.timed[k] - baseline.timed[k];
+        const double elapsed           = static_cast<double>(totals.ticks[k] - baseline.ticks[k]);
+        const double perCall           = timed ? elapsed / static_cast<double>(timed) : 0.0;
+        snapshot.probes[k].nanoseconds = static_cast<std::uint64_t>(
+                perCall * static_cast<double>(snapshot.probes[k].calls) * scale + 0.5);
+        // every bucket of ticks goes to the nanosecond bucket of its geometric middle, exact where ticks are
+        // nanoseconds and within a factor of two otherwise
+        for (std::size_t b = 0; b < LATENCY_BUCKETS; b++) {
+            const std::uint64_t count = totals.latency[k][b] - baseline.latency[k][b];
+            const double middle       = std::ldexp(scale * std::sqrt(2.0), static_cast<int>(b));
+            const std::size_t bucket  = middle < 2.0 ? 0 : static_cast<std::size_t>(std::log2(middle));
+            snapshot.probes[k].latency[std::min(bucket, LATENCY_BUCKETS - 1)] += count;
+        }
+    }
+    for (std::size_t k = 0; k < SegmentCount; k++) {
+        snapshot.segments[k] = totals.segments[k] - baseline.segments[k];
+    }
+    return snapshot;
+}
+
+void Instrument::Reset()
+{
+    if (!Enabled()) {
+        return;
+    }
+    Registry& r = registry();
+    const std::lock_guard<std::mutex> lock(r.mutex);
+    r.baseline = r.Sum();
+}
+
+const char* Instrument::Name(const Probe probe)
+{
+    return probe < ProbeCount ? PROBE_NAMES[probe] : "";
+}
+
+const char* Instrument::Name(const Segment segment)
+{
+    return segment < SegmentCount ? SEGMENT_NAMES[segment] : "";
+}
+
+std::string Instrument::Snapshot::Text() const
+{
+    char line[160];
+    std::string text;
+    std::snprintf(line, sizeof(line), "%-32s %14s %16s %14s\n", "probe", "calls", "elements", "time ms");
+    text += line;
+    for (std::size_t k = 0; k < ProbeCount; k++) {
+        const ProbeStats& probe = this->probes[k];
+        if (probe.calls) {
+            std::snprintf(line, sizeof(line), "%-32s %14llu %16llu %14.3f\n", PROBE_NAMES[k],
+                          static_cast<unsigned long long>(probe.calls), static_cast<unsigned long long>(probe.elements),
+                          static_cast<double>(probe.nanoseconds) * 1e-6);
+            text += line;
+        }
+    }
+    std::snprintf(line, sizeof(line), "%-32s %24s %14s\n", "probe", "latency ns", "timed calls");
+    text += line;
+    for (std::size_t k = 0; k < ProbeCount; k++) {
+        for (std::size_t b = 0; b < LATENCY_BUCKETS; b++) {
+            if (this->probes[k].latency[b]) {
+                char range[48];
+                if (b + 1 < LATENCY_BUCKETS) {
+                    std::snprintf(range, sizeof(range), "[%llu, %llu)", b ? 1ULL << b : 0ULL, 2ULL << b);
+                } else {
+                    std::snprintf(range, sizeof(range), "[%llu, )", 1ULL << b);
+                }
+                std::snprintf(line, sizeof(line), "%-32s %24s %14llu\n", PROBE_NAMES[k], range,
+                              static_cast<unsigned long long>(this->probes[k].latency[b]));
+                text += line;
+            }
+        }
+    }
+    std::snprintf(line, sizeof(line), "%-32s %14s\n", "segment", "hits");
+    text += line;
+    for (std::size_t k = 0; k < SegmentCount; k++) {
+        if (this->segments[k]) {
+            std::snprintf(line, sizeof(line), "%-32s %14llu\n", SEGMENT_NAMES[k],
+                          static_cast<unsigned long long>(this->segments[k]));
+            text += line;
+        }
+    }
+    return text;
+}
+
+std::string Instrument::Snapshot::Json() const
+{
+    char line[192];
+    std::string json = "{\"probes\": {";
+    for (std::size_t k = 0; k < ProbeCount; k++) {
+        const ProbeStats& probe = this->probes[k];
+        std::snprintf(line, sizeof(line),
+                      "%s\"%s\": {\"calls\": %llu, \"elements\": %llu, \"nanoseconds\": %llu, \"latency\": [",
+                      k ? ", " : "", PROBE_NAMES[k], static_cast<unsigned long long>(probe.calls),
+                      static_cast<unsigned long long>(probe.elements),
+                      static_cast<unsigned long long>(probe.nanoseconds));
+        json += line;
+        for (std::size_t b = 0; b < LATENCY_BUCKETS; b++) {
+            std::snprintf(line, sizeof(line), "%s%llu", b ? ", " : "",
+                          static_cast<unsigned long long>(probe.latency[b]));
+            json += line;
+        }
+        json += "]}";
+    }
+    json += "}, \"segments\": {";
+    for (std::size_t k = 0; k < SegmentCount; k++) {
+        std::snprintf(line, sizeof(line), "%s\"%s\": %llu", k ? ", " : "", SEGMENT_NAMES[k],
+                      static_cast<unsigned long long>(this->segments[k]));
+        json += line;
+    }
+    json += "}}";
+    return json;
+}
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "include/magnitudesum.h"
+#include "include/starbatch.h"
+#include "include/starmath.h"
+
+/**
+ * stars converted to flux at once, and stars summed by one task
+ */
+static constexpr std::size_t BLOCK = 512;
+static constexpr std::size_t CHUNK = 65536;
+
+/**
+ * Neumaier summation, error of the total does not grow with the number of terms
+ */
+struct CompensatedSum
+{
+    double sum          = 0.0;
+    double compensation = 0.0;
+
+    void Add(const double x)
+    {
+        const double t = sum + x;
+        compensation += std::fabs(sum) >= std::fabs(x) ? (sum - t) + x : (x - t) + sum;
+        sum = t;
+    }
+    void Add(const CompensatedSum& other)
+    {
+        Add(other.sum);
+        Add(other.compensation);
+    }
+    [[nodiscard]] double Value() const
+    {
+        return sum + compensation;
+    }
+};
+
+/**
+ * Summary of a set needed before conversion to flux: the brightest finite magnitude, the first one and NaN presence
+ */
+struct Reference
+{
+    double brightest = INFINITY;
+    double first     = INFINITY;
+    bool empty       = true;
+    bool nan         = false;
+
+    void Add(const double mag)
+    {
+        if (empty) {
+            first = mag;
+            empty = false;
+        }
+        if (std::isnan(mag)) {
+            nan = true;
+        } else if (std::isfinite(mag)) {
+            brightest = std::min(brightest, mag);
+        }
+    }
+    void Add(const Reference& other)
+    {
+        if (!other.empty) {
+            Add(other.first);
+            brightest = std::min(brightest, other.brightest);
+            nan       = nan || other.nan;
+        }
+    }
+    /**
+     * integrated magnitude from compensated flux sum relative to brightest
+     */
+    [[nodiscard]] double Magnitude(const CompensatedSum& flux) const
+    {
+        if (nan) {
+            return NAN;
+        }
+        if (std::isinf(brightest)) {
+            return first;
+        }
+        return brightest + StarMath::magnitudeDifference(flux.Value());
+    }
+};
+
+/**
+ * Adds fluxes relative to brightest of finite magnitudes mag[index[i]] for i in [0, n), index may be null for identity
+ */
+static void addFluxes(const double* mag, const std::size_t* index, const std::size_t n, const double brightest,
+                      CompensatedSum& flux)
+{
+    double diff[BLOCK], ratio[BLOCK];
+    for (std::size_t first = 0; first < n; first += BLOCK) {
+        std::size_t count = 0;
+        for (std::size_t i = first; i < std::min(n, first + BLOCK); i++) {
+            const double m = mag[index ? index[i] : i];
+            if (std::isfinite(m)) {
+                diff[count++] = brightest - m;
+            }
+        }
+        StarBatch::brightnessRatio(diff, ratio, count);
+        for (std::size_t i = 0; i < count; i++) {
+            flux.Add(ratio[i]);
+        }
+    }
+}
+
+double MagnitudeSum::Total(const double* mag, const std::size_t n, ThreadPool& pool)
+{
+    const std::size_t chunks = (n + CHUNK - 1) / CHUNK;
+    std::vector<Reference> references(chunks);
+    std::vector<CompensatedSum> fluxes(chunks);
+
+    pool.ParallelFor(0, chunks, 1, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t c = begin; c < end; c++) {
+            for (std::size_t i = c * CHUNK; i < std::min(n, (c + 1) * CHUNK); i++) {
+                references[c].Add(mag[i]);
+            }
+        }
+    });
+    Reference reference;
+    for (const Reference& chunk : references) {
+        reference.Add(chunk);
+    }
+    if (reference.nan || std::isinf(reference.brightest)) {
+        return reference.Magnitude(CompensatedSum{});
+    }
+
+    pool.ParallelFor(0, chunks, 1, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t c = begin; c < end; c++) {
+            const std::size_t first = c * CHUNK;
+            addFluxes(mag + first, nullptr, std::min(CHUNK, n - first), reference.brightest, fluxes[c]);
+        }
+    });
+    CompensatedSum flux;
+    for (const CompensatedSum& chunk : fluxes) {
+        flux.Add(chunk);
+    }
+    return reference.Magnitude(flux);
+}
+
+void MagnitudeSum::Grouped(const double* mag, const std::uint32_t* group, const std::size_t n, double* out,
+                           const std::size_t groups, ThreadPool& pool)
+{
+    // stable counting sort of star indices by group, members of a group are then summed in input order
+    std::vector<std::size_t> offsets(groups + 1, 0);
+    for (std::size_t i = 0; i < n; i++) {
+        if (group[i] < groups) {
+            offsets[group[i] + 1]++;
+        }
+    }
+    for (std::size_t k = 0; k < groups; k++) {
+        offsets[k + 1] += offsets[k];
+    }
+    std::vector<std::size_t> members(offsets.back());
+    std::vector<std::size_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (std::size_t i = 0; i < n; i++) {
+        if (group[i] < groups) {
+            members[cursor[group[i]]++] = i;
+        }
+    }
+
+    const std::size_t grain = std::max<std::size_t>(1, groups / (16 * pool.Concurrency()));
+    pool.ParallelFor(0, groups, grain, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t k = begin; k < end; k++) {
+            const std::size_t* index = members.data() + offsets[k];
+            const std::size_t count  = offsets[k + 1] - offsets[k];
+            Reference reference;
+            for (std::size_t i = 0; i < count; i++) {
+                reference.Add(mag[index[i]]);
+            }
+            CompensatedSum flux;
+            if (!reference.nan && std::isfinite(reference.brightest)) {
+                addFluxes(mag, index, count, reference.brightest, flux);
+            }
+            out[k] = reference.Magnitude(flux);
+        }
+    });
+}
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "include/photometry.h"
+#include "include/starbatch.h"
+#include "simd.h"
+
+/**
+ * Area of circle of radius r centred at the origin inside [0, x] x [0, y] for non-negative x and y
+ */
+static double quadrantOverlap(double x, double y, const double r)
+{
+    x = std::min(x, r);
+    y = std::min(y, r);
+    if (x * x + y * y <= r * r) {
+        return x * y;
+    }
+    // the corner is cut by the arc which meets the top edge at xc, the rest is integral of sqrt(r^2 - t^2)
+    const auto segment = [r](const double t) {
+        return 0.5 * (t * std::sqrt(std::max(r * r - t * t, 0.0)) + r * r * std::asin(std::min(t / r, 1.0)));
+    };
+    const double xc = std::sqrt(r * r - y * y);
+    return y * xc + segment(x) - segment(xc);
+}
+
+/**
+ * quadrantOverlap extended to any signs of x and y by symmetry of the circle
+ */
+static double signedOverlap(const double x, const double y, const double r)
+{
+    const double sign = (x < 0.0) == (y < 0.0) ? 1.0 : -1.0;
+    return sign * quadrantOverlap(std::fabs(x), std::fabs(y), r);
+}
+
+/**
+ * Adds whole packs of n pixels to sum, returns number of pixels done
+ */
+template <class P>
+static std::size_t rowSum(const float* pixels, const std::size_t n, double& sum)
+{
+    typename P::Vec acc[2] = {P::set1(0.0), P::set1(0.0)};
+    std::size_t i          = 0;
+    for (; i + 2 * P::width <= n; i += 2 * P::width) {
+        acc[0] = P::add(acc[0], P::load(pixels + i));
+        acc[1] = P::add(acc[1], P::load(pixels + i + P::width));
+    }
+    for (; i + P::width <= n; i += P::width) {
+        acc[0] = P::add(acc[0], P::load(pixels + i));
+    }
+    double lanes[P::width];
+    P::store(lanes, P::add(acc[0], acc[1]));
+    for (const double lane : lanes) {
+        sum += lane;
+    }
+    return i;
+}
+
+/**
+ * Sigma clipped median and standard deviation of values, which are sorted in place
+ */
+static void sigmaClip(std::vector<double>& values, const double clipSigma, const int clipIterations,
+                      ApertureMeasurement& out)
+{
+    std::sort(values.begin(), values.end());
+    auto lo = values.begin(), hi = values.end();
+    double median = NAN, sigma = NAN;
+    for (int iteration = 0; lo != hi; iteration++) {
+        const auto n = static_cast<double>(hi - lo);
+        const auto m = lo + (hi - lo) / 2;
+        median       = (hi - lo) % 2 ? *m : 0.5 * (*(m - 1) + *m);
+
+        double mean = 0.0, variance = 0.0;
+        for (auto v = lo; v != hi; ++v) {
+            mean += *v;
+        }
+        mean /= n;
+        for (auto v = lo; v != hi; ++v) {
+            variance += (*v - mean) * (*v - mean);
+        }
+        sigma = std::sqrt(variance / n);
+
+        if (iteration == clipIterations) {
+            break;
+        }
+        const auto clippedLo = std::lower_bound(lo, hi, median - clipSigma * sigma);
+        const auto clippedHi = std::upper_bound(lo, hi, median + clipSigma * sigma);
+        if (clippedLo == lo && clippedHi == hi) {
+            break;
+        }
+        lo = clippedLo;
+        hi = clippedHi;
+    }
+    out.background      = median;
+    out.backgroundSigma = sigma;
+    out.annulusSize     = static_cast<std::size_t>(hi - lo);
+}
+
+AperturePhotometry::AperturePhotometry(const double radius, const double innerRadius, const double outerRadius,
+                                       const double zeroPoint, const double clipSigma, const int clipIterations,
+                                       ThreadPool& pool)
+    : _radius(radius), _innerRadius(innerRadius), _outerRadius(outerRadius), _zeroPoint(zeroPoint),
+      _clipSigma(clipSigma), _clipIterations(clipIterations), _pool(pool)
+{
+}
+
+double AperturePhotometry::Overlap(const double x0, const double y0, const double x1, const double y1, const double r)
+{
+    return signedOverlap(x1, y1, r) - signedOverlap(x0, y1, r) - signedOverlap(x1, y0, r) + signedOverlap(x0, y0, r);
+}
+
+/**
+ * first and one past last index of pixels whose centres c satisfy lo <= c <= hi, clipped to [0, size)
+ */
+static void pixelRange(const double lo, const double hi, const std::size_t size, std::size_t& first,
+                       std::size_t& last)
+{
+    const double a = std::max(std::ceil(lo), 0.0);
+    const double b = std::min(std::floor(hi) + 1.0, static_cast<double>(size));
+    first          = a < b ? static_cast<std::size_t>(a) : 0;
+    last           = a < b ? static_cast<std::size_t>(b) : 0;
+}
+
+void AperturePhotometry::Measure(const float* image, const std::size_t width, const std::size_t height,
+                                 const double* x, const double* y, const std::size_t n, ApertureMeasurement* out) const
+{
+    const double r = this->_radius;
+    this->_pool.ParallelFor(0, n, 256, [&](const std::size_t begin, const std::size_t end) {
+        thread_local std::vector<double> annulus;
+        std::vector<double> flux(end - begin), magnitude(end - begin);
+
+        for (std::size_t s = begin; s < end; s++) {
+            ApertureMeasurement& m = out[s];
+            m                      = ApertureMeasurement{};
+            double sum             = 0.0;
+
+            std::size_t top, bottom;
+            pixelRange(y[s] - r - 0.5, y[s] + r + 0.5, height, top, bottom);
+            for (std::size_t j = top; j < bottom; j++) {
+                // pixel edges relative to centre, nearest and farthest distances of the row from centre along y
+                const double y0   = j - 0.5 - y[s];
+                const double y1   = j + 0.5 - y[s];
+                const double near = y0 > 0.0 ? y0 : y1 < 0.0 ? -y1 : 0.0;
+                const double far  = std::max(std::fabs(y0), std::fabs(y1));
+                if (near >= r) {
+                    continue;
+                }
+                const double chord = std::sqrt(r * r - near * near);
+                std::size_t left, right, inLeft = 0, inRight = 0;
+                pixelRange(x[s] - chord - 0.5, x[s] + chord + 0.5, width, left, right);
+                if (far < r) {
+                    const double inner = std::sqrt(r * r - far * far);
+                    pixelRange(x[s] - inner + 0.5, x[s] + inner - 0.5, width, inLeft, inRight);
+                }
+                if (inLeft >= inRight) {
+                    inLeft = inRight = right;
+                }
+
+                const float* row   = image + j * width;
+                const auto partial = [&](const std::size_t i) {
+                    const double weight = Overlap(i - 0.5 - x[s], y0, i + 0.5 - x[s], y1, r);
+                    sum += weight * row[i];
+                    m.area += weight;
+                };
+                for (std::size_t i = left; i < inLeft; i++) {
+                    partial(i);
+                }
+                for (std::size_t i = inRight; i < right; i++) {
+                    partial(i);
+                }
+                const std::size_t done = rowSum<NativePack>(row + inLeft, inRight - inLeft, sum);
+                rowSum<ScalarPack>(row + inLeft + done, inRight - inLeft - done, sum);
+                m.area += static_cast<double>(inRight - inLeft);
+            }
+
+            annulus.clear();
+            const double inner2 = this->_innerRadius * this->_innerRadius;
+            const double outer2 = this->_outerRadius * this->_outerRadius;
+            pixelRange(y[s] - this->_outerRadius, y[s] + this->_outerRadius, height, top, bottom);
+            for (std::size_t j = top; j < bottom; j++) {
+                const double dy2 = (j - y[s]) * (j - y[s]);
+                if (dy2 > outer2) {
+                    continue;
+                }
+                const double outerChord = std::sqrt(outer2 - dy2);
+                std::size_t left, right;
+                pixelRange(x[s] - outerChord, x[s] + outerChord, width, left, right);
+                for (std::size_t i = left; i < right; i++) {
+                    const double d2 = (i - x[s]) * (i - x[s]) + dy2;
+                    if (d2 >= inner2 && d2 <= outer2) {
+                        annulus.push_back(image[j * width + i]);
+                    }
+                }
+            }
+            sigmaClip(annulus, this->_clipSigma, this->_clipIterations, m);
+
+            m.flux          = sum - (annulus.empty() ? 0.0 : m.background * m.area);
+            flux[s - begin] = m.flux;
+        }
+
+        StarBatch::magnitudeDifference(flux.data(), magnitude.data(), flux.size());
+        for (std::size_t s = begin; s < end; s++) {
+            out[s].magnitude = this->_zeroPoint + magnitude[s - begin];
+        }
+    });
+}
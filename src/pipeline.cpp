@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <cmath>
+#include "include/instrument.h"
+#include "include/pipeline.h"
+#include "include/starbatch.h"
+
+/**
+ * stars pushed through the whole chain at once, sized so that all intermediate columns stay in L1/L2 cache
+ */
+static constexpr std::size_t BLOCK = 512;
+
+StarPipeline::StarPipeline(ThreadPool& pool, const std::size_t grain) : _pool(pool), _grain(grain)
+{
+}
+
+void StarPipeline::Run(const StarCatalog& catalog, const DerivedColumns& out) const
+{
+    Run(catalog, nullptr, out);
+}
+
+void StarPipeline::Run(const StarCatalog& catalog, const std::string_view* spectra, const DerivedColumns& out) const
+{
+    ASTROLIB_PROBE(PipelineRun, catalog.Size());
+    this->_pool.ParallelFor(0, catalog.Size(), this->_grain,
+                            [this, &catalog, spectra, &out](std::size_t begin, std::size_t end) {
+                                Run(catalog, spectra, out, begin, end);
+                            });
+}
+
+void StarPipeline::Run(const StarCatalog& catalog, const std::string_view* spectra, const DerivedColumns& out,
+                       const std::size_t begin, const std::size_t end) const
+{
+    double bmv[BLOCK], temperature[BLOCK], bc[BLOCK], distance[BLOCK], mv[BLOCK], lum[BLOCK], radius[BLOCK];
+    int spectype[BLOCK], lumclass[BLOCK];
+
+    for (std::size_t first = begin; first < end; first += BLOCK) {
+        const std::size_t n = std::min(BLOCK, end - first);
+
+        const int* lumClass = catalog.LuminosityClass() + first;
+        if (spectra) {
+            StarBatch::parseSpectrum(spectra + first, spectype, lumclass, n);
+            lumClass = lumclass;
+        }
+        for (std::size_t i = 0; i < n; i++) {
+            const double parallax = catalog.Parallax()[first + i];
+            bmv[i]                = catalog.Bmagnitude()[first + i] - catalog.Vmagnitude()[first + i];
+            distance[i]           = parallax > 0.0 ? 1.0 / parallax : INFINITY;
+        }
+
+        StarBatch::colorTemperature(bmv, lumClass, temperature, n);
+        StarBatch::bolometricCorrection(temperature, bc, n);
+        StarBatch::absoluteMagnitude(catalog.Vmagnitude() + first, distance, mv, n);
+        StarBatch::luminosity(mv, bc, lum, n);
+        StarBatch::radius(lum, temperature, radius, n);
+
+        const auto copy = [first, n](const double* from, double* to) {
+            if (to) {
+                std::copy(from, from + n, to + first);
+            }
+        };
+        copy(temperature, out.temperature);
+        copy(bc, out.bolometricCorrection);
+        copy(mv, out.absoluteMagnitude);
+        copy(lum, out.luminosity);
+        copy(radius, out.radius);
+    }
+}
@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "include/constants.h"
+#include "include/psffit.h"
+#include "simd.h"
+
+/**
+ * number of fitted parameters, in the order x, y, peak, width, beta, background
+ */
+static constexpr std::size_t PARAMETERS = 6;
+
+/**
+ * Per-thread buffers of a fit: pixel coordinates and values, residuals and one Jacobian column per parameter
+ */
+struct FitScratch
+{
+    std::size_t width  = 0;
+    std::size_t height = 0;
+    std::vector<double> column;
+    std::vector<double> row;
+    std::vector<double> data;
+    std::vector<double> residual;
+    std::vector<double> jacobian[PARAMETERS];
+
+    void Resize(const std::size_t cutoutWidth, const std::size_t cutoutHeight)
+    {
+        if (cutoutWidth == width && cutoutHeight == height) {
+            return;
+        }
+        width                    = cutoutWidth;
+        height                   = cutoutHeight;
+        const std::size_t pixels = width * height;
+        column.resize(pixels);
+        row.resize(pixels);
+        data.resize(pixels);
+        residual.resize(pixels);
+        for (auto& derivative : jacobian) {
+            derivative.resize(pixels);
+        }
+        for (std::size_t i = 0; i < pixels; i++) {
+            column[i] = static_cast<double>(i % width);
+            row[i]    = static_cast<double>(i / width);
+        }
+    }
+};
+
+/**
+ * Residuals and Jacobian of the model at pixels [first, last), only whole packs are evaluated, returns number of
+ * pixels done
+ */
+template <class P>
+static std::size_t moffatJacobian(const MoffatParameters& p, const std::size_t first, const std::size_t last,
+                                  FitScratch& scratch)
+{
+    using Vec = typename P::Vec;
+    const Vec one        = P::set1(1.0);
+    const Vec x0         = P::set1(p.x);
+    const Vec y0         = P::set1(p.y);
+    const Vec peak       = P::set1(p.peak);
+    const Vec minusBeta  = P::set1(-p.beta);
+    const Vec inverse2   = P::set1(1.0 / (p.width * p.width));
+    const Vec centre     = P::set1(2.0 * p.beta / (p.width * p.width));
+    const Vec core       = P::set1(2.0 * p.beta / p.width);
+    const Vec slope      = P::set1(-0.6931471805599453 * p.peak);
+    const Vec background = P::set1(p.background);
+
+    std::size_t i = first;
+    for (; i + P::width <= last; i += P::width) {
+        const Vec dx = P::sub(P::load(&scratch.column[i]), x0);
+        const Vec dy = P::sub(P::load(&scratch.row[i]), y0);
+        const Vec q  = P::mul(P::add(P::mul(dx, dx), P::mul(dy, dy)), inverse2);
+        const Vec u  = P::add(one, q);
+        const Vec lu = log2<P>(u);
+        const Vec f  = exp2<P>(P::mul(minusBeta, lu));
+        const Vec af = P::mul(peak, f);
+        // peak * u^(-beta - 1)
+        const Vec du = P::div(af, u);
+
+        P::store(&scratch.residual[i], P::sub(P::load(&scratch.data[i]), P::add(af, background)));
+        P::store(&scratch.jacobian[0][i], P::mul(P::mul(du, centre), dx));
+        P::store(&scratch.jacobian[1][i], P::mul(P::mul(du, centre), dy));
+        P::store(&scratch.jacobian[2][i], f);
+        P::store(&scratch.jacobian[3][i], P::mul(P::mul(du, core), q));
+        P::store(&scratch.jacobian[4][i], P::mul(P::mul(f, slope), lu));
+        P::store(&scratch.jacobian[5][i], one);
+    }
+    return i - first;
+}
+
+/**
+ * Adds dot product of whole packs of a and b to sum, four independent accumulators hide the latency of additions.
+ * Returns number of elements done.
+ */
+template <class P>
+static std::size_t dotPacks(const double* a, const double* b, const std::size_t n, double& sum)
+{
+    using Vec     = typename P::Vec;
+    Vec acc[4]    = {P::set1(0.0), P::set1(0.0), P::set1(0.0), P::set1(0.0)};
+    std::size_t i = 0;
+    for (; i + 4 * P::width <= n; i += 4 * P::width) {
+        for (std::size_t k = 0; k < 4; k++) {
+            acc[k] = P::add(acc[k], P::mul(P::load(a + i + k * P::width), P::load(b + i + k * P::width)));
+        }
+    }
+    for (; i + P::width <= n; i += P::width) {
+        acc[0] = P::add(acc[0], P::mul(P::load(a + i), P::load(b + i)));
+    }
+    double lanes[P::width];
+    P::store(lanes, P::add(P::add(acc[0], acc[1]), P::add(acc[2], acc[3])));
+    for (const double lane : lanes) {
+        sum += lane;
+    }
+    return i;
+}
+
+static double dot(const double* a, const double* b, const std::size_t n)
+{
+    double sum          = 0.0;
+    const std::size_t i = dotPacks<NativePack>(a, b, n, sum);
+    dotPacks<ScalarPack>(a + i, b + i, n - i, sum);
+    return sum;
+}
+
+/**
+ * Evaluates model at p and fills normal equations J^T J, J^T r, returns chi2
+ */
+static double normalEquations(const MoffatParameters& p, FitScratch& scratch, double (&jtj)[PARAMETERS][PARAMETERS],
+                              double (&jtr)[PARAMETERS])
+{
+    const std::size_t pixels = scratch.data.size();
+    const std::size_t done   = moffatJacobian<NativePack>(p, 0, pixels, scratch);
+    moffatJacobian<ScalarPack>(p, done, pixels, scratch);
+
+    for (std::size_t a = 0; a < PARAMETERS; a++) {
+        for (std::size_t b = 0; b <= a; b++) {
+            jtj[a][b] = jtj[b][a] = dot(scratch.jacobian[a].data(), scratch.jacobian[b].data(), pixels);
+        }
+        jtr[a] = dot(scratch.jacobian[a].data(), scratch.residual.data(), pixels);
+    }
+    return dot(scratch.residual.data(), scratch.residual.data(), pixels);
+}
+
+/**
+ * Solves a x = b for symmetric positive definite a by Cholesky decomposition, false if a is not positive definite
+ */
+static bool choleskySolve(double (&a)[PARAMETERS][PARAMETERS], double (&b)[PARAMETERS])
+{
+    for (std::size_t j = 0; j < PARAMETERS; j++) {
+        double d = a[j][j];
+        for (std::size_t k = 0; k < j; k++) {
+            d -= a[j][k] * a[j][k];
+        }
+        if (!(d > 0.0)) {
+            return false;
+        }
+        a[j][j] = std::sqrt(d);
+        for (std::size_t i = j + 1; i < PARAMETERS; i++) {
+            double s = a[i][j];
+            for (std::size_t k = 0; k < j; k++) {
+                s -= a[i][k] * a[j][k];
+            }
+            a[i][j] = s / a[j][j];
+        }
+    }
+    for (std::size_t i = 0; i < PARAMETERS; i++) {
+        for (std::size_t k = 0; k < i; k++) {
+            b[i] -= a[i][k] * b[k];
+        }
+        b[i] /= a[i][i];
+    }
+    for (std::size_t i = PARAMETERS; i-- > 0;) {
+        for (std::size_t k = i + 1; k < PARAMETERS; k++) {
+            b[i] -= a[k][i] * b[k];
+        }
+        b[i] /= a[i][i];
+    }
+    return true;
+}
+
+static MoffatFit fitCutout(const float* cutout, const std::size_t width, const std::size_t height,
+                           const MoffatParameters& initial, const int maxIterations, const double tolerance)
+{
+    thread_local FitScratch scratch;
+    scratch.Resize(width, height);
+    std::copy(cutout, cutout + width * height, scratch.data.begin());
+
+    MoffatFit fit;
+    fit.parameters = initial;
+    double jtj[PARAMETERS][PARAMETERS], jtr[PARAMETERS];
+    fit.chi2 = normalEquations(fit.parameters, scratch, jtj, jtr);
+
+    double lambda = 1e-3;
+    while (fit.iterations < maxIterations && !fit.converged) {
+        double damped[PARAMETERS][PARAMETERS], step[PARAMETERS];
+        std::copy(&jtj[0][0], &jtj[0][0] + PARAMETERS * PARAMETERS, &damped[0][0]);
+        std::copy(jtr, jtr + PARAMETERS, step);
+        for (std::size_t k = 0; k < PARAMETERS; k++) {
+            damped[k][k] *= 1.0 + lambda;
+        }
+
+        if (!choleskySolve(damped, step)) {
+            lambda *= 10.0;
+            if (lambda > 1e12) {
+                break;
+            }
+            continue;
+        }
+        const MoffatParameters& p = fit.parameters;
+        const MoffatParameters trial{p.x + step[0],     p.y + step[1],    p.peak + step[2],
+                                     p.width + step[3], p.beta + step[4], p.background + step[5]};
+        const double value[] = {p.x, p.y, p.peak, p.width, p.beta, p.background};
+        double change        = 0.0;
+        for (std::size_t k = 0; k < PARAMETERS; k++) {
+            change = std::max(change, std::fabs(step[k]) / std::max(std::fabs(value[k]), 1.0));
+        }
+
+        double trialJtj[PARAMETERS][PARAMETERS], trialJtr[PARAMETERS];
+        const double chi2 = trial.width > 0.0 && trial.beta > 0.0 ? normalEquations(trial, scratch, trialJtj, trialJtr)
+                                                                  : INFINITY;
+        if (chi2 <= fit.chi2) {
+            change         = std::min(change, (fit.chi2 - chi2) / std::max(chi2, tolerance));
+            fit.parameters = trial;
+            fit.chi2       = chi2;
+            fit.iterations++;
+            std::copy(&trialJtj[0][0], &trialJtj[0][0] + PARAMETERS * PARAMETERS, &jtj[0][0]);
+            std::copy(trialJtr, trialJtr + PARAMETERS, jtr);
+            lambda = std::max(lambda * 0.1, 1e-12);
+        } else {
+            lambda *= 10.0;
+        }
+        // either the step or the decrease of chi2 is negligible, or damping leaves no step that decreases chi2
+        fit.converged = change < tolerance || lambda > 1e12;
+    }
+    return fit;
+}
+
+MoffatFitter::MoffatFitter(const int maxIterations, const double tolerance, ThreadPool& pool)
+    : _maxIterations(maxIterations), _tolerance(tolerance), _pool(pool)
+{
+}
+
+MoffatParameters MoffatFitter::Guess(const float* cutout, const std::size_t width, const std::size_t height)
+{
+    MoffatParameters p;
+    if (width == 0 || height == 0) {
+        return p;
+    }
+
+    std::vector<float> border;
+    for (std::size_t x = 0; x < width; x++) {
+        border.push_back(cutout[x]);
+        border.push_back(cutout[(height - 1) * width + x]);
+    }
+    for (std::size_t y = 1; y + 1 < height; y++) {
+        border.push_back(cutout[y * width]);
+        border.push_back(cutout[y * width + width - 1]);
+    }
+    std::nth_element(border.begin(), border.begin() + border.size() / 2, border.end());
+    p.background = border[border.size() / 2];
+
+    double sum = 0.0, sumX = 0.0, sumY = 0.0, max = 0.0;
+    for (std::size_t y = 0; y < height; y++) {
+        for (std::size_t x = 0; x < width; x++) {
+            const double value = std::max(cutout[y * width + x] - p.background, 0.0);
+            sum += value;
+            sumX += value * x;
+            sumY += value * y;
+            max = std::max(max, value);
+        }
+    }
+    p.peak = max;
+    p.x    = sum > 0.0 ? sumX / sum : 0.5 * (width - 1);
+    p.y    = sum > 0.0 ? sumY / sum : 0.5 * (height - 1);
+
+    // pixels above half maximum cover a disk of radius equal to half width at half maximum
+    std::size_t half = 0;
+    for (std::size_t i = 0; i < width * height; i++) {
+        half += cutout[i] - p.background > 0.5 * max;
+    }
+    const double hwhm = std::sqrt(std::max<double>(half, 1.0) / PI_NUMBER);
+    p.width           = hwhm / std::sqrt(std::pow(2.0, 1.0 / p.beta) - 1.0);
+    return p;
+}
+
+MoffatFit MoffatFitter::Fit(const float* cutout, const std::size_t width, const std::size_t height,
+                            const MoffatParameters& initial) const
+{
+    return fitCutout(cutout, width, height, initial, this->_maxIterations, this->_tolerance);
+}
+
+void MoffatFitter::Fit(const float* cutouts, const std::size_t width, const std::size_t height, const std::size_t n,
+                       const MoffatParameters* initial, MoffatFit* fits) const
+{
+    const std::size_t pixels = width * height;
+    this->_pool.ParallelFor(0, n, 64, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            const float* cutout = cutouts + i * pixels;
+            fits[i] = fitCutout(cutout, width, height, initial ? initial[i] : Guess(cutout, width, height),
+                                this->_maxIterations, this->_tolerance);
+        }
+    });
+}
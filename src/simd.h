@@ -0,0 +1,1201 @@
+#ifndef ASTROLIB_SIMD_H
+#define ASTROLIB_SIMD_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Packs and kernels compiled for different instruction sets live in different namespaces. Translation units built
+ * with extra instruction set flags for run time dispatch then never share an inline function with baseline code,
+ * which the linker could otherwise resolve to the copy using instructions the CPU lacks.
+ */
+#if defined(__AVX512F__)
+#define ASTROLIB_SIMD_NAMESPACE simd_avx512
+#elif defined(__AVX2__)
+#define ASTROLIB_SIMD_NAMESPACE simd_avx2
+#elif defined(__SSE2__)
+#define ASTROLIB_SIMD_NAMESPACE simd_sse2
+#else
+#define ASTROLIB_SIMD_NAMESPACE simd_generic
+#endif
+
+inline namespace ASTROLIB_SIMD_NAMESPACE
+{
+
+/**
+ * Bit tricks shared by the packs. Adding 1.5 * 2^52 rounds a double below 2^51 to an integer and leaves that integer in
+ * the low bits of the sum, ORing a small integer into the bits of 2^52 converts it back to a double.
+ */
+constexpr double ROUND_MAGIC               = 6755399441055744.0;
+constexpr double EXPONENT_MAGIC            = 4503599627370496.0;
+constexpr std::int64_t EXPONENT_MAGIC_BITS = 0x4330000000000000;
+constexpr std::int64_t MANTISSA_BITS       = 0x000FFFFFFFFFFFFF;
+constexpr std::int64_t ONE_BITS            = 0x3FF0000000000000;
+
+/**
+ * Minimal vector packs of doubles used by batch kernels. Every pack exposes the same static interface, so a kernel
+ * written once as a template over the pack runs on plain scalars, SSE2, AVX2 or AVX-512 lanes. Operations map
+ * one-to-one onto IEEE instructions, no fused multiply-add, so the results are bit-for-bit equal to the equivalent
+ * scalar expression.
+ */
+struct ScalarPack
+{
+    using Scalar                       = double;
+    using Vec                          = double;
+    using Mask                         = bool;
+    static constexpr std::size_t width = 1;
+
+    static Vec load(const double* p)
+    {
+        return *p;
+    }
+    /**
+     * loads width floats widened to double
+     */
+    static Vec load(const float* p)
+    {
+        return *p;
+    }
+    static void store(double* p, Vec a)
+    {
+        *p = a;
+    }
+    /**
+     * stores width doubles narrowed to float
+     */
+    static void store(float* p, Vec a)
+    {
+        *p = static_cast<float>(a);
+    }
+    static Vec set1(double a)
+    {
+        return a;
+    }
+    static Vec add(Vec a, Vec b)
+    {
+        return a + b;
+    }
+    static Vec sub(Vec a, Vec b)
+    {
+        return a - b;
+    }
+    static Vec mul(Vec a, Vec b)
+    {
+        return a * b;
+    }
+    static Vec div(Vec a, Vec b)
+    {
+        return a / b;
+    }
+    static Vec sqrt(Vec a)
+    {
+        return std::sqrt(a);
+    }
+    /**
+     * returns b if either operand is NaN, same as minpd/maxpd
+     */
+    static Vec min(Vec a, Vec b)
+    {
+        return a < b ? a : b;
+    }
+    static Vec max(Vec a, Vec b)
+    {
+        return a > b ? a : b;
+    }
+    static Mask lt(Vec a, Vec b)
+    {
+        return a < b;
+    }
+    static Mask le(Vec a, Vec b)
+    {
+        return a <= b;
+    }
+    static Mask gt(Vec a, Vec b)
+    {
+        return a > b;
+    }
+    static Mask ge(Vec a, Vec b)
+    {
+        return a >= b;
+    }
+    static Mask both(Mask a, Mask b)
+    {
+        return a && b;
+    }
+    static Vec select(Mask m, Vec a, Vec b)
+    {
+        return m ? a : b;
+    }
+    static Mask eq(Vec a, Vec b)
+    {
+        return a == b;
+    }
+    /**
+     * true where either operand is NaN
+     */
+    static Mask unordered(Vec a, Vec b)
+    {
+        return a != a || b != b;
+    }
+    /**
+     * rounds to nearest even integer, |a| < 2^51
+     */
+    static Vec round(Vec a)
+    {
+        return (a + ROUND_MAGIC) - ROUND_MAGIC;
+    }
+    /**
+     * 2^n for integral n in [-1022, 1023]
+     */
+    static Vec pow2(Vec n)
+    {
+        const std::uint64_t bits = (bitsOf(n + ROUND_MAGIC) + 1023) << 52;
+        return ofBits(bits);
+    }
+    /**
+     * unbiased binary exponent of a normal number
+     */
+    static Vec exponent(Vec a)
+    {
+        return ofBits(((bitsOf(a) >> 52) & 0x7FF) | EXPONENT_MAGIC_BITS) - EXPONENT_MAGIC - 1023.0;
+    }
+    /**
+     * significand of a normal number scaled to [1, 2)
+     */
+    static Vec mantissa(Vec a)
+    {
+        return ofBits((bitsOf(a) & MANTISSA_BITS) | ONE_BITS);
+    }
+
+private:
+    static std::uint64_t bitsOf(double a)
+    {
+        std::uint64_t bits{};
+        std::memcpy(&bits, &a, sizeof(bits));
+        return bits;
+    }
+    static double ofBits(std::uint64_t bits)
+    {
+        double a{};
+        std::memcpy(&a, &bits, sizeof(a));
+        return a;
+    }
+};
+
+#if defined(__SSE2__)
+struct Sse2Pack
+{
+    using Scalar                       = double;
+    using Vec                          = __m128d;
+    using Mask                         = __m128d;
+    static constexpr std::size_t width = 2;
+
+    static Vec load(const double* p)
+    {
+        return _mm_loadu_pd(p);
+    }
+    static Vec load(const float* p)
+    {
+        return _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))));
+    }
+    static void store(double* p, Vec a)
+    {
+        _mm_storeu_pd(p, a);
+    }
+    static void store(float* p, Vec a)
+    {
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_castps_si128(_mm_cvtpd_ps(a)));
+    }
+    static Vec set1(double a)
+    {
+        return _mm_set1_pd(a);
+    }
+    static Vec add(Vec a, Vec b)
+    {
+        return _mm_add_pd(a, b);
+    }
+    static Vec sub(Vec a, Vec b)
+    {
+        return _mm_sub_pd(a, b);
+    }
+    static Vec mul(Vec a, Vec b)
+    {
+        return _mm_mul_pd(a, b);
+    }
+    static Vec div(Vec a, Vec b)
+    {
+        return _mm_div_pd(a, b);
+    }
+    static Vec sqrt(Vec a)
+    {
+        return _mm_sqrt_pd(a);
+    }
+    static Vec min(Vec a, Vec b)
+    {
+        return _mm_min_pd(a, b);
+    }
+    static Vec max(Vec a, Vec b)
+    {
+        return _mm_max_pd(a, b);
+    }
+    static Mask lt(Vec a, Vec b)
+    {
+        return _mm_cmplt_pd(a, b);
+    }
+    static Mask le(Vec a, Vec b)
+    {
+        return _mm_cmple_pd(a, b);
+    }
+    static Mask gt(Vec a, Vec b)
+    {
+        return _mm_cmpgt_pd(a, b);
+    }
+    static Mask ge(Vec a, Vec b)
+    {
+        return _mm_cmpge_pd(a, b);
+    }
+    static Mask both(Mask a, Mask b)
+    {
+        return _mm_and_pd(a, b);
+    }
+    static Vec select(Mask m, Vec a, Vec b)
+    {
+        return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b));
+    }
+    static Mask eq(Vec a, Vec b)
+    {
+        return _mm_cmpeq_pd(a, b);
+    }
+    static Mask unordered(Vec a, Vec b)
+    {
+        return _mm_cmpunord_pd(a, b);
+    }
+    static Vec round(Vec a)
+    {
+        const Vec magic = _mm_set1_pd(ROUND_MAGIC);
+        return _mm_sub_pd(_mm_add_pd(a, magic), magic);
+    }
+    static Vec pow2(Vec n)
+    {
+        const __m128i bits = _mm_castpd_si128(_mm_add_pd(n, _mm_set1_pd(ROUND_MAGIC)));
+        return _mm_castsi128_pd(_mm_slli_epi64(_mm_add_epi64(bits, _mm_set1_epi64x(1023)), 52));
+    }
+    static Vec exponent(Vec a)
+    {
+        const __m128i biased = _mm_and_si128(_mm_srli_epi64(_mm_castpd_si128(a), 52), _mm_set1_epi64x(0x7FF));
+        const Vec e = _mm_castsi128_pd(_mm_or_si128(biased, _mm_set1_epi64x(EXPONENT_MAGIC_BITS)));
+        return _mm_sub_pd(_mm_sub_pd(e, _mm_set1_pd(EXPONENT_MAGIC)), _mm_set1_pd(1023.0));
+    }
+    static Vec mantissa(Vec a)
+    {
+        const __m128i bits = _mm_and_si128(_mm_castpd_si128(a), _mm_set1_epi64x(MANTISSA_BITS));
+        return _mm_castsi128_pd(_mm_or_si128(bits, _mm_set1_epi64x(ONE_BITS)));
+    }
+};
+#endif
+
+#if defined(__AVX2__)
+struct Avx2Pack
+{
+    using Scalar                       = double;
+    using Vec                          = __m256d;
+    using Mask                         = __m256d;
+    static constexpr std::size_t width = 4;
+
+    static Vec load(const double* p)
+    {
+        return _mm256_loadu_pd(p);
+    }
+    static Vec load(const float* p)
+    {
+        return _mm256_cvtps_pd(_mm_loadu_ps(p));
+    }
+    static void store(double* p, Vec a)
+    {
+        _mm256_storeu_pd(p, a);
+    }
+    static void store(float* p, Vec a)
+    {
+        _mm_storeu_ps(p, _mm256_cvtpd_ps(a));
+    }
+    static Vec set1(double a)
+    {
+        return _mm256_set1_pd(a);
+    }
+    static Vec add(Vec a, Vec b)
+    {
+        return _mm256_add_pd(a, b);
+    }
+    static Vec sub(Vec a, Vec b)
+    {
+        return _mm256_sub_pd(a, b);
+    }
+    static Vec mul(Vec a, Vec b)
+    {
+        return _mm256_mul_pd(a, b);
+    }
+    static Vec div(Vec a, Vec b)
+    {
+        return _mm256_div_pd(a, b);
+    }
+    static Vec sqrt(Vec a)
+    {
+        return _mm256_sqrt_pd(a);
+    }
+    static Vec min(Vec a, Vec b)
+    {
+        return _mm256_min_pd(a, b);
+    }
+    static Vec max(Vec a, Vec b)
+    {
+        return _mm256_max_pd(a, b);
+    }
+    static Mask lt(Vec a, Vec b)
+    {
+        return _mm256_cmp_pd(a, b, _CMP_LT_OQ);
+    }
+    static Mask le(Vec a, Vec b)
+    {
+        return _mm256_cmp_pd(a, b, _CMP_LE_OQ);
+    }
+    static Mask gt(Vec a, Vec b)
+    {
+        return _mm256_cmp_pd(a, b, _CMP_GT_OQ);
+    }
+    static Mask ge(Vec a, Vec b)
+    {
+        return _mm256_cmp_pd(a, b, _CMP_GE_OQ);
+    }
+    static Mask both(Mask a, Mask b)
+    {
+        return _mm256_and_pd(a, b);
+    }
+    static Vec select(Mask m, Vec a, Vec b)
+    {
+        return _mm256_blendv_pd(b, a, m);
+    }
+    static Mask eq(Vec a, Vec b)
+    {
+        return _mm256_cmp_pd(a, b, _CMP_EQ_OQ);
+    }
+    static Mask unordered(Vec a, Vec b)
+    {
+        return _mm256_cmp_pd(a, b, _CMP_UNORD_Q);
+    }
+    static Vec round(Vec a)
+    {
+        const Vec magic = _mm256_set1_pd(ROUND_MAGIC);
+        return _mm256_sub_pd(_mm256_add_pd(a, magic), magic);
+    }
+    static Vec pow2(Vec n)
+    {
+        const __m256i bits = _mm256_castpd_si256(_mm256_add_pd(n, _mm256_set1_pd(ROUND_MAGIC)));
+        return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(bits, _mm256_set1_epi64x(1023)), 52));
+    }
+    static Vec exponent(Vec a)
+    {
+        const __m256i biased =
+            _mm256_and_si256(_mm256_srli_epi64(_mm256_castpd_si256(a), 52), _mm256_set1_epi64x(0x7FF));
+        const Vec e = _mm256_castsi256_pd(_mm256_or_si256(biased, _mm256_set1_epi64x(EXPONENT_MAGIC_BITS)));
+        return _mm256_sub_pd(_mm256_sub_pd(e, _mm256_set1_pd(EXPONENT_MAGIC)), _mm256_set1_pd(1023.0));
+    }
+    static Vec mantissa(Vec a)
+    {
+        const __m256i bits = _mm256_and_si256(_mm256_castpd_si256(a), _mm256_set1_epi64x(MANTISSA_BITS));
+        return _mm256_castsi256_pd(_mm256_or_si256(bits, _mm256_set1_epi64x(ONE_BITS)));
+    }
+};
+#endif
+
+#if defined(__AVX512F__)
+/**
+ * Masks are AVX-512 mask registers, only AVX512F instructions are used
+ */
+struct Avx512Pack
+{
+    using Scalar                       = double;
+    using Vec                          = __m512d;
+    using Mask                         = __mmask8;
+    static constexpr std::size_t width = 8;
+
+    static Vec load(const double* p)
+    {
+        return _mm512_loadu_pd(p);
+    }
+    static Vec load(const float* p)
+    {
+        return _mm512_cvtps_pd(_mm256_loadu_ps(p));
+    }
+    static void store(double* p, Vec a)
+    {
+        _mm512_storeu_pd(p, a);
+    }
+    static void store(float* p, Vec a)
+    {
+        _mm256_storeu_ps(p, _mm512_cvtpd_ps(a));
+    }
+    static Vec set1(double a)
+    {
+        return _mm512_set1_pd(a);
+    }
+    static Vec add(Vec a, Vec b)
+    {
+        return _mm512_add_pd(a, b);
+    }
+    static Vec sub(Vec a, Vec b)
+    {
+        return _mm512_sub_pd(a, b);
+    }
+    static Vec mul(Vec a, Vec b)
+    {
+        return _mm512_mul_pd(a, b);
+    }
+    static Vec div(Vec a, Vec b)
+    {
+        return _mm512_div_pd(a, b);
+    }
+    static Vec sqrt(Vec a)
+    {
+        return _mm512_sqrt_pd(a);
+    }
+    static Vec min(Vec a, Vec b)
+    {
+        return _mm512_min_pd(a, b);
+    }
+    static Vec max(Vec a, Vec b)
+    {
+        return _mm512_max_pd(a, b);
+    }
+    static Mask lt(Vec a, Vec b)
+    {
+        return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ);
+    }
+    static Mask le(Vec a, Vec b)
+    {
+        return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ);
+    }
+    static Mask gt(Vec a, Vec b)
+    {
+        return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ);
+    }
+    static Mask ge(Vec a, Vec b)
+    {
+        return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ);
+    }
+    static Mask both(Mask a, Mask b)
+    {
+        return static_cast<Mask>(a & b);
+    }
+    static Vec select(Mask m, Vec a, Vec b)
+    {
+        return _mm512_mask_blend_pd(m, b, a);
+    }
+    static Mask eq(Vec a, Vec b)
+    {
+        return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ);
+    }
+    static Mask unordered(Vec a, Vec b)
+    {
+        return _mm512_cmp_pd_mask(a, b, _CMP_UNORD_Q);
+    }
+    static Vec round(Vec a)
+    {
+        const Vec magic = _mm512_set1_pd(ROUND_MAGIC);
+        return _mm512_sub_pd(_mm512_add_pd(a, magic), magic);
+    }
+    static Vec pow2(Vec n)
+    {
+        const __m512i bits = _mm512_castpd_si512(_mm512_add_pd(n, _mm512_set1_pd(ROUND_MAGIC)));
+        return _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_add_epi64(bits, _mm512_set1_epi64(1023)), 52));
+    }
+    static Vec exponent(Vec a)
+    {
+        const __m512i biased =
+            _mm512_and_si512(_mm512_srli_epi64(_mm512_castpd_si512(a), 52), _mm512_set1_epi64(0x7FF));
+        const Vec e = _mm512_castsi512_pd(_mm512_or_si512(biased, _mm512_set1_epi64(EXPONENT_MAGIC_BITS)));
+        return _mm512_sub_pd(_mm512_sub_pd(e, _mm512_set1_pd(EXPONENT_MAGIC)), _mm512_set1_pd(1023.0));
+    }
+    static Vec mantissa(Vec a)
+    {
+        const __m512i bits = _mm512_and_si512(_mm512_castpd_si512(a), _mm512_set1_epi64(MANTISSA_BITS));
+        return _mm512_castsi512_pd(_mm512_or_si512(bits, _mm512_set1_epi64(ONE_BITS)));
+    }
+};
+#endif
+
+/**
+ * Packs of floats with the same interface and twice the lanes of the double packs of the same instruction set, Scalar
+ * tells the element type. Bit tricks are those of the double packs scaled to the float format, 1.5 * 2^23 rounds a
+ * float below 2^22 to an integer.
+ */
+constexpr float ROUND_MAGIC_F              = 12582912.0f;
+constexpr float EXPONENT_MAGIC_F           = 8388608.0f;
+constexpr std::int32_t EXPONENT_MAGIC_BITS_F = 0x4B000000;
+constexpr std::int32_t MANTISSA_BITS_F     = 0x007FFFFF;
+constexpr std::int32_t ONE_BITS_F          = 0x3F800000;
+
+struct ScalarPackF
+{
+    using Scalar                       = float;
+    using Vec                          = float;
+    using Mask                         = bool;
+    static constexpr std::size_t width = 1;
+
+    static Vec load(const float* p)
+    {
+        return *p;
+    }
+    static void store(float* p, Vec a)
+    {
+        *p = a;
+    }
+    static Vec set1(double a)
+    {
+        return static_cast<float>(a);
+    }
+    static Vec add(Vec a, Vec b)
+    {
+        return a + b;
+    }
+    static Vec sub(Vec a, Vec b)
+    {
+        return a - b;
+    }
+    static Vec mul(Vec a, Vec b)
+    {
+        return a * b;
+    }
+    static Vec div(Vec a, Vec b)
+    {
+        return a / b;
+    }
+    static Vec sqrt(Vec a)
+    {
+        return std::sqrt(a);
+    }
+    static Vec min(Vec a, Vec b)
+    {
+        return a < b ? a : b;
+    }
+    static Vec max(Vec a, Vec b)
+    {
+        return a > b ? a : b;
+    }
+    static Mask lt(Vec a, Vec b)
+    {
+        return a < b;
+    }
+    static Mask le(Vec a, Vec b)
+    {
+        return a <= b;
+    }
+    static Mask gt(Vec a, Vec b)
+    {
+        return a > b;
+    }
+    static Mask ge(Vec a, Vec b)
+    {
+        return a >= b;
+    }
+    static Mask both(Mask a, Mask b)
+    {
+        return a && b;
+    }
+    static Vec select(Mask m, Vec a, Vec b)
+    {
+        return m ? a : b;
+    }
+    static Mask eq(Vec a, Vec b)
+    {
+        return a == b;
+    }
+    static Mask unordered(Vec a, Vec b)
+    {
+        return a != a || b != b;
+    }
+    /**
+     * rounds to nearest even integer, |a| < 2^22
+     */
+    static Vec round(Vec a)
+    {
+        return (a + ROUND_MAGIC_F) - ROUND_MAGIC_F;
+    }
+    /**
+     * 2^n for integral n in [-126, 127]
+     */
+    static Vec pow2(Vec n)
+    {
+        const std::uint32_t bits = (bitsOf(n + ROUND_MAGIC_F) + 127) << 23;
+        return ofBits(bits);
+    }
+    static Vec exponent(Vec a)
+    {
+        return ofBits(((bitsOf(a) >> 23) & 0xFF) | EXPONENT_MAGIC_BITS_F) - EXPONENT_MAGIC_F - 127.0f;
+    }
+    static Vec mantissa(Vec a)
+    {
+        return ofBits((bitsOf(a) & MANTISSA_BITS_F) | ONE_BITS_F);
+    }
+
+private:
+    static std::uint32_t bitsOf(float a)
+    {
+        std::uint32_t bits{};
+        std::memcpy(&bits, &a, sizeof(bits));
+        return bits;
+    }
+    static float ofBits(std::uint32_t bits)
+    {
+        float a{};
+        std::memcpy(&a, &bits, sizeof(a));
+        return a;
+    }
+};
+
+#if defined(__SSE2__)
+struct Sse2PackF
+{
+    using Scalar                       = float;
+    using Vec                          = __m128;
+    using Mask                         = __m128;
+    static constexpr std::size_t width = 4;
+
+    static Vec load(const float* p)
+    {
+        return _mm_loadu_ps(p);
+    }
+    static void store(float* p, Vec a)
+    {
+        _mm_storeu_ps(p, a);
+    }
+    static Vec set1(double a)
+    {
+        return _mm_set1_ps(static_cast<float>(a));
+    }
+    static Vec add(Vec a, Vec b)
+    {
+        return _mm_add_ps(a, b);
+    }
+    static Vec sub(Vec a, Vec b)
+    {
+        return _mm_sub_ps(a, b);
+    }
+    static Vec mul(Vec a, Vec b)
+    {
+        return _mm_mul_ps(a, b);
+    }
+    static Vec div(Vec a, Vec b)
+    {
+        return _mm_div_ps(a, b);
+    }
+    static Vec sqrt(Vec a)
+    {
+        return _mm_sqrt_ps(a);
+    }
+    static Vec min(Vec a, Vec b)
+    {
+        return _mm_min_ps(a, b);
+    }
+    static Vec max(Vec a, Vec b)
+    {
+        return _mm_max_ps(a, b);
+    }
+    static Mask lt(Vec a, Vec b)
+    {
+        return _mm_cmplt_ps(a, b);
+    }
+    static Mask le(Vec a, Vec b)
+    {
+        return _mm_cmple_ps(a, b);
+    }
+    static Mask gt(Vec a, Vec b)
+    {
+        return _mm_cmpgt_ps(a, b);
+    }
+    static Mask ge(Vec a, Vec b)
+    {
+        return _mm_cmpge_ps(a, b);
+    }
+    static Mask both(Mask a, Mask b)
+    {
+        return _mm_and_ps(a, b);
+    }
+    static Vec select(Mask m, Vec a, Vec b)
+    {
+        return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+    }
+    static Mask eq(Vec a, Vec b)
+    {
+        return _mm_cmpeq_ps(a, b);
+    }
+    static Mask unordered(Vec a, Vec b)
+    {
+        return _mm_cmpunord_ps(a, b);
+    }
+    static Vec round(Vec a)
+    {
+        const Vec magic = _mm_set1_ps(ROUND_MAGIC_F);
+        return _mm_sub_ps(_mm_add_ps(a, magic), magic);
+    }
+    static Vec pow2(Vec n)
+    {
+        const __m128i bits = _mm_castps_si128(_mm_add_ps(n, _mm_set1_ps(ROUND_MAGIC_F)));
+        return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(bits, _mm_set1_epi32(127)), 23));
+    }
+    static Vec exponent(Vec a)
+    {
+        const __m128i biased = _mm_and_si128(_mm_srli_epi32(_mm_castps_si128(a), 23), _mm_set1_epi32(0xFF));
+        const Vec e = _mm_castsi128_ps(_mm_or_si128(biased, _mm_set1_epi32(EXPONENT_MAGIC_BITS_F)));
+        return _mm_sub_ps(_mm_sub_ps(e, _mm_set1_ps(EXPONENT_MAGIC_F)), _mm_set1_ps(127.0f));
+    }
+    static Vec mantissa(Vec a)
+    {
+        const __m128i bits = _mm_and_si128(_mm_castps_si128(a), _mm_set1_epi32(MANTISSA_BITS_F));
+        return _mm_castsi128_ps(_mm_or_si128(bits, _mm_set1_epi32(ONE_BITS_F)));
+    }
+};
+#endif
+
+#if defined(__AVX2__)
+struct Avx2PackF
+{
+    using Scalar                       = float;
+    using Vec                          = __m256;
+    using Mask                         = __m256;
+    static constexpr std::size_t width = 8;
+
+    static Vec load(const float* p)
+    {
+        return _mm256_loadu_ps(p);
+    }
+    static void store(float* p, Vec a)
+    {
+        _mm256_storeu_ps(p, a);
+    }
+    static Vec set1(double a)
+    {
+        return _mm256_set1_ps(static_cast<float>(a));
+    }
+    static Vec add(Vec a, Vec b)
+    {
+        return _mm256_add_ps(a, b);
+    }
+    static Vec sub(Vec a, Vec b)
+    {
+        return _mm256_sub_ps(a, b);
+    }
+    static Vec mul(Vec a, Vec b)
+    {
+        return _mm256_mul_ps(a, b);
+    }
+    static Vec div(Vec a, Vec b)
+    {
+        return _mm256_div_ps(a, b);
+    }
+    static Vec sqrt(Vec a)
+    {
+        return _mm256_sqrt_ps(a);
+    }
+    static Vec min(Vec a, Vec b)
+    {
+        return _mm256_min_ps(a, b);
+    }
+    static Vec max(Vec a, Vec b)
+    {
+        return _mm256_max_ps(a, b);
+    }
+    static Mask lt(Vec a, Vec b)
+    {
+        return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+    }
+    static Mask le(Vec a, Vec b)
+    {
+        return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+    }
+    static Mask gt(Vec a, Vec b)
+    {
+        return _mm256_cmp_ps(a, b, _CMP_GT_OQ);
+    }
+    static Mask ge(Vec a, Vec b)
+    {
+        return _mm256_cmp_ps(a, b, _CMP_GE_OQ);
+    }
+    static Mask both(Mask a, Mask b)
+    {
+        return _mm256_and_ps(a, b);
+    }
+    static Vec select(Mask m, Vec a, Vec b)
+    {
+        return _mm256_blendv_ps(b, a, m);
+    }
+    static Mask eq(Vec a, Vec b)
+    {
+        return _mm256_cmp_ps(a, b, _CMP_EQ_OQ);
+    }
+    static Mask unordered(Vec a, Vec b)
+    {
+        return _mm256_cmp_ps(a, b, _CMP_UNORD_Q);
+    }
+    static Vec round(Vec a)
+    {
+        const Vec magic = _mm256_set1_ps(ROUND_MAGIC_F);
+        return _mm256_sub_ps(_mm256_add_ps(a, magic), magic);
+    }
+    static Vec pow2(Vec n)
+    {
+        const __m256i bits = _mm256_castps_si256(_mm256_add_ps(n, _mm256_set1_ps(ROUND_MAGIC_F)));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(bits, _mm256_set1_epi32(127)), 23));
+    }
+    static Vec exponent(Vec a)
+    {
+        const __m256i biased =
+            _mm256_and_si256(_mm256_srli_epi32(_mm256_castps_si256(a), 23), _mm256_set1_epi32(0xFF));
+        const Vec e = _mm256_castsi256_ps(_mm256_or_si256(biased, _mm256_set1_epi32(EXPONENT_MAGIC_BITS_F)));
+        return _mm256_sub_ps(_mm256_sub_ps(e, _mm256_set1_ps(EXPONENT_MAGIC_F)), _mm256_set1_ps(127.0f));
+    }
+    static Vec mantissa(Vec a)
+    {
+        const __m256i bits = _mm256_and_si256(_mm256_castps_si256(a), _mm256_set1_epi32(MANTISSA_BITS_F));
+        return _mm256_castsi256_ps(_mm256_or_si256(bits, _mm256_set1_epi32(ONE_BITS_F)));
+    }
+};
+#endif
+
+#if defined(__AVX512F__)
+struct Avx512PackF
+{
+    using Scalar                       = float;
+    using Vec                          = __m512;
+    using Mask                         = __mmask16;
+    static constexpr std::size_t width = 16;
+
+    static Vec load(const float* p)
+    {
+        return _mm512_loadu_ps(p);
+    }
+    static void store(float* p, Vec a)
+    {
+        _mm512_storeu_ps(p, a);
+    }
+    static Vec set1(double a)
+    {
+        return _mm512_set1_ps(static_cast<float>(a));
+    }
+    static Vec add(Vec a, Vec b)
+    {
+        return _mm512_add_ps(a, b);
+    }
+    static Vec sub(Vec a, Vec b)
+    {
+        return _mm512_sub_ps(a, b);
+    }
+    static Vec mul(Vec a, Vec b)
+    {
+        return _mm512_mul_ps(a, b);
+    }
+    static Vec div(Vec a, Vec b)
+    {
+        return _mm512_div_ps(a, b);
+    }
+    static Vec sqrt(Vec a)
+    {
+        return _mm512_sqrt_ps(a);
+    }
+    static Vec min(Vec a, Vec b)
+    {
+        return _mm512_min_ps(a, b);
+    }
+    static Vec max(Vec a, Vec b)
+    {
+        return _mm512_max_ps(a, b);
+    }
+    static Mask lt(Vec a, Vec b)
+    {
+        return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);
+    }
+    static Mask le(Vec a, Vec b)
+    {
+        return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ);
+    }
+    static Mask gt(Vec a, Vec b)
+    {
+        return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ);
+    }
+    static Mask ge(Vec a, Vec b)
+    {
+        return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ);
+    }
+    static Mask both(Mask a, Mask b)
+    {
+        return static_cast<Mask>(a & b);
+    }
+    static Vec select(Mask m, Vec a, Vec b)
+    {
+        return _mm512_mask_blend_ps(m, b, a);
+    }
+    static Mask eq(Vec a, Vec b)
+    {
+        return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ);
+    }
+    static Mask unordered(Vec a, Vec b)
+    {
+        return _mm512_cmp_ps_mask(a, b, _CMP_UNORD_Q);
+    }
+    static Vec round(Vec a)
+    {
+        const Vec magic = _mm512_set1_ps(ROUND_MAGIC_F);
+        return _mm512_sub_ps(_mm512_add_ps(a, magic), magic);
+    }
+    static Vec pow2(Vec n)
+    {
+        const __m512i bits = _mm512_castps_si512(_mm512_add_ps(n, _mm512_set1_ps(ROUND_MAGIC_F)));
+        return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(bits, _mm512_set1_epi32(127)), 23));
+    }
+    static Vec exponent(Vec a)
+    {
+        const __m512i biased =
+            _mm512_and_si512(_mm512_srli_epi32(_mm512_castps_si512(a), 23), _mm512_set1_epi32(0xFF));
+        const Vec e = _mm512_castsi512_ps(_mm512_or_si512(biased, _mm512_set1_epi32(EXPONENT_MAGIC_BITS_F)));
+        return _mm512_sub_ps(_mm512_sub_ps(e, _mm512_set1_ps(EXPONENT_MAGIC_F)), _mm512_set1_ps(127.0f));
+    }
+    static Vec mantissa(Vec a)
+    {
+        const __m512i bits = _mm512_and_si512(_mm512_castps_si512(a), _mm512_set1_epi32(MANTISSA_BITS_F));
+        return _mm512_castsi512_ps(_mm512_or_si512(bits, _mm512_set1_epi32(ONE_BITS_F)));
+    }
+};
+#endif
+
+/**
+ * Single lane pack of scalar type T, for tails of loops over packs of T
+ */
+template <class T>
+using ScalarPackOf = std::conditional_t<std::is_same_v<T, float>, ScalarPackF, ScalarPack>;
+
+/**
+ * Limits of the exponential and logarithm below for the scalar type of the pack
+ */
+template <class T>
+struct MathLimits;
+
+template <>
+struct MathLimits<double>
+{
+    /**
+     * arguments beyond which exp2 and exp10 overflow to infinity or round to zero
+     */
+    static constexpr double EXP2_MAX  = 1024.0;
+    static constexpr double EXP2_MIN  = -1075.0;
+    static constexpr double EXP10_MAX = 310.0;
+    static constexpr double EXP10_MIN = -330.0;
+    /**
+     * log10(2) split into 33 leading bits, whose product with any exponent is exact, and the remainder
+     */
+    static constexpr double LOG10_2_HI = 0.3010299956658855;
+    static constexpr double LOG10_2_LO = -1.9043128467164274e-12;
+    /**
+     * smallest normal number, and the power of two scaling subnormals into the normal range
+     */
+    static constexpr double MIN_NORMAL      = 2.2250738585072014e-308;
+    static constexpr double SUBNORMAL_SCALE = 4503599627370496.0;
+    static constexpr double SUBNORMAL_BITS  = 52.0;
+};
+
+template <>
+struct MathLimits<float>
+{
+    static constexpr double EXP2_MAX        = 128.0;
+    static constexpr double EXP2_MIN        = -150.0;
+    static constexpr double EXP10_MAX       = 40.0;
+    static constexpr double EXP10_MIN       = -47.0;
+    static constexpr double LOG10_2_HI      = 0.30103302001953125;
+    static constexpr double LOG10_2_LO      = -3.0243555500547862e-06;
+    static constexpr double MIN_NORMAL      = 1.1754943508222875e-38;
+    static constexpr double SUBNORMAL_SCALE = 8388608.0;
+    static constexpr double SUBNORMAL_BITS  = 23.0;
+};
+
+/**
+ * Evaluates polynomial with coefficients c[0] + c[1] x + ... + c[N - 1] x^(N - 1) in Horner form
+ */
+template <class P, std::size_t N>
+inline typename P::Vec horner(typename P::Vec x, const typename P::Vec (&c)[N])
+{
+    typename P::Vec y = c[N - 1];
+    for (std::size_t k = N - 1; k-- > 0;) {
+        y = P::add(P::mul(y, x), c[k]);
+    }
+    return y;
+}
+
+/**
+ * 2^x within 2 ulp for any x, subnormal results included. The fraction x - round(x) in [-0.5, 0.5] goes through the
+ * Taylor series of e^y to degree 13, the integral part is applied in two steps so that results below 2^-1022 are still
+ * rounded once to a subnormal instead of flushed.
+ */
+template <class P>
+inline typename P::Vec exp2(typename P::Vec x)
+{
+    using Vec = typename P::Vec;
+    const Vec c[] = {P::set1(1.0),
+                     P::set1(1.0),
+                     P::set1(1.0 / 2),
+                     P::set1(1.0 / 6),
+                     P::set1(1.0 / 24),
+                     P::set1(1.0 / 120),
+                     P::set1(1.0 / 720),
+                     P::set1(1.0 / 5040),
+                     P::set1(1.0 / 40320),
+                     P::set1(1.0 / 362880),
+                     P::set1(1.0 / 3628800),
+                     P::set1(1.0 / 39916800),
+                     P::set1(1.0 / 479001600),
+                     P::set1(1.0 / 6227020800)};
+
+    // NaN passes through both clamps, 2^EXP2_MAX overflows to infinity and 2^EXP2_MIN rounds to zero
+    using L      = MathLimits<typename P::Scalar>;
+    x            = P::min(P::set1(L::EXP2_MAX), P::max(P::set1(L::EXP2_MIN), x));
+    const Vec n  = P::round(x);
+    const Vec y  = P::mul(P::sub(x, n), P::set1(0.6931471805599453));
+    const Vec n1 = P::round(P::mul(n, P::set1(0.5)));
+    const Vec n2 = P::sub(n, n1);
+    return P::mul(P::mul(horner<P>(y, c), P::pow2(n1)), P::pow2(n2));
+}
+
+/**
+ * 10^x within 2 ulp for any x, subnormal results included. x = n log10(2) + r with |r| <= log10(2) / 2, where
+ * n log10(2) is subtracted in two parts so that r stays exact to the last bits for |x| up to 330. e^(r ln 10) goes
+ * through the Taylor series to degree 15 and 2^n is applied in two steps as in exp2.
+ */
+template <class P>
+inline typename P::Vec exp10(typename P::Vec x)
+{
+    using Vec = typename P::Vec;
+    const Vec c[] = {P::set1(1.0),
+                     P::set1(1.0),
+                     P::set1(1.0 / 2),
+                     P::set1(1.0 / 6),
+                     P::set1(1.0 / 24),
+                     P::set1(1.0 / 120),
+                     P::set1(1.0 / 720),
+                     P::set1(1.0 / 5040),
+                     P::set1(1.0 / 40320),
+                     P::set1(1.0 / 362880),
+                     P::set1(1.0 / 3628800),
+                     P::set1(1.0 / 39916800),
+                     P::set1(1.0 / 479001600),
+                     P::set1(1.0 / 6227020800),
+                     P::set1(1.0 / 87178291200),
+                     P::set1(1.0 / 1307674368000)};
+
+    // NaN passes through both clamps, 10^EXP10_MAX overflows to infinity and 10^EXP10_MIN rounds to zero
+    using L      = MathLimits<typename P::Scalar>;
+    x            = P::min(P::set1(L::EXP10_MAX), P::max(P::set1(L::EXP10_MIN), x));
+    const Vec n  = P::round(P::mul(x, P::set1(3.3219280948873622)));
+    const Vec r  = P::sub(P::sub(x, P::mul(n, P::set1(L::LOG10_2_HI))), P::mul(n, P::set1(L::LOG10_2_LO)));
+    const Vec y  = P::mul(r, P::set1(2.302585092994046));
+    const Vec n1 = P::round(P::mul(n, P::set1(0.5)));
+    const Vec n2 = P::sub(n, n1);
+    return P::mul(P::mul(horner<P>(y, c), P::pow2(n1)), P::pow2(n2));
+}
+
+/**
+ * Splits positive x into exponent e and significand m in [sqrt(1/2), sqrt(2)), returned as the exact f = m - 1 and
+ * s = (m - 1) / (m + 1), so that ln(x) = e ln(2) + 2 atanh(s) with |s| < 0.172. Zero, negative and non-finite x give
+ * meaningless results.
+ */
+template <class P>
+inline void logReduce(typename P::Vec x, typename P::Vec& e, typename P::Vec& f, typename P::Vec& s)
+{
+    // subnormals are scaled into the normal range first
+    using L         = MathLimits<typename P::Scalar>;
+    const auto tiny = P::lt(x, P::set1(L::MIN_NORMAL));
+    const auto xs   = P::select(tiny, P::mul(x, P::set1(L::SUBNORMAL_SCALE)), x);
+    e               = P::sub(P::exponent(xs), P::select(tiny, P::set1(L::SUBNORMAL_BITS), P::set1(0.0)));
+    auto m          = P::mantissa(xs);
+    const auto big  = P::gt(m, P::set1(1.4142135623730951));
+    m               = P::select(big, P::mul(m, P::set1(0.5)), m);
+    e               = P::select(big, P::add(e, P::set1(1.0)), e);
+    f               = P::sub(m, P::set1(1.0));
+    s               = P::div(f, P::add(m, P::set1(1.0)));
+}
+
+/**
+ * Logarithm y of finite positive x with the special cases of x zero, negative, infinite or NaN applied
+ */
+template <class P>
+inline typename P::Vec logSpecial(typename P::Vec x, typename P::Vec y)
+{
+    y = P::select(P::eq(x, P::set1(0.0)), P::set1(-HUGE_VAL), y);
+    y = P::select(P::lt(x, P::set1(0.0)), P::set1(NAN), y);
+    y = P::select(P::eq(x, P::set1(HUGE_VAL)), x, y);
+    return P::select(P::unordered(x, x), x, y);
+}
+
+/**
+ * log2(x) within 3 ulp for any x. The significand m in [sqrt(1/2), sqrt(2)) goes through the atanh series
+ * log2(m) = 2 / ln 2 * (s + s^3 / 3 + ...) with s = (m - 1) / (m + 1), |s| < 0.172, to degree 21.
+ */
+template <class P>
+inline typename P::Vec log2(typename P::Vec x)
+{
+    using Vec = typename P::Vec;
+    constexpr double K = 2.0 / 0.6931471805599453;
+    const Vec c[]      = {P::set1(K),      P::set1(K / 3),  P::set1(K / 5),  P::set1(K / 7),
+                          P::set1(K / 9),  P::set1(K / 11), P::set1(K / 13), P::set1(K / 15),
+                          P::set1(K / 17), P::set1(K / 19), P::set1(K / 21)};
+
+    Vec e, f, s;
+    logReduce<P>(x, e, f, s);
+    return logSpecial<P>(x, P::add(e, P::mul(s, horner<P>(P::mul(s, s), c))));
+}
+
+/**
+ * log10(x) within 3 ulp for any x. ln(m) = f - f^2 / 2 + s (f^2 / 2 + R(s^2)) of f = m - 1 keeps the exact f as
+ * leading term, R is the atanh series past its first term to degree 20 in s. The exponent term e log10(2) is added
+ * in two parts, the leading one exact, so that results near zero keep their relative precision.
+ */
+template <class P>
+inline typename P::Vec log10(typename P::Vec x)
+{
+    using Vec     = typename P::Vec;
+    using L       = MathLimits<typename P::Scalar>;
+    const Vec c[] = {P::set1(2.0 / 3),  P::set1(2.0 / 5),  P::set1(2.0 / 7),  P::set1(2.0 / 9),  P::set1(2.0 / 11),
+                     P::set1(2.0 / 13), P::set1(2.0 / 15), P::set1(2.0 / 17), P::set1(2.0 / 19), P::set1(2.0 / 21)};
+
+    Vec e, f, s;
+    logReduce<P>(x, e, f, s);
+    const Vec z    = P::mul(s, s);
+    const Vec hfsq = P::mul(P::set1(0.5), P::mul(f, f));
+    const Vec ln   = P::add(P::sub(f, hfsq), P::mul(s, P::add(hfsq, P::mul(z, horner<P>(z, c)))));
+    const Vec tail = P::add(P::mul(e, P::set1(L::LOG10_2_LO)), P::mul(ln, P::set1(0.4342944819032518)));
+    return logSpecial<P>(x, P::add(P::mul(e, P::set1(L::LOG10_2_HI)), tail));
+}
+
+/**
+ * widest pack the translation unit is compiled for
+ */
+#if defined(__AVX512F__)
+using NativePack  = Avx512Pack;
+using NativePackF = Avx512PackF;
+#elif defined(__AVX2__)
+using NativePack  = Avx2Pack;
+using NativePackF = Avx2PackF;
+#elif defined(__SSE2__)
+using NativePack  = Sse2Pack;
+using NativePackF = Sse2PackF;
+#else
+using NativePack  = ScalarPack;
+using NativePackF = ScalarPackF;
+#endif
+
+} // namespace ASTROLIB_SIMD_NAMESPACE
+
+#endif // ASTROLIB_SIMD_H
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <utility>
+#include "include/constants.h"
+#include "include/skyindex.h"
+
+/**
+ * largest number of stars in a leaf, and smallest node whose halves are built as separate tasks
+ */
+static constexpr std::size_t LEAF     = 32;
+static constexpr std::size_t PARALLEL = 1 << 16;
+
+static constexpr double RADIAN = PI_NUMBER / 180.0;
+
+/**
+ * Squared distance from point q to nearest and farthest point of node box
+ */
+template <class Node>
+static double nearSquared(const Node& node, const double q[3])
+{
+    double d2 = 0.0;
+    for (int axis = 0; axis < 3; axis++) {
+        const double d = std::max({static_cast<double>(node.lo[axis]) - q[axis], q[axis] - node.hi[axis], 0.0});
+        d2 += d * d;
+    }
+    return d2;
+}
+template <class Node>
+static double farSquared(const Node& node, const double q[3])
+{
+    double d2 = 0.0;
+    for (int axis = 0; axis < 3; axis++) {
+        const double d = std::max(q[axis] - node.lo[axis], node.hi[axis] - q[axis]);
+        d2 += d * d;
+    }
+    return d2;
+}
+
+/**
+ * Smallest and largest value of n . p over node box
+ */
+template <class Node>
+static double minDot(const Node& node, const double n[3])
+{
+    double dot = 0.0;
+    for (int axis = 0; axis < 3; axis++) {
+        dot += n[axis] * (n[axis] > 0.0 ? node.lo[axis] : node.hi[axis]);
+    }
+    return dot;
+}
+template <class Node>
+static double maxDot(const Node& node, const double n[3])
+{
+    double dot = 0.0;
+    for (int axis = 0; axis < 3; axis++) {
+        dot += n[axis] * (n[axis] > 0.0 ? node.hi[axis] : node.lo[axis]);
+    }
+    return dot;
+}
+
+void SkyIndex::UnitVector(const double ra, const double dec, double v[3])
+{
+    const double cosDec = std::cos(dec * RADIAN);
+    v[0]                = cosDec * std::cos(ra * RADIAN);
+    v[1]                = cosDec * std::sin(ra * RADIAN);
+    v[2]                = std::sin(dec * RADIAN);
+}
+
+double SkyIndex::ChordSquared(const double angle)
+{
+    if (angle >= 180.0) {
+        return 4.0;
+    }
+    const double half = std::sin(0.5 * angle * RADIAN);
+    return 4.0 * half * half;
+}
+
+SkyIndex::SkyIndex(const double* ra, const double* dec, const std::size_t n, ThreadPool& pool)
+{
+    std::vector<char> valid(n);
+    pool.ParallelFor(0, n, PARALLEL, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            valid[i] = std::isfinite(ra[i]) && std::isfinite(dec[i]);
+        }
+    });
+    this->_entries.resize(static_cast<std::size_t>(std::count(valid.begin(), valid.end(), 1)));
+    for (std::size_t i = 0, j = 0; i < n; i++) {
+        if (valid[i]) {
+            this->_entries[j++].index = i;
+        }
+    }
+    pool.ParallelFor(0, this->_entries.size(), PARALLEL, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t j = begin; j < end; j++) {
+            Entry& entry = this->_entries[j];
+            UnitVector(ra[entry.index], dec[entry.index], entry.v);
+        }
+    });
+
+    // halving ranges down to leaf size keeps all leaves on one level, node ranges then follow from level and position
+    const std::size_t size = this->_entries.size();
+    while ((size + (std::size_t{1} << this->_depth) - 1) >> this->_depth > LEAF) {
+        this->_depth++;
+    }
+    this->_nodes.resize((std::size_t{2} << this->_depth) - 1);
+    if (size > 0) {
+        Build(0, 0, pool);
+    }
+}
+
+SkyIndex::SkyIndex(const StarCatalog& catalog, ThreadPool& pool)
+    : SkyIndex(catalog.RightAscension(), catalog.Declination(), catalog.Size(), pool)
+{
+}
+
+std::size_t SkyIndex::RangeBegin(const std::size_t node, const std::size_t level) const
+{
+    const std::size_t position = node + 1 - (std::size_t{1} << level);
+    return position * this->_entries.size() >> level;
+}
+
+void SkyIndex::Build(const std::size_t node, const std::size_t level, ThreadPool& pool)
+{
+    const std::size_t begin = RangeBegin(node, level);
+    const std::size_t end   = RangeBegin(node + 1, level);
+    const auto first        = this->_entries.begin() + static_cast<std::ptrdiff_t>(begin);
+    const auto last         = this->_entries.begin() + static_cast<std::ptrdiff_t>(end);
+
+    double lo[3] = {INFINITY, INFINITY, INFINITY};
+    double hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (auto entry = first; entry != last; ++entry) {
+        for (int axis = 0; axis < 3; axis++) {
+            lo[axis] = std::min(lo[axis], entry->v[axis]);
+            hi[axis] = std::max(hi[axis], entry->v[axis]);
+        }
+    }
+    Node& box = this->_nodes[node];
+    for (int axis = 0; axis < 3; axis++) {
+        box.lo[axis] = std::nextafter(static_cast<float>(lo[axis]), -2.0f);
+        box.hi[axis] = std::nextafter(static_cast<float>(hi[axis]), 2.0f);
+    }
+    if (level == this->_depth) {
+        return;
+    }
+
+    int axis = 0;
+    for (int other = 1; other < 3; other++) {
+        if (hi[other] - lo[other] > hi[axis] - lo[axis]) {
+            axis = other;
+        }
+    }
+    const auto middle = this->_entries.begin() + static_cast<std::ptrdiff_t>(RangeBegin(2 * node + 2, level + 1));
+    std::nth_element(first, middle, last, [axis](const Entry& a, const Entry& b) { return a.v[axis] < b.v[axis]; });
+
+    if (end - begin >= PARALLEL) {
+        pool.ParallelFor(0, 2, 1, [&](const std::size_t childBegin, const std::size_t childEnd) {
+            for (std::size_t child = childBegin; child < childEnd; child++) {
+                Build(2 * node + 1 + child, level + 1, pool);
+            }
+        });
+    } else {
+        Build(2 * node + 1, level + 1, pool);
+        Build(2 * node + 2, level + 1, pool);
+    }
+}
+
+std::size_t SkyIndex::Size() const
+{
+    return this->_entries.size();
+}
+
+void SkyIndex::Cone(const double ra, const double dec, const double radius, std::vector<std::size_t>& out) const
+{
+    if (this->_entries.empty() || !(radius >= 0.0)) {
+        return;
+    }
+    double q[3];
+    UnitVector(ra, dec, q);
+    const double chord2 = ChordSquared(radius);
+
+    std::pair<std::size_t, std::size_t> stack[64];
+    std::size_t top = 0;
+    stack[top++]    = {0, 0};
+    while (top > 0) {
+        const auto [node, level] = stack[--top];
+        if (nearSquared(this->_nodes[node], q) > chord2) {
+            continue;
+        }
+        const std::size_t begin = RangeBegin(node, level);
+        const std::size_t end   = RangeBegin(node + 1, level);
+        if (farSquared(this->_nodes[node], q) <= chord2) {
+            for (std::size_t j = begin; j < end; j++) {
+                out.push_back(this->_entries[j].index);
+            }
+        } else if (level == this->_depth) {
+            for (std::size_t j = begin; j < end; j++) {
+                const Entry& entry = this->_entries[j];
+                const double dx    = entry.v[0] - q[0];
+                const double dy    = entry.v[1] - q[1];
+                const double dz    = entry.v[2] - q[2];
+                if (dx * dx + dy * dy + dz * dz <= chord2) {
+                    out.push_back(entry.index);
+                }
+            }
+        } else {
+            stack[top++] = {2 * node + 2, level + 1};
+            stack[top++] = {2 * node + 1, level + 1};
+        }
+    }
+}
+
+std::vector<std::size_t> SkyIndex::Cone(const double ra, const double dec, const double radius) const
+{
+    std::vector<std::size_t> out;
+    Cone(ra, dec, radius, out);
+    return out;
+}
+
+void SkyIndex::Box(const double raMin, const double raMax, const double decMin, const double decMax,
+                   std::vector<std::size_t>& out) const
+{
+    if (this->_entries.empty() || !(decMin <= decMax)) {
+        return;
+    }
+    // declination limits are planes of constant z, right ascension limits are half-spaces east of raMin and west of
+    // raMax: stars must lie in both of them for ranges up to 180 degrees and in either of them for wider ranges
+    const double zMin    = std::sin(std::max(decMin, -90.0) * RADIAN);
+    const double zMax    = std::sin(std::min(decMax, 90.0) * RADIAN);
+    const bool fullRa    = raMax - raMin >= 360.0;
+    const bool narrowRa  = std::fmod(std::fmod(raMax - raMin, 360.0) + 360.0, 360.0) <= 180.0;
+    const double east[3] = {-std::sin(raMin * RADIAN), std::cos(raMin * RADIAN), 0.0};
+    const double west[3] = {std::sin(raMax * RADIAN), -std::cos(raMax * RADIAN), 0.0};
+    const double up[3]   = {0.0, 0.0, 1.0};
+
+    const auto insideRa = [&](const double eastDot, const double westDot) {
+        return fullRa || (narrowRa ? eastDot >= 0.0 && westDot >= 0.0 : eastDot >= 0.0 || westDot >= 0.0);
+    };
+
+    std::pair<std::size_t, std::size_t> stack[64];
+    std::size_t top = 0;
+    stack[top++]    = {0, 0};
+    while (top > 0) {
+        const auto [node, level] = stack[--top];
+        const Node& box          = this->_nodes[node];
+        if (maxDot(box, up) < zMin || minDot(box, up) > zMax || !insideRa(maxDot(box, east), maxDot(box, west))) {
+            continue;
+        }
+        const std::size_t begin = RangeBegin(node, level);
+        const std::size_t end   = RangeBegin(node + 1, level);
+        if (minDot(box, up) >= zMin && maxDot(box, up) <= zMax && insideRa(minDot(box, east), minDot(box, west))) {
+            for (std::size_t j = begin; j < end; j++) {
+                out.push_back(this->_entries[j].index);
+            }
+        } else if (level == this->_depth) {
+            for (std::size_t j = begin; j < end; j++) {
+                const Entry& entry = this->_entries[j];
+                const double eastDot = east[0] * entry.v[0] + east[1] * entry.v[1];
+                const double westDot = west[0] * entry.v[0] + west[1] * entry.v[1];
+                if (entry.v[2] >= zMin && entry.v[2] <= zMax && insideRa(eastDot, westDot)) {
+                    out.push_back(entry.index);
+                }
+            }
+        } else {
+            stack[top++] = {2 * node + 2, level + 1};
+            stack[top++] = {2 * node + 1, level + 1};
+        }
+    }
+}
+
+std::vector<std::size_t> SkyIndex::Box(const double raMin, const double raMax, const double decMin,
+                                       const double decMax) const
+{
+    std::vector<std::size_t> out;
+    Box(raMin, raMax, decMin, decMax, out);
+    return out;
+}
+
+std::vector<std::size_t> SkyIndex::Nearest(const double ra, const double dec, const std::size_t k) const
+{
+    std::vector<std::size_t> out;
+    if (this->_entries.empty() || k == 0) {
+        return out;
+    }
+    double q[3];
+    UnitVector(ra, dec, q);
+
+    // max-heap of the k best candidates so far, nearer child is visited first so that the bound shrinks early
+    std::priority_queue<std::pair<double, std::size_t>> best;
+    const auto bound = [&best, k] { return best.size() < k ? INFINITY : best.top().first; };
+
+    std::pair<std::size_t, std::size_t> stack[64];
+    std::size_t top = 0;
+    stack[top++]    = {0, 0};
+    while (top > 0) {
+        const auto [node, level] = stack[--top];
+        if (nearSquared(this->_nodes[node], q) > bound()) {
+            continue;
+        }
+        if (level == this->_depth) {
+            for (std::size_t j = RangeBegin(node, level); j < RangeBegin(node + 1, level); j++) {
+                const Entry& entry = this->_entries[j];
+                const double dx    = entry.v[0] - q[0];
+                const double dy    = entry.v[1] - q[1];
+                const double dz    = entry.v[2] - q[2];
+                const double d2    = dx * dx + dy * dy + dz * dz;
+                if (d2 < bound()) {
+                    if (best.size() == k) {
+                        best.pop();
+                    }
+                    best.emplace(d2, entry.index);
+                }
+            }
+            continue;
+        }
+        std::size_t nearer = 2 * node + 1;
+        std::size_t farther = 2 * node + 2;
+        if (nearSquared(this->_nodes[farther], q) < nearSquared(this->_nodes[nearer], q)) {
+            std::swap(nearer, farther);
+        }
+        stack[top++] = {farther, level + 1};
+        stack[top++] = {nearer, level + 1};
+    }
+
+    out.resize(best.size());
+    for (std::size_t i = out.size(); i-- > 0; best.pop()) {
+        out[i] = best.top().second;
+    }
+    return out;
+}
@@ -0,0 +1,180 @@
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include "include/spectrumdictionary.h"
+#include "include/star.h"
+
+/**
+ * Format table slot not formatted yet
+ */
+static constexpr SpectrumDictionary::Id UNFORMATTED = ~SpectrumDictionary::Id{0};
+
+/**
+ * Per thread direct mapped cache of recent lookups, slot valid for the dictionary of serial only
+ */
+struct RecentSpectrum
+{
+    std::uint64_t serial = 0;
+    SpectrumDictionary::Id id{};
+};
+static constexpr std::size_t RECENT = 256;
+static thread_local RecentSpectrum recent[RECENT];
+static std::atomic<std::uint64_t> serials{0};
+
+SpectrumDictionary::SpectrumDictionary()
+    : _shards(new Shard[SHARDS]), _chunks(new std::atomic<Entry*>[MAX_CHUNKS]),
+      _formats(new std::atomic<Id>[SPECTYPES * LUMCLASSES]),
+      _serial(serials.fetch_add(1, std::memory_order_relaxed) + 1)
+{
+    for (std::size_t k = 0; k < MAX_CHUNKS; k++) {
+        this->_chunks[k].store(nullptr, std::memory_order_relaxed);
+    }
+    for (int k = 0; k < SPECTYPES * LUMCLASSES; k++) {
+        this->_formats[k].store(UNFORMATTED, std::memory_order_relaxed);
+    }
+    Intern("");
+}
+
+SpectrumDictionary::~SpectrumDictionary()
+{
+    for (std::size_t k = 0; k < MAX_CHUNKS; k++) {
+        delete[] this->_chunks[k].load(std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Entry of new id, its chunk is allocated by the first thread to need it
+ */
+SpectrumDictionary::Entry& SpectrumDictionary::Allocate(const Id id)
+{
+    std::atomic<Entry*>& chunk = this->_chunks[id >> CHUNK_BITS];
+    Entry* entries             = chunk.load(std::memory_order_acquire);
+    if (!entries) {
+        Entry* fresh = new Entry[CHUNK];
+        if (chunk.compare_exchange_strong(entries, fresh, std::memory_order_acq_rel)) {
+            entries = fresh;
+        } else {
+            delete[] fresh;
+        }
+    }
+    return entries[id & (CHUNK - 1)];
+}
+
+/**
+ * Entry of id if it is complete, ids being interned by another thread and ids never handed out give null
+ */
+const SpectrumDictionary::Entry* SpectrumDictionary::Find(const Id id) const
+{
+    if (id >= CHUNK * MAX_CHUNKS) {
+        return nullptr;
+    }
+    const Entry* entries = this->_chunks[id >> CHUNK_BITS].load(std::memory_order_acquire);
+    if (!entries || !entries[id & (CHUNK - 1)].ready.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return &entries[id & (CHUNK - 1)];
+}
+
+const SpectrumDictionary::Entry& SpectrumDictionary::At(const Id id) const
+{
+    const Entry* entry = Find(id);
+    if (!entry) {
+        throw std::out_of_range("spectrum dictionary: unknown id " + std::to_string(id));
+    }
+    return *entry;
+}
+
+SpectrumDictionary::Id SpectrumDictionary::Intern(const std::string_view spectrum)
+{
+    const std::uint64_t hash = std::hash<std::string_view>{}(spectrum);
+    RecentSpectrum& slot     = recent[hash % RECENT];
+    if (slot.serial == this->_serial && At(slot.id).spectrum == spectrum) {
+        return slot.id;
+    }
+    Shard& shard = this->_shards[(hash * 0x9E3779B97F4A7C15ULL) >> (64 - SHARD_BITS)];
+    {
+        const std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        const auto found = shard.ids.find(spectrum);
+        if (found != shard.ids.end()) {
+            slot = {this->_serial, found->second};
+            return found->second;
+        }
+    }
+
+    const std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    const auto found = shard.ids.find(spectrum);
+    if (found != shard.ids.end()) {
+        slot = {this->_serial, found->second};
+        return found->second;
+    }
+    const Id id = this->_size.fetch_add(1, std::memory_order_relaxed);
+    if (id >= CHUNK * MAX_CHUNKS) {
+        this->_size.fetch_sub(1, std::memory_order_relaxed);
+        throw std::length_error("spectrum dictionary: too many distinct spectra");
+    }
+    // the entry is complete before the shard lock publishes its id, the key views its own string
+    Entry& entry    = Allocate(id);
+    entry.spectrum  = spectrum;
+    entry.parsed    = Star::parseSpectrum(spectrum, entry.spectype, entry.lumclass);
+    entry.formatted = Star::formatSpectrum(entry.spectype, entry.lumclass);
+    entry.ready.store(true, std::memory_order_release);
+    shard.ids.emplace(entry.spectrum, id);
+    slot = {this->_serial, id};
+    return id;
+}
+
+SpectrumDictionary::Id SpectrumDictionary::Format(const int spectype, const int lumclass)
+{
+    if (spectype < 0 || spectype >= SPECTYPES || lumclass < 0 || lumclass >= LUMCLASSES) {
+        return Intern(Star::formatSpectrum(spectype, lumclass));
+    }
+    // racing threads format the same string and store the same id, release publishes the entry with it
+    std::atomic<Id>& slot = this->_formats[spectype * LUMCLASSES + lumclass];
+    Id id                 = slot.load(std::memory_order_acquire);
+    if (id == UNFORMATTED) {
+        id = Intern(Star::formatSpectrum(spectype, lumclass));
+        slot.store(id, std::memory_order_release);
+    }
+    return id;
+}
+
+bool SpectrumDictionary::Contains(const Id id) const
+{
+    return Find(id) != nullptr;
+}
+
+const std::string& SpectrumDictionary::Spectrum(const Id id) const
+{
+    return At(id).spectrum;
+}
+
+int SpectrumDictionary::SpectralType(const Id id) const
+{
+    return At(id).spectype;
+}
+
+int SpectrumDictionary::LuminosityClass(const Id id) const
+{
+    return At(id).lumclass;
+}
+
+bool SpectrumDictionary::Parsed(const Id id) const
+{
+    return At(id).parsed;
+}
+
+const std::string& SpectrumDictionary::Formatted(const Id id) const
+{
+    return At(id).formatted;
+}
+
+std::size_t SpectrumDictionary::Size() const
+{
+    return this->_size.load(std::memory_order_relaxed);
+}
+
+SpectrumDictionary& SpectrumDictionary::Default()
+{
+    static SpectrumDictionary* instance = new SpectrumDictionary;
+    return *instance;
+}
@@ -1,7 +1,13 @@
+#include <array>
+#include <cstdint>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <cmath>
+#include "include/instrument.h"
+#include "include/spectrumdictionary.h"
 #include "include/star.h"
-#include "include/constants.h"
+#include "include/starmath.h"
 
 Star::Star()  = default;
 Star::~Star() = default;
@@ -18,6 +24,49 @@ void Star::SetPhotosphereTemperature(const double photosphereTemperature)
 {
     this->_photosphereTemperature = photosphereTemperature;
 }
+void Star::SetParallax(const double parallax)
+{
+    this->_parallax = parallax;
+}
+void Star::SetRadialVelocity(const double radvel)
+{
+    this->_radvel = radvel;
+}
+void Star::SetVmagnitude(const double Vmagnitude)
+{
+    this->_Vmagnitude = Vmagnitude;
+}
+void Star::SetBmagnitude(const double Bmagnitude)
+{
+    this->_Bmagnitude = Bmagnitude;
+}
+void Star::SetRightAscension(const double ra)
+{
+    this->_ra = ra;
+}
+void Star::SetDeclination(const double dec)
+{
+    this->_dec = dec;
+}
+void Star::SetProperMotionRa(const double pmra)
+{
+    this->_pmra = pmra;
+}
+void Star::SetProperMotionDec(const double pmdec)
+{
+    this->_pmdec = pmdec;
+}
+void Star::SetSpectrum(const std::string& spectrum)
+{
+    this->_spectrum = SpectrumDictionary::Default().Intern(spectrum);
+}
+void Star::SetSpectrumId(const std::uint32_t id)
+{
+    if (!SpectrumDictionary::Default().Contains(id)) {
+        throw std::out_of_range("star: unknown spectrum id " + std::to_string(id));
+    }
+    this->_spectrum = id;
+}
 
 double Star::GetMass() const
 {
@@ -31,303 +80,317 @@ double Star::GetPhotosphereTemperature() const
 {
     return this->_photosphereTemperature;
 }
+double Star::GetParallax() const
+{
+    return this->_parallax;
+}
+double Star::GetRadialVelocity() const
+{
+    return this->_radvel;
+}
+double Star::GetVmagnitude() const
+{
+    return this->_Vmagnitude;
+}
+double Star::GetBmagnitude() const
+{
+    return this->_Bmagnitude;
+}
+double Star::GetRightAscension() const
+{
+    return this->_ra;
+}
+double Star::GetDeclination() const
+{
+    return this->_dec;
+}
+double Star::GetProperMotionRa() const
+{
+    return this->_pmra;
+}
+double Star::GetProperMotionDec() const
+{
+    return this->_pmdec;
+}
+const std::string& Star::GetSpectrum() const
+{
+    return SpectrumDictionary::Default().Spectrum(this->_spectrum);
+}
+std::uint32_t Star::GetSpectrumId() const
+{
+    return this->_spectrum;
+}
 
 double Star::Luminosity() const
 {
-    return 4 * PI_NUMBER * std::pow(this->_radius, 2) * STEFAN_BOLTZMANN_CONSTANT *
-           std::pow(this->_photosphereTemperature, 4);
+    ASTROLIB_PROBE(StarRadiusLuminosity, 1);
+    return StarMath::Luminosity(this->_radius, this->_photosphereTemperature);
 }
 
 void Star::bmv2rgb(double bv, double& r, double& g, double& b)
 {
-    double t = r = g = b = 0.0;
-
-    if (bv < -0.4) {
-        bv = -0.4;
-    }
-
-    if (bv > 2.0) {
-        bv = 2.0;
-    }
-
-    // red
-    if (bv >= -0.40 && bv < 0.00) {
-        t = (bv + 0.40) / (0.00 + 0.40);
-        r = 0.61 + (0.11 * t) + (0.1 * t * t);
-    } else if (bv >= 0.00 && bv < 0.40) {
-        t = (bv - 0.00) / (0.40 - 0.00);
-        r = 0.83 + (0.17 * t);
-    } else if (bv >= 0.40 && bv < 2.10) {
-        t = (bv - 0.40) / (2.10 - 0.40);
-        r = 1.00;
-    }
-
-    // green
-    if (bv >= -0.40 && bv < 0.00) {
-        t = (bv + 0.40) / (0.00 + 0.40);
-        g = 0.70 + (0.07 * t) + (0.1 * t * t);
-    } else if (bv >= 0.00 && bv < 0.40) {
-        t = (bv - 0.00) / (0.40 - 0.00);
-        g = 0.87 + (0.11 * t);
-    } else if (bv >= 0.40 && bv < 1.60) {
-        t = (bv - 0.40) / (1.60 - 0.40);
-        g = 0.98 - (0.16 * t);
-    } else if (bv >= 1.60 && bv < 2.00) {
-        t = (bv - 1.60) / (2.00 - 1.60);
-        g = 0.82 - (0.5 * t * t);
-    }
-
-    // blue
-    if (bv >= -0.40 && bv < 0.40) {
-        t = (bv + 0.40) / (0.40 + 0.40);
-        b = 1.00;
-    } else if (bv >= 0.40 && bv < 1.50) {
-        t = (bv - 0.40) / (1.50 - 0.40);
-        b = 1.00 - (0.47 * t) + (0.1 * t * t);
-    } else if (bv >= 1.50 && bv < 1.94) {
-        t = (bv - 1.50) / (1.94 - 1.50);
-        b = 0.63 - (0.6 * t * t);
+    ASTROLIB_PROBE(StarBmv2rgb, 1);
+    if (bv < -0.4 || bv > 2.0) {
+        ASTROLIB_SEGMENT(Bmv2rgbClamped);
     }
+    StarMath::bmv2rgb(bv, r, g, b);
 }
 
 double Star::bmv2temp(double bv)
 {
-    return 4600.0 * ((1.0 / ((0.92 * bv) + 1.7)) + (1.0 / ((0.92 * bv) + 0.62)));
+    ASTROLIB_PROBE(StarBmv2temp, 1);
+    return StarMath::bmv2temp(bv);
 }
 
 double Star::colorTemperature(double bv, int lumClass)
 {
-    double t = 0.0;
-
+    ASTROLIB_PROBE(StarColorTemperature, 1);
     if (lumClass <= LumClass::Ib) {
-        t = 4.012559732366214 - 1.055043117465989 * bv + 2.133394538571825 * bv * bv -
-            2.459769794654992 * bv * bv * bv + 1.349423943497744 * bv * bv * bv * bv -
-            0.283942579112032 * bv * bv * bv * bv * bv;
+        ASTROLIB_SEGMENT(ColorTemperatureSupergiant);
     } else {
-        t = 3.979145106714099 - 0.654992268598245 * bv + 1.740690042385095 * bv * bv -
-            4.608815154057166 * bv * bv * bv + 6.792599779944473 * bv * bv * bv * bv -
-            5.396909891322525 * bv * bv * bv * bv * bv + 2.192970376522490 * bv * bv * bv * bv * bv * bv -
-            0.359495739295671 * bv * bv * bv * bv * bv * bv * bv;
+        ASTROLIB_SEGMENT(ColorTemperatureOther);
     }
-
-    return pow(10.0, t);
+    return StarMath::colorTemperature(bv, lumClass);
 }
 
 double Star::bolometricCorrection(double t)
 {
-    double bc = INFINITY;
-
-    t = log10(t);
-    if (t > 3.9) {
-        bc = -0.118115450538963E+06 + 0.137145973583929E+06 * t - 0.636233812100225E+05 * t * t +
-             0.147412923562646E+05 * t * t * t - 0.170587278406872E+04 * t * t * t * t +
-             0.788731721804990E+02 * t * t * t * t * t;
-    } else if (t > 3.7) {
-        bc = -0.370510203809015E+05 + 0.385672629965804E+05 * t - 0.150651486316025E+05 * t * t +
-             0.261724637119416E+04 * t * t * t - 0.170623810323864E+03 * t * t * t * t;
+    ASTROLIB_PROBE(StarBolometricCorrection, 1);
+    const double logT = std::log10(t);
+    if (logT > 3.9) {
+        ASTROLIB_SEGMENT(BolometricCorrectionHot);
+    } else if (logT > 3.7) {
+        ASTROLIB_SEGMENT(BolometricCorrectionWarm);
     } else {
-        bc = -0.190537291496456E+05 + 0.155144866764412E+05 * t - 0.421278819301717E+04 * t * t +
-             0.381476328422343E+03 * t * t * t;
+        ASTROLIB_SEGMENT(BolometricCorrectionCool);
     }
-
-    return bc;
+    return StarMath::bolometricCorrectionLog(logT);
 }
 
 double Star::absoluteMagnitude(double appMag, double dist)
 {
-    if (dist > 0.0 && dist < INFINITY) {
-        return appMag - 5.0 * (log10(dist) - 1.0);
-    } else {
-        return -INFINITY;
+    ASTROLIB_PROBE(StarAbsoluteMagnitude, 1);
+    if (!(dist > 0.0 && dist < INFINITY)) {
+        ASTROLIB_SEGMENT(UnknownDistance);
     }
+    return StarMath::absoluteMagnitude(appMag, dist);
 }
 
 double Star::apparentMagnitude(double absMag, double dist)
 {
-    if (dist > 0.0 && dist < INFINITY) {
-        return absMag + 5.0 * (log10(dist) - 1.0);
-    } else {
-        return dist <= 0.0 ? -INFINITY : INFINITY;
+    ASTROLIB_PROBE(StarApparentMagnitude, 1);
+    if (!(dist > 0.0 && dist < INFINITY)) {
+        ASTROLIB_SEGMENT(UnknownDistance);
     }
+    return StarMath::apparentMagnitude(absMag, dist);
 }
 
 double Star::distanceFromMagnitude(double appMag, double absMag)
 {
-    return pow(10.0, (appMag - absMag) / 5.0 + 1.0);
+    ASTROLIB_PROBE(StarDistanceFromMagnitude, 1);
+    return StarMath::distanceFromMagnitude(appMag, absMag);
 }
 
 double Star::brightnessRatio(double magDiff)
 {
+    ASTROLIB_PROBE(StarBrightnessRatio, 1);
     if (std::isinf(magDiff)) {
-        return magDiff > 0.0 ? INFINITY : 0.0;
-    } else {
-        return pow(10.0, magDiff / 2.5);
+        ASTROLIB_SEGMENT(InfiniteMagnitude);
     }
+    return StarMath::brightnessRatio(magDiff);
 }
 
 double Star::magnitudeDifference(double ratio)
 {
-    return -2.5 * log10(ratio);
+    ASTROLIB_PROBE(StarMagnitudeDifference, 1);
+    return StarMath::magnitudeDifference(ratio);
 }
 
 double Star::magnitudeSum(double mag1, double mag2)
 {
-    if (std::isinf(mag2)) {
-        return mag1;
-    } else if (std::isinf(mag1)) {
-        return mag2;
-    } else {
-        return mag2 + magnitudeDifference(1.0 + brightnessRatio(mag1 - mag2));
+    ASTROLIB_PROBE(StarMagnitudeSum, 1);
+    if (std::isinf(mag1) || std::isinf(mag2)) {
+        ASTROLIB_SEGMENT(InfiniteMagnitude);
     }
+    return StarMath::magnitudeSum(mag1, mag2);
 }
 
 double Star::moffatFunction(double max, double r2, double beta)
 {
-    return max / pow(1.0 + r2, beta);
+    ASTROLIB_PROBE(StarMoffatFunction, 1);
+    return StarMath::moffatFunction(max, r2, beta);
 }
 
 double Star::moffatRadius(double z, double max, double beta)
 {
-    return sqrt(pow(max / z, 1.0 / beta) - 1.0);
+    ASTROLIB_PROBE(StarMoffatRadius, 1);
+    return StarMath::moffatRadius(z, max, beta);
 }
 
-int Star::spectralType(const std::string& spectrum)
+double Star::angularDistance(double ra1, double dec1, double ra2, double dec2)
 {
-    int spectype          = 0;
-    static char types[14] = {'W', 'O', 'B', 'A', 'F', 'G', 'K', 'M', 'L', 'T', 'C', 'R', 'N', 'S'};
-
-    for (int i = 0; i < spectrum.length(); i++) {
-        for (int k = 0; k < 14; k++) {
-            if (spectrum[i] == types[k]) {
-                spectype = k * 10;
-                i++;
-                if (spectrum[i] >= '0' && spectrum[i] <= '9') {
-                    spectype += spectrum[i] - '0';
-                }
+    ASTROLIB_PROBE(StarAngularDistance, 1);
+    return StarMath::angularDistance(ra1, dec1, ra2, dec2);
+}
 
-                return spectype;
+/**
+ * Luminosity class given by lowercase prefix (c, g, sg, sd, d, D), zero if there is none
+ */
+static int prefixLuminosityClass(std::string_view spectrum)
+{
+    if (spectrum.empty()) {
+        return 0;
+    }
+    switch (spectrum[0]) {
+        case 'c':
+            return Star::LumClass::Iab;
+        case 'g':
+            return Star::LumClass::III;
+        case 's':
+            if (spectrum.size() >= 2 && spectrum[1] == 'g') {
+                return Star::LumClass::IV;
             }
-        }
+            if (spectrum.size() >= 2 && spectrum[1] == 'd') {
+                return Star::LumClass::VI;
+            }
+            return 0;
+        case 'd':
+            return Star::LumClass::V;
+        case 'D':
+            return Star::LumClass::VII;
+        default:
+            return 0;
     }
-
-    return 0;
 }
 
-int Star::luminosityClass(const std::string& spectrum)
+/**
+ * Luminosity class given by roman numeral, numeral starts with I or V
+ */
+static int romanLuminosityClass(std::string_view numeral)
 {
-    int i        = 0;
-    int lumclass = 0;
+    const char c1 = numeral.size() > 1 ? numeral[1] : '\0';
+    const char c2 = numeral.size() > 2 ? numeral[2] : '\0';
 
-    if (spectrum[0] == 'c') {
-        lumclass = LumClass::Iab;
+    if (numeral[0] == 'V') {
+        if (c1 == 'I') {
+            return c2 == 'I' ? Star::LumClass::VII : Star::LumClass::VI;
+        }
+        return Star::LumClass::V;
     }
 
-    if (spectrum[0] == 'g') {
-        lumclass = LumClass::III;
+    switch (c1) {
+        case 'a':
+            if (c2 == 'b') {
+                return Star::LumClass::Iab;
+            }
+            return c2 == '0' ? Star::LumClass::Ia0 : Star::LumClass::Ia;
+        case 'A':
+            if (c2 == 'B') {
+                return Star::LumClass::Iab;
+            }
+            return c2 == '0' || c2 == '+' ? Star::LumClass::Ia0 : Star::LumClass::Ia;
+        case 'b':
+        case 'B':
+            return Star::LumClass::Ib;
+        case 'I':
+            return c2 == 'I' ? Star::LumClass::III : Star::LumClass::II;
+        case 'V':
+            return Star::LumClass::IV;
+        default:
+            return 0;
     }
+}
 
-    if (spectrum[0] == 's' && spectrum.size() >= 2) {
-        if (spectrum[1] == 'g') {
-            lumclass = LumClass::IV;
-        } else if (spectrum[1] == 'd') {
-            lumclass = LumClass::VI;
+int Star::spectralType(std::string_view spectrum)
+{
+    ASTROLIB_PROBE(StarSpectralType, 1);
+    for (std::size_t i = 0; i < spectrum.size(); i++) {
+        int spectype = StarMath::spectralTypeCode(spectrum[i]);
+        if (spectype >= 0) {
+            if (i + 1 < spectrum.size() && spectrum[i + 1] >= '0' && spectrum[i + 1] <= '9') {
+                spectype += spectrum[i + 1] - '0';
+            }
+            return spectype;
         }
     }
 
-    if (spectrum[0] == 'd') {
-        lumclass = LumClass::V;
-    }
-
-    if (spectrum[0] == 'D') {
-        lumclass = LumClass::VII;
-    }
+    return 0;
+}
 
-    if (lumclass > 0)
+int Star::luminosityClass(std::string_view spectrum)
+{
+    ASTROLIB_PROBE(StarLuminosityClass, 1);
+    const int lumclass = prefixLuminosityClass(spectrum);
+    if (lumclass > 0) {
         return lumclass;
+    }
 
-    i = (int)spectrum.find_first_of("IV");
-    if (i == std::string::npos) {
+    const std::size_t i = spectrum.find_first_of("IV");
+    if (i == std::string_view::npos) {
         return 0;
     }
+    return romanLuminosityClass(spectrum.substr(i));
+}
 
-    if (spectrum.compare(i, 3, "VII", 3) == 0) {
-        lumclass = LumClass::VII;
-    } else if (spectrum.compare(i, 2, "VI", 2) == 0) {
-        lumclass = LumClass::VI;
-    } else if (spectrum.compare(i, 1, "V", 1) == 0) {
-        lumclass = LumClass::V;
+bool Star::parseSpectrum(std::string_view spectrum, int& spectype, int& lumclass)
+{
+    ASTROLIB_PROBE(StarParseSpectrum, 1);
+    // single pass looking for the first spectral type letter and the first roman numeral at once
+    std::uint8_t wanted = StarMath::SPECTRAL_TYPE_MASK | StarMath::ROMAN_START;
+
+    spectype = 0;
+    lumclass = prefixLuminosityClass(spectrum);
+    if (lumclass > 0) {
+        ASTROLIB_SEGMENT(SpectrumPrefixClass);
+        wanted = StarMath::SPECTRAL_TYPE_MASK;
     }
 
-    else if (spectrum.compare(i, 3, "Iab", 3) == 0) {
-        lumclass = LumClass::Iab;
-    } else if (spectrum.compare(i, 3, "IAB", 3) == 0) {
-        lumclass = LumClass::Iab;
-    } else if (spectrum.compare(i, 3, "Ia0", 3) == 0) {
-        lumclass = LumClass::Ia0;
-    } else if (spectrum.compare(i, 3, "IA0", 3) == 0) {
-        lumclass = LumClass::Ia0;
-    } else if (spectrum.compare(i, 3, "IA+", 3) == 0) {
-        lumclass = LumClass::Ia0;
-    } else if (spectrum.compare(i, 2, "Ia", 2) == 0) {
-        lumclass = LumClass::Ia;
-    } else if (spectrum.compare(i, 2, "IA", 2) == 0) {
-        lumclass = LumClass::Ia;
-    } else if (spectrum.compare(i, 2, "Ib", 2) == 0) {
-        lumclass = LumClass::Ib;
-    } else if (spectrum.compare(i, 2, "IB", 2) == 0) {
-        lumclass = LumClass::Ib;
+    for (std::size_t i = 0; i < spectrum.size(); i++) {
+        const std::uint8_t c = StarMath::SPECTRUM_CHAR_CLASS[static_cast<unsigned char>(spectrum[i])] & wanted;
+        if (!c) {
+            continue;
+        }
+        if (c & StarMath::SPECTRAL_TYPE_MASK) {
+            spectype = ((c & StarMath::SPECTRAL_TYPE_MASK) - 1) * 10;
+            if (i + 1 < spectrum.size() && spectrum[i + 1] >= '0' && spectrum[i + 1] <= '9') {
+                spectype += spectrum[i + 1] - '0';
+            }
+            wanted &= ~StarMath::SPECTRAL_TYPE_MASK;
+        } else {
+            ASTROLIB_SEGMENT(SpectrumRomanClass);
+            lumclass = romanLuminosityClass(spectrum.substr(i));
+            wanted &= ~StarMath::ROMAN_START;
+        }
+        if (!wanted) {
+            break;
+        }
     }
 
-    else if (spectrum.compare(i, 3, "III", 3) == 0) {
-        lumclass = LumClass::III;
-    } else if (spectrum.compare(i, 2, "II", 2) == 0) {
-        lumclass = LumClass::II;
-    } else if (spectrum.compare(i, 2, "IV", 2) == 0) {
-        lumclass = LumClass::IV;
+    if (!spectype) {
+        ASTROLIB_SEGMENT(SpectrumNoType);
+    }
+    if (!lumclass) {
+        ASTROLIB_SEGMENT(SpectrumNoClass);
     }
-
-    return lumclass;
-}
-
-bool Star::parseSpectrum(const std::string& spectrum, int& spectype, int& lumclass)
-{
-    spectype = spectralType(spectrum);
-    lumclass = luminosityClass(spectrum);
     return spectype || lumclass;
 }
 
 std::string Star::formatSpectrum(int spectype, int lumclass)
 {
+    ASTROLIB_PROBE(StarFormatSpectrum, 1);
     std::string spectrum;
-    static char types[14] = {'W', 'O', 'B', 'A', 'F', 'G', 'K', 'M', 'L', 'T', 'C', 'R', 'N', 'S'};
 
     if (lumclass == LumClass::VII) {
         spectrum.append(1, 'D');
     }
 
     if (spectype > SpecType::W0 && spectype < SpecType::T0 + 9) {
-        spectrum.append(1, types[spectype / 10]);
+        spectrum.append(1, StarMath::spectralTypeLetter(spectype));
         spectrum.append(1, '0' + spectype % 10);
     }
 
-    if (lumclass == LumClass::Ia0) {
-        spectrum.append("Ia0");
-    } else if (lumclass == LumClass::Ia) {
-        spectrum.append("Ia");
-    } else if (lumclass == LumClass::Iab) {
-        spectrum.append("Iab");
-    } else if (lumclass == LumClass::Ib) {
-        spectrum.append("Ib");
-    } else if (lumclass == LumClass::II) {
-        spectrum.append("II");
-    } else if (lumclass == LumClass::III) {
-        spectrum.append("III");
-    } else if (lumclass == LumClass::IV) {
-        spectrum.append("IV");
-    } else if (lumclass == LumClass::V) {
-        spectrum.append("V");
-    } else if (lumclass == LumClass::VI) {
-        spectrum.append("VI");
+    if (lumclass >= LumClass::Ia0 && lumclass <= LumClass::VII) {
+        spectrum.append(StarMath::LUMINOSITY_CLASSES[lumclass]);
     }
 
     return spectrum;
@@ -335,11 +398,12 @@ std::string Star::formatSpectrum(int spectype, int lumclass)
 
 double Star::luminosity(double mv, double bc)
 {
-    return brightnessRatio(4.725 - mv - bc);
+    ASTROLIB_PROBE(StarLuminosity, 1);
+    return StarMath::luminosity(mv, bc);
 }
 
 double Star::radius(double lum, double temp)
 {
-    temp = 5770.0 / temp;
-    return temp * temp * sqrt(lum);
+    ASTROLIB_PROBE(StarRadius, 1);
+    return StarMath::radius(lum, temp);
 }
\ No newline at end of file
@@ -0,0 +1,375 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "include/instrument.h"
+#include "include/starbatch.h"
+#include "include/star.h"
+#include "include/starmath.h"
+#include "batchkernels.h"
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+const BatchKernels* scalarKernels()
+{
+    static constexpr BatchKernels kernels = batchKernels<ScalarPack, ScalarPackF>();
+    return &kernels;
+}
+
+static const char* const ISA_NAMES[] = {"scalar", "sse2", "avx2", "avx512"};
+
+/**
+ * Highest level the CPU and operating system support
+ */
+static StarBatch::Isa cpuIsa()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return StarBatch::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return StarBatch::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return StarBatch::SSE2;
+    }
+#elif defined(_M_X64)
+    // SSE2 is part of x86-64, wider registers also need the OS to save them, which XCR0 tells
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return StarBatch::SSE2;
+    }
+    __cpuid(info, 1);
+    const bool osxsave = info[2] & (1 << 27);
+    __cpuidex(info, 7, 0);
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    if ((info[1] & (1 << 16)) && (xcr0 & 0xE6) == 0xE6) {
+        return StarBatch::AVX512;
+    }
+    if ((info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6) {
+        return StarBatch::AVX2;
+    }
+    return StarBatch::SSE2;
+#endif
+    return StarBatch::Scalar;
+}
+
+/**
+ * Kernel tables by level, null where not built
+ */
+static const BatchKernels* const* kernelTables()
+{
+    static const BatchKernels* const tables[] = {scalarKernels(), sse2Kernels(), avx2Kernels(), avx512Kernels()};
+    return tables;
+}
+
+/**
+ * Highest level not above wanted which is both built and supported by the CPU
+ */
+static StarBatch::Isa supportedIsa(StarBatch::Isa wanted)
+{
+    static const StarBatch::Isa cpu = cpuIsa();
+    int isa                         = std::min<int>(wanted, cpu);
+    while (isa > StarBatch::Scalar && !kernelTables()[isa]) {
+        isa--;
+    }
+    return static_cast<StarBatch::Isa>(isa);
+}
+
+/**
+ * Level in use, chosen once at first use
+ */
+static std::atomic<int>& activeIsa()
+{
+    static std::atomic<int> isa{[] {
+        StarBatch::Isa wanted = StarBatch::AVX512;
+        if (const char* forced = std::getenv("ASTROLIB_ISA")) {
+            for (int k = StarBatch::Scalar; k <= StarBatch::AVX512; k++) {
+                if (std::strcmp(forced, ISA_NAMES[k]) == 0) {
+                    wanted = static_cast<StarBatch::Isa>(k);
+                }
+            }
+        }
+        return static_cast<int>(supportedIsa(wanted));
+    }()};
+    return isa;
+}
+
+static const BatchKernels& kernels()
+{
+    return *kernelTables()[activeIsa().load(std::memory_order_relaxed)];
+}
+
+StarBatch::Isa StarBatch::isa()
+{
+    return static_cast<Isa>(activeIsa().load(std::memory_order_relaxed));
+}
+
+StarBatch::Isa StarBatch::setIsa(const Isa isa)
+{
+    const Isa chosen = supportedIsa(isa);
+    activeIsa().store(chosen, std::memory_order_relaxed);
+    return chosen;
+}
+
+const char* StarBatch::isaName(const Isa isa)
+{
+    return isa >= Scalar && isa <= AVX512 ? ISA_NAMES[isa] : "";
+}
+
+/**
+ * Number of elements i < n for which hit(i) holds, for segment counters
+ */
+template <class Hit>
+static std::size_t countIf(std::size_t n, Hit hit)
+{
+    std::size_t hits = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        hits += hit(i) ? 1 : 0;
+    }
+    return hits;
+}
+
+/**
+ * Counts the colorTemperature polynomial of every element in one pass
+ */
+static void countColorTemperatureSegments(const int* lumClass, std::size_t n)
+{
+#ifdef ASTROLIB_INSTRUMENT
+    const std::size_t supergiant = countIf(n, [lumClass](std::size_t i) { return lumClass[i] <= Star::LumClass::Ib; });
+    ASTROLIB_SEGMENTS(ColorTemperatureSupergiant, supergiant);
+    ASTROLIB_SEGMENTS(ColorTemperatureOther, n - supergiant);
+#else
+    (void)lumClass;
+    (void)n;
+#endif
+}
+
+#ifdef ASTROLIB_INSTRUMENT
+/**
+ * Smallest double whose log10 is above bound, temperatures from it up take the branch log10(t) > bound. Pow may round
+ * 10^bound to either side, so the neighbouring doubles are stepped through until log10 crosses.
+ */
+static double log10Threshold(const double bound)
+{
+    double t = std::pow(10.0, bound);
+    while (std::log10(t) > bound) {
+        t = std::nextafter(t, 0.0);
+    }
+    while (!(std::log10(t) > bound)) {
+        t = std::nextafter(t, INFINITY);
+    }
+    return t;
+}
+#endif
+
+/**
+ * Counts the bolometricCorrection polynomial of every element in one pass, temperatures are compared with the
+ * smallest doubles whose log10 is above 3.7 and 3.9 rather than taking log10. NaN and non-positive temperatures count
+ * as cool, as in the kernels.
+ */
+template <class T>
+static void countBolometricCorrectionSegments(const T* temp, std::size_t n)
+{
+#ifdef ASTROLIB_INSTRUMENT
+    static const double WARM = log10Threshold(3.7);
+    static const double HOT  = log10Threshold(3.9);
+    // hot temperatures are above both bounds
+    std::size_t hot = 0, aboveWarm = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        const double t = temp[i];
+        hot += t >= HOT ? 1 : 0;
+        aboveWarm += t >= WARM ? 1 : 0;
+    }
+    ASTROLIB_SEGMENTS(BolometricCorrectionHot, hot);
+    ASTROLIB_SEGMENTS(BolometricCorrectionWarm, aboveWarm - hot);
+    ASTROLIB_SEGMENTS(BolometricCorrectionCool, n - aboveWarm);
+#else
+    (void)temp;
+    (void)n;
+#endif
+}
+
+void StarBatch::Luminosity(const double* radius, const double* photosphereTemperature, double* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchRadiusLuminosity, n);
+    for (std::size_t i = 0; i < n; i++) {
+        out[i] = StarMath::Luminosity(radius[i], photosphereTemperature[i]);
+    }
+}
+
+void StarBatch::bmv2rgb(const double* bmv, double* r, double* g, double* b, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchBmv2rgb, n);
+    ASTROLIB_SEGMENTS(Bmv2rgbClamped, countIf(n, [bmv](std::size_t i) { return bmv[i] < -0.4 || bmv[i] > 2.0; }));
+    kernels().bmv2rgb(bmv, r, g, b, n);
+}
+
+void StarBatch::bmv2rgb(const double* bmv, double* rgb, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchBmv2rgb, n);
+    ASTROLIB_SEGMENTS(Bmv2rgbClamped, countIf(n, [bmv](std::size_t i) { return bmv[i] < -0.4 || bmv[i] > 2.0; }));
+    kernels().bmv2rgbInterleaved(bmv, rgb, n);
+}
+
+void StarBatch::bmv2rgb(const double* bmv, float* rgb, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchBmv2rgb, n);
+    ASTROLIB_SEGMENTS(Bmv2rgbClamped, countIf(n, [bmv](std::size_t i) { return bmv[i] < -0.4 || bmv[i] > 2.0; }));
+    kernels().bmv2rgbFloat(bmv, rgb, n);
+}
+
+void StarBatch::parseSpectrum(const std::string_view* spectra, int* spectype, int* lumclass, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchParseSpectrum, n);
+    for (std::size_t i = 0; i < n; i++) {
+        Star::parseSpectrum(spectra[i], spectype[i], lumclass[i]);
+    }
+}
+
+void StarBatch::absoluteMagnitude(const double* appMag, const double* distPC, double* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchAbsoluteMagnitude, n);
+    ASTROLIB_SEGMENTS(UnknownDistance,
+                      countIf(n, [distPC](std::size_t i) { return !(distPC[i] > 0.0 && distPC[i] < INFINITY); }));
+    kernels().absoluteMagnitude(appMag, distPC, out, n);
+}
+
+void StarBatch::apparentMagnitude(const double* absMag, const double* distPC, double* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchApparentMagnitude, n);
+    ASTROLIB_SEGMENTS(UnknownDistance,
+                      countIf(n, [distPC](std::size_t i) { return !(distPC[i] > 0.0 && distPC[i] < INFINITY); }));
+    kernels().apparentMagnitude(absMag, distPC, out, n);
+}
+
+void StarBatch::distanceFromMagnitude(const double* appMag, const double* absMag, double* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchDistanceFromMagnitude, n);
+    kernels().distanceFromMagnitude(appMag, absMag, out, n);
+}
+
+void StarBatch::brightnessRatio(const double* magDiff, double* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchBrightnessRatio, n);
+    ASTROLIB_SEGMENTS(InfiniteMagnitude, countIf(n, [magDiff](std::size_t i) { return std::isinf(magDiff[i]); }));
+    kernels().brightnessRatio(magDiff, out, n);
+}
+
+void StarBatch::magnitudeDifference(const double* ratio, double* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchMagnitudeDifference, n);
+    kernels().magnitudeDifference(ratio, out, n);
+}
+
+void StarBatch::colorTemperature(const double* bmv, const int* lumClass, double* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchColorTemperature, n);
+    countColorTemperatureSegments(lumClass, n);
+    kernels().colorTemperature(bmv, lumClass, out, n);
+}
+
+void StarBatch::bolometricCorrection(const double* temp, double* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchBolometricCorrection, n);
+    countBolometricCorrectionSegments(temp, n);
+    kernels().bolometricCorrection(temp, out, n);
+}
+
+void StarBatch::luminosity(const double* mv, const double* bc, double* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchLuminosity, n);
+    kernels().luminosity(mv, bc, out, n);
+}
+
+void StarBatch::radius(const double* lum, const double* temp, double* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchRadius, n);
+    for (std::size_t i = 0; i < n; i++) {
+        out[i] = StarMath::radius(lum[i], temp[i]);
+    }
+}
+
+void StarBatch::Luminosity(const float* radius, const float* photosphereTemperature, float* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchRadiusLuminosity, n);
+    for (std::size_t i = 0; i < n; i++) {
+        out[i] = StarMathF::Luminosity(radius[i], photosphereTemperature[i]);
+    }
+}
+
+void StarBatch::bmv2rgb(const float* bmv, float* r, float* g, float* b, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchBmv2rgb, n);
+    ASTROLIB_SEGMENTS(Bmv2rgbClamped, countIf(n, [bmv](std::size_t i) { return bmv[i] < -0.4f || bmv[i] > 2.0f; }));
+    kernels().bmv2rgbF(bmv, r, g, b, n);
+}
+
+void StarBatch::absoluteMagnitude(const float* appMag, const float* distPC, float* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchAbsoluteMagnitude, n);
+    ASTROLIB_SEGMENTS(UnknownDistance,
+                      countIf(n, [distPC](std::size_t i) { return !(distPC[i] > 0.0f && distPC[i] < INFINITY); }));
+    kernels().absoluteMagnitudeF(appMag, distPC, out, n);
+}
+
+void StarBatch::apparentMagnitude(const float* absMag, const float* distPC, float* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchApparentMagnitude, n);
+    ASTROLIB_SEGMENTS(UnknownDistance,
+                      countIf(n, [distPC](std::size_t i) { return !(distPC[i] > 0.0f && distPC[i] < INFINITY); }));
+    kernels().apparentMagnitudeF(absMag, distPC, out, n);
+}
+
+void StarBatch::distanceFromMagnitude(const float* appMag, const float* absMag, float* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchDistanceFromMagnitude, n);
+    kernels().distanceFromMagnitudeF(appMag, absMag, out, n);
+}
+
+void StarBatch::brightnessRatio(const float* magDiff, float* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchBrightnessRatio, n);
+    ASTROLIB_SEGMENTS(InfiniteMagnitude, countIf(n, [magDiff](std::size_t i) { return std::isinf(magDiff[i]); }));
+    kernels().brightnessRatioF(magDiff, out, n);
+}
+
+void StarBatch::magnitudeDifference(const float* ratio, float* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchMagnitudeDifference, n);
+    kernels().magnitudeDifferenceF(ratio, out, n);
+}
+
+void StarBatch::colorTemperature(const float* bmv, const int* lumClass, float* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchColorTemperature, n);
+    countColorTemperatureSegments(lumClass, n);
+    kernels().colorTemperatureF(bmv, lumClass, out, n);
+}
+
+void StarBatch::bolometricCorrection(const float* temp, float* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchBolometricCorrection, n);
+    countBolometricCorrectionSegments(temp, n);
+    kernels().bolometricCorrectionF(temp, out, n);
+}
+
+void StarBatch::luminosity(const float* mv, const float* bc, float* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchLuminosity, n);
+    kernels().luminosityF(mv, bc, out, n);
+}
+
+void StarBatch::radius(const float* lum, const float* temp, float* out, std::size_t n)
+{
+    ASTROLIB_PROBE(BatchRadius, n);
+    for (std::size_t i = 0; i < n; i++) {
+        out[i] = StarMathF::radius(lum[i], temp[i]);
+    }
+}
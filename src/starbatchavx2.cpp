@@ -0,0 +1,17 @@
+#include "batchkernels.h"
+
+/**
+ * StarBatch kernels on AVX2 lanes, the build compiles this file with AVX2 enabled on x86 targets
+ */
+#if defined(__AVX2__)
+const BatchKernels* avx2Kernels()
+{
+    static constexpr BatchKernels kernels = batchKernels<Avx2Pack, Avx2PackF>();
+    return &kernels;
+}
+#else
+const BatchKernels* avx2Kernels()
+{
+    return nullptr;
+}
+#endif
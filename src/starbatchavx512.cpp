@@ -0,0 +1,17 @@
+#include "batchkernels.h"
+
+/**
+ * StarBatch kernels on AVX-512 lanes, the build compiles this file with AVX-512 enabled on x86 targets
+ */
+#if defined(__AVX512F__)
+const BatchKernels* avx512Kernels()
+{
+    static constexpr BatchKernels kernels = batchKernels<Avx512Pack, Avx512PackF>();
+    return &kernels;
+}
+#else
+const BatchKernels* avx512Kernels()
+{
+    return nullptr;
+}
+#endif
@@ -0,0 +1,17 @@
+#include "batchkernels.h"
+
+/**
+ * StarBatch kernels on SSE2 lanes, the build compiles this file with SSE2 enabled on x86 targets
+ */
+#if defined(__SSE2__)
+const BatchKernels* sse2Kernels()
+{
+    static constexpr BatchKernels kernels = batchKernels<Sse2Pack, Sse2PackF>();
+    return &kernels;
+}
+#else
+const BatchKernels* sse2Kernels()
+{
+    return nullptr;
+}
+#endif
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "include/starfield.h"
+#include "include/starmath.h"
+#include "simd.h"
+
+/**
+ * Pixels of a star clipped to the frame, rows [top, bottom) and columns [left, right), empty for culled stars
+ */
+struct Footprint
+{
+    std::size_t left   = 0;
+    std::size_t right  = 0;
+    std::size_t top    = 0;
+    std::size_t bottom = 0;
+    /**
+     * squared radius where the profile reaches the threshold
+     */
+    double radius2     = 0.0;
+};
+
+static Footprint footprint(const FieldStar& star, const double threshold, const std::size_t width,
+                           const std::size_t height)
+{
+    Footprint fp{};
+    if (!(star.peak > threshold) || !(star.beta > 0.0) || !std::isfinite(star.x) || !std::isfinite(star.y)) {
+        return fp;
+    }
+    const double r     = StarMath::moffatRadius(threshold, star.peak, star.beta);
+    const double left  = std::max(0.0, std::ceil(star.x - r));
+    const double right = std::min(static_cast<double>(width), std::floor(star.x + r) + 1.0);
+    const double top   = std::max(0.0, std::ceil(star.y - r));
+    const double bot   = std::min(static_cast<double>(height), std::floor(star.y + r) + 1.0);
+    if (left < right && top < bot) {
+        fp.left    = static_cast<std::size_t>(left);
+        fp.right   = static_cast<std::size_t>(right);
+        fp.top     = static_cast<std::size_t>(top);
+        fp.bottom  = static_cast<std::size_t>(bot);
+        fp.radius2 = r * r;
+    }
+    return fp;
+}
+
+/**
+ * Moffat profile at pixels [first, last) of a row, peak * 2^(-beta * log2(1 + r^2)). Only whole packs are evaluated,
+ * returns number of pixels written to out.
+ */
+template <class P>
+static std::size_t moffatSpan(const FieldStar& star, const double dy2, const std::size_t first,
+                              const std::size_t last, double* out)
+{
+    using Vec = typename P::Vec;
+    double lane[P::width];
+    for (std::size_t k = 0; k < P::width; k++) {
+        lane[k] = static_cast<double>(k);
+    }
+    const Vec x    = P::set1(star.x);
+    const Vec dy   = P::set1(dy2);
+    const Vec one  = P::set1(1.0);
+    const Vec peak = P::set1(star.peak);
+    const Vec beta = P::set1(-star.beta);
+    const Vec step = P::set1(static_cast<double>(P::width));
+
+    Vec column    = P::add(P::set1(static_cast<double>(first)), P::load(lane));
+    std::size_t i = first;
+    for (; i + P::width <= last; i += P::width, column = P::add(column, step)) {
+        const Vec dx = P::sub(column, x);
+        const Vec r2 = P::add(P::mul(dx, dx), dy);
+        P::store(out + (i - first), P::mul(peak, exp2<P>(P::mul(beta, log2<P>(P::add(one, r2))))));
+    }
+    return i - first;
+}
+
+StarFieldRenderer::StarFieldRenderer(const std::size_t width, const std::size_t height, const double threshold,
+                                     ThreadPool& pool, const std::size_t tile)
+    : _width(width), _height(height), _threshold(threshold), _pool(pool), _tile(std::max<std::size_t>(tile, 1))
+{
+}
+
+template <std::size_t Channels>
+void StarFieldRenderer::RenderTiles(const FieldStar* stars, const std::size_t n, float* image) const
+{
+    const std::size_t tile   = this->_tile;
+    const std::size_t tilesX = (this->_width + tile - 1) / tile;
+    const std::size_t tilesY = (this->_height + tile - 1) / tile;
+
+    // stars binned into tiles they overlap, in input order so that every pixel sums stars in the same order
+    std::vector<Footprint> footprints(n);
+    std::vector<std::size_t> offsets(tilesX * tilesY + 1, 0);
+    for (std::size_t s = 0; s < n; s++) {
+        const Footprint fp = footprints[s] = footprint(stars[s], this->_threshold, this->_width, this->_height);
+        for (std::size_t ty = fp.top / tile; fp.top < fp.bottom && ty <= (fp.bottom - 1) / tile; ty++) {
+            for (std::size_t tx = fp.left / tile; tx <= (fp.right - 1) / tile; tx++) {
+                offsets[ty * tilesX + tx + 1]++;
+            }
+        }
+    }
+    for (std::size_t t = 0; t < tilesX * tilesY; t++) {
+        offsets[t + 1] += offsets[t];
+    }
+    std::vector<std::size_t> binned(offsets.back());
+    std::vector<std::size_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (std::size_t s = 0; s < n; s++) {
+        const Footprint& fp = footprints[s];
+        for (std::size_t ty = fp.top / tile; fp.top < fp.bottom && ty <= (fp.bottom - 1) / tile; ty++) {
+            for (std::size_t tx = fp.left / tile; tx <= (fp.right - 1) / tile; tx++) {
+                binned[cursor[ty * tilesX + tx]++] = s;
+            }
+        }
+    }
+
+    std::vector<double> colors;
+    if constexpr (Channels == 3) {
+        colors.resize(3 * n);
+        for (std::size_t s = 0; s < n; s++) {
+            StarMath::bmv2rgb(stars[s].bmv, colors[3 * s], colors[3 * s + 1], colors[3 * s + 2]);
+        }
+    }
+
+    const auto body = [&](const std::size_t begin, const std::size_t end) {
+        std::vector<double> row(tile);
+        for (std::size_t t = begin; t < end; t++) {
+            const double tileLeft  = static_cast<double>(t % tilesX * tile);
+            const double tileRight = std::min(static_cast<double>(this->_width), tileLeft + tile);
+            const std::size_t top  = t / tilesX * tile;
+            const std::size_t bot  = std::min(this->_height, top + tile);
+
+            for (std::size_t k = offsets[t]; k < offsets[t + 1]; k++) {
+                const std::size_t s   = binned[k];
+                const FieldStar& star = stars[s];
+                const Footprint& fp   = footprints[s];
+
+                for (std::size_t y = std::max(top, fp.top); y < std::min(bot, fp.bottom); y++) {
+                    const double dy   = static_cast<double>(y) - star.y;
+                    const double dy2  = dy * dy;
+                    const double half = fp.radius2 - dy2;
+                    if (half < 0.0) {
+                        continue;
+                    }
+                    const double chord = std::sqrt(half);
+                    const double left  = std::max(tileLeft, std::ceil(star.x - chord));
+                    const double right = std::min(tileRight, std::floor(star.x + chord) + 1.0);
+                    if (left >= right) {
+                        continue;
+                    }
+                    const auto first       = static_cast<std::size_t>(left);
+                    const auto last        = static_cast<std::size_t>(right);
+                    const std::size_t done = moffatSpan<NativePack>(star, dy2, first, last, row.data());
+                    moffatSpan<ScalarPack>(star, dy2, first + done, last, row.data() + done);
+
+                    float* pixel = image + (y * this->_width + first) * Channels;
+                    for (std::size_t i = 0; i < last - first; i++) {
+                        if constexpr (Channels == 1) {
+                            pixel[i] += static_cast<float>(row[i]);
+                        } else {
+                            for (std::size_t c = 0; c < Channels; c++) {
+                                pixel[Channels * i + c] += static_cast<float>(row[i] * colors[3 * s + c]);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    };
+    this->_pool.ParallelFor(0, tilesX * tilesY, 1, body);
+}
+
+void StarFieldRenderer::Render(const FieldStar* stars, const std::size_t n, float* image) const
+{
+    RenderTiles<1>(stars, n, image);
+}
+
+void StarFieldRenderer::RenderRgb(const FieldStar* stars, const std::size_t n, float* rgb) const
+{
+    RenderTiles<3>(stars, n, rgb);
+}
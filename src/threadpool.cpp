@@ -0,0 +1,165 @@
+#include <algorithm>
+#include "include/threadpool.h"
+
+struct ThreadPool::Job
+{
+    const std::function<void(std::size_t, std::size_t)>* body;
+    std::size_t grain;
+    /**
+     * number of elements not processed yet
+     */
+    std::atomic<std::size_t> remaining;
+    std::mutex errorMutex;
+    std::exception_ptr error;
+};
+
+/**
+ * pool and queue of the current worker thread
+ */
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local std::size_t currentQueue      = 0;
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        this->_queues.push_back(std::make_unique<Queue>());
+    }
+    // the calling thread is the last participant and uses the shared queue
+    for (unsigned i = 0; i + 1 < threads; i++) {
+        this->_workers.emplace_back([this, i] { WorkerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->_sleepMutex);
+        this->_stop = true;
+    }
+    this->_wake.notify_all();
+    for (std::thread& worker : this->_workers) {
+        worker.join();
+    }
+}
+
+unsigned ThreadPool::Concurrency() const
+{
+    return static_cast<unsigned>(this->_queues.size());
+}
+
+ThreadPool& ThreadPool::Default()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+std::size_t ThreadPool::CurrentQueue() const
+{
+    return currentPool == this ? currentQueue : this->_queues.size() - 1;
+}
+
+void ThreadPool::Push(const std::size_t queue, const Task& task)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->_queues[queue]->mutex);
+        this->_queues[queue]->tasks.push_back(task);
+    }
+    this->_queued++;
+    // taking the sleep mutex orders the push before any sleeping worker re-checks for work
+    { std::lock_guard<std::mutex> lock(this->_sleepMutex); }
+    this->_wake.notify_one();
+}
+
+bool ThreadPool::Pop(const std::size_t queue, Task& task)
+{
+    std::lock_guard<std::mutex> lock(this->_queues[queue]->mutex);
+    if (this->_queues[queue]->tasks.empty()) {
+        return false;
+    }
+    task = this->_queues[queue]->tasks.back();
+    this->_queues[queue]->tasks.pop_back();
+    this->_queued--;
+    return true;
+}
+
+bool ThreadPool::Steal(const std::size_t queue, Task& task)
+{
+    const std::size_t queues = this->_queues.size();
+    for (std::size_t k = 1; k < queues; k++) {
+        Queue& victim = *this->_queues[(queue + k) % queues];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            this->_queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::Execute(const std::size_t queue, Task task)
+{
+    Job& job = *task.job;
+
+    // keep the first half, publish the second one for this worker later or for thieves
+    while (task.end - task.begin > job.grain) {
+        const std::size_t middle = task.begin + (task.end - task.begin) / 2;
+        Push(queue, Task{&job, middle, task.end});
+        task.end = middle;
+    }
+
+    try {
+        (*job.body)(task.begin, task.end);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(job.errorMutex);
+        if (!job.error) {
+            job.error = std::current_exception();
+        }
+    }
+    job.remaining -= task.end - task.begin;
+}
+
+void ThreadPool::WorkerLoop(const std::size_t queue)
+{
+    currentPool  = this;
+    currentQueue = queue;
+
+    while (!this->_stop) {
+        Task task{};
+        if (Pop(queue, task) || Steal(queue, task)) {
+            Execute(queue, task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(this->_sleepMutex);
+        this->_wake.wait(lock, [this] { return this->_stop || this->_queued > 0; });
+    }
+}
+
+void ThreadPool::ParallelFor(const std::size_t begin, const std::size_t end, const std::size_t grain,
+                             const std::function<void(std::size_t, std::size_t)>& body)
+{
+    if (begin >= end) {
+        return;
+    }
+
+    Job job{&body, std::max<std::size_t>(grain, 1), {end - begin}, {}, {}};
+    const std::size_t queue = CurrentQueue();
+
+    Execute(queue, Task{&job, begin, end});
+    while (job.remaining > 0) {
+        Task task{};
+        if (Pop(queue, task) || Steal(queue, task)) {
+            Execute(queue, task);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    if (job.error) {
+        std::rethrow_exception(job.error);
+    }
+}
@@ -1,6 +1,35 @@
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
 #include "gtest/gtest.h"
 #include "astrolib.h"
 #include "star.h"
+#include "starbatch.h"
+#include "catalog.h"
+#include "faststar.h"
+#include "catalogfile.h"
+#include "catalogreader.h"
+#include "threadpool.h"
+#include "pipeline.h"
+#include "starmath.h"
+#include "starfield.h"
+#include "psffit.h"
+#include "photometry.h"
+#include "detection.h"
+#include "magnitudesum.h"
+#include "skyindex.h"
+#include "crossmatch.h"
+#include "epoch.h"
+#include "hrdiagram.h"
+#include "instrument.h"
+#include "derivedcache.h"
+#include "spectrumdictionary.h"
 
 TEST(Temperature, CelsiusToKelvin)
 {
@@ -40,7 +69,7 @@ TEST(Temperature, Luminosity)
     star.SetRadius(1000000000);
     star.SetPhotosphereTemperature(1000000);
 
-    ASSERT_DOUBLE_EQ(star.Luminosity(), 7.1256287744e+35);
+    ASSERT_DOUBLE_EQ(star.Luminosity(), 7.1256026471335572e+35);
 }
 
 TEST(bv, bmv2temp)
@@ -51,6 +80,63 @@ TEST(bv, bmv2temp)
     ASSERT_DOUBLE_EQ(Star::bmv2temp(-50.111), -204.7373022533063);
 }
 
+TEST(StarMath, ConstantFolding)
+{
+    static_assert(StarMath::bmv2temp(0) > 10125.23 && StarMath::bmv2temp(0) < 10125.24);
+    static_assert(StarMath::spectralTypeCode('G') == Star::SpecType::G0);
+    static_assert(StarMath::spectralTypeCode('x') < 0);
+    static_assert(StarMath::spectralTypeLetter(Star::SpecType::K0 + 3) == 'K');
+    static_assert(StarMath::colorTemperatureLog(0, 0) > 4.0125 && StarMath::colorTemperatureLog(0, 0) < 4.0126);
+    static_assert(StarMath::Luminosity(1, 1) == 4 * PI_NUMBER * STEFAN_BOLTZMANN_CONSTANT);
+
+    constexpr double red = [] {
+        double r = 0, g = 0, b = 0;
+        StarMath::bmv2rgb(0, r, g, b);
+        return r;
+    }();
+    static_assert(red == 0.83);
+
+    // polynomials as written out term by term before they moved to StarMath
+    const auto colorTemperature = [](double bv, int lumClass) {
+        if (lumClass <= Star::LumClass::Ib) {
+            return std::pow(10.0, 4.012559732366214 - 1.055043117465989 * bv + 2.133394538571825 * bv * bv -
+                                      2.459769794654992 * bv * bv * bv + 1.349423943497744 * bv * bv * bv * bv -
+                                      0.283942579112032 * bv * bv * bv * bv * bv);
+        }
+        return std::pow(10.0, 3.979145106714099 - 0.654992268598245 * bv + 1.740690042385095 * bv * bv -
+                                  4.608815154057166 * bv * bv * bv + 6.792599779944473 * bv * bv * bv * bv -
+                                  5.396909891322525 * bv * bv * bv * bv * bv +
+                                  2.192970376522490 * bv * bv * bv * bv * bv * bv -
+                                  0.359495739295671 * bv * bv * bv * bv * bv * bv * bv);
+    };
+    const auto bolometricCorrection = [](double t) {
+        t = std::log10(t);
+        if (t > 3.9) {
+            return -0.118115450538963E+06 + 0.137145973583929E+06 * t - 0.636233812100225E+05 * t * t +
+                   0.147412923562646E+05 * t * t * t - 0.170587278406872E+04 * t * t * t * t +
+                   0.788731721804990E+02 * t * t * t * t * t;
+        } else if (t > 3.7) {
+            return -0.370510203809015E+05 + 0.385672629965804E+05 * t - 0.150651486316025E+05 * t * t +
+                   0.261724637119416E+04 * t * t * t - 0.170623810323864E+03 * t * t * t * t;
+        }
+        return -0.190537291496456E+05 + 0.155144866764412E+05 * t - 0.421278819301717E+04 * t * t +
+               0.381476328422343E+03 * t * t * t;
+    };
+    for (double bv = -1; bv < 3; bv += 0.01) {
+        for (const int lumClass : {Star::LumClass::Ib, Star::LumClass::V}) {
+            const double expected = colorTemperature(bv, lumClass);
+            ASSERT_NEAR(std::pow(10.0, StarMath::colorTemperatureLog(bv, lumClass)), expected, 1e-9 * expected);
+            ASSERT_NEAR(Star::colorTemperature(bv, lumClass), expected, 1e-9 * expected);
+        }
+        const double t = 3000 + 10000 * (bv + 1);
+        ASSERT_NEAR(StarMath::bolometricCorrectionLog(std::log10(t)), bolometricCorrection(t), 1e-6);
+        ASSERT_NEAR(Star::bolometricCorrection(t), bolometricCorrection(t), 1e-6);
+    }
+    ASSERT_EQ(Star::formatSpectrum(Star::SpecType::B0 + 1, Star::LumClass::Iab), "B1Iab");
+    ASSERT_EQ(Star::formatSpectrum(Star::SpecType::A0 + 2, Star::LumClass::VII), "DA2");
+    ASSERT_EQ(Star::formatSpectrum(Star::SpecType::W0, Star::LumClass::VI), "VI");
+}
+
 TEST(Spectrum, luminosityClass)
 {
     ASSERT_EQ(Star::luminosityClass("g"), Star::LumClass::III);
@@ -61,6 +147,38 @@ TEST(Spectrum, luminosityClass)
     ASSERT_EQ(Star::luminosityClass("dog"), Star::LumClass::V);
 }
 
+TEST(Spectrum, parseSpectrum)
+{
+    int spectype = -1, lumclass = -1;
+
+    ASSERT_FALSE(Star::parseSpectrum("", spectype, lumclass));
+    ASSERT_EQ(spectype, 0);
+    ASSERT_EQ(lumclass, 0);
+    ASSERT_TRUE(Star::parseSpectrum("G", spectype, lumclass));
+    ASSERT_EQ(spectype, Star::SpecType::G0);
+    ASSERT_EQ(lumclass, 0);
+    ASSERT_FALSE(Star::parseSpectrum("I", spectype, lumclass));
+    ASSERT_TRUE(Star::parseSpectrum("B1Ia0", spectype, lumclass));
+    ASSERT_EQ(spectype, Star::SpecType::B0 + 1);
+    ASSERT_EQ(lumclass, Star::LumClass::Ia0);
+    ASSERT_TRUE(Star::parseSpectrum("dM4.5e", spectype, lumclass));
+    ASSERT_EQ(spectype, Star::SpecType::M0 + 4);
+    ASSERT_EQ(lumclass, Star::LumClass::V);
+    ASSERT_TRUE(Star::parseSpectrum("K0III-IV", spectype, lumclass));
+    ASSERT_EQ(spectype, Star::SpecType::K0);
+    ASSERT_EQ(lumclass, Star::LumClass::III);
+    ASSERT_TRUE(Star::parseSpectrum(std::string_view("A2VII", 4), spectype, lumclass));
+    ASSERT_EQ(lumclass, Star::LumClass::VI);
+
+    const std::string_view spectra[] = {"G2V", "", "sgK1", "O9.5Iab", "WC7", "s"};
+    int types[6], classes[6];
+    StarBatch::parseSpectrum(spectra, types, classes, 6);
+    for (int i = 0; i < 6; i++) {
+        ASSERT_EQ(types[i], Star::spectralType(spectra[i]));
+        ASSERT_EQ(classes[i], Star::luminosityClass(spectra[i]));
+    }
+}
+
 TEST(Temperature,Radius)
 {
     ASSERT_DOUBLE_EQ(Star::radius(0,1), 0.0);
@@ -176,4 +294,1434 @@ TEST(absoluteMagnitude, Star)
 {
     ASSERT_DOUBLE_EQ(Star::absoluteMagnitude(1, 2), 4.4948500216800937);
     ASSERT_DOUBLE_EQ(Star::absoluteMagnitude(-1, 2), 2.4948500216800937);
-}
\ No newline at end of file
+}
+
+TEST(StarCatalog, GatherScatter)
+{
+    std::vector<Star> stars(3);
+    for (int i = 0; i < 3; i++) {
+        stars[i].SetMass(1.0 + i);
+        stars[i].SetRadius(700000.0 * (i + 1));
+        stars[i].SetPhotosphereTemperature(5000.0 + 1000 * i);
+        stars[i].SetParallax(0.1 * i);
+        stars[i].SetVmagnitude(4.0 + i);
+        stars[i].SetBmagnitude(4.5 + i);
+        stars[i].SetRightAscension(120.0 * i);
+        stars[i].SetDeclination(-30.0 + 30.0 * i);
+    }
+    stars[1].SetSpectrum("G2V");
+
+    StarCatalog catalog;
+    catalog.Gather(stars);
+    ASSERT_EQ(catalog.Size(), 3);
+    ASSERT_EQ(catalog.SpectralType()[1], Star::SpecType::G0 + 2);
+    ASSERT_EQ(catalog.LuminosityClass()[1], Star::LumClass::V);
+
+    std::vector<Star> scattered;
+    catalog.Scatter(scattered);
+    ASSERT_EQ(scattered.size(), 3);
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(scattered[i].GetMass(), stars[i].GetMass());
+        ASSERT_EQ(scattered[i].GetRadius(), stars[i].GetRadius());
+        ASSERT_EQ(scattered[i].GetPhotosphereTemperature(), stars[i].GetPhotosphereTemperature());
+        ASSERT_EQ(scattered[i].GetParallax(), stars[i].GetParallax());
+        ASSERT_EQ(scattered[i].GetVmagnitude(), stars[i].GetVmagnitude());
+        ASSERT_EQ(scattered[i].GetBmagnitude(), stars[i].GetBmagnitude());
+        ASSERT_EQ(scattered[i].GetRightAscension(), stars[i].GetRightAscension());
+        ASSERT_EQ(scattered[i].GetDeclination(), stars[i].GetDeclination());
+    }
+    ASSERT_EQ(scattered[1].GetSpectrum(), "G2V");
+}
+
+TEST(StarCatalog, Derived)
+{
+    StarCatalog catalog;
+    Star star;
+    star.SetRadius(1000000000);
+    star.SetPhotosphereTemperature(1000000);
+    star.SetParallax(0.5);
+    star.SetVmagnitude(1);
+    star.SetBmagnitude(2);
+    catalog.Add(star);
+    star.SetParallax(0);
+    catalog.Add(star);
+
+    double out[2];
+    catalog.Luminosity(out);
+    ASSERT_DOUBLE_EQ(out[0], star.Luminosity());
+    catalog.AbsoluteMagnitude(out);
+    ASSERT_DOUBLE_EQ(out[0], Star::absoluteMagnitude(1, 2));
+    ASSERT_EQ(out[1], -INFINITY);
+    catalog.ColorTemperature(out);
+    ASSERT_NEAR(out[0], Star::colorTemperature(1, 0), 1e-12 * out[0]);
+}
+
+TEST(StarBatch, MatchesScalar)
+{
+    const double bmv[]  = {-0.3, 0.0, 0.65, 1.2, 1.9};
+    const int lum[]     = {Star::LumClass::Ia, Star::LumClass::V, Star::LumClass::III, Star::LumClass::Ib, 0};
+    const double temp[] = {3000, 5000, 7000, 9000, 30000};
+    double out[5];
+
+    StarBatch::colorTemperature(bmv, lum, out, 5);
+    for (int i = 0; i < 5; i++) {
+        ASSERT_NEAR(out[i], Star::colorTemperature(bmv[i], lum[i]), 1e-12 * out[i]);
+    }
+    StarBatch::bolometricCorrection(temp, out, 5);
+    for (int i = 0; i < 5; i++) {
+        ASSERT_NEAR(out[i], Star::bolometricCorrection(temp[i]), 5e-9);
+    }
+    StarBatch::luminosity(temp, bmv, out, 5);
+    for (int i = 0; i < 5; i++) {
+        ASSERT_DOUBLE_EQ(out[i], Star::luminosity(temp[i], bmv[i]));
+    }
+    StarBatch::radius(temp, temp, out, 5);
+    for (int i = 0; i < 5; i++) {
+        ASSERT_DOUBLE_EQ(out[i], Star::radius(temp[i], temp[i]));
+    }
+}
+
+TEST(StarBatch, bmv2rgb)
+{
+    std::vector<double> bmv = {-456, -0.4, 0.0, 0.4, 1.5, 1.6, 1.94, 2.0, 2.56, NAN};
+    for (double bv = -0.5; bv < 2.2; bv += 0.01) {
+        bmv.push_back(bv);
+    }
+    const std::size_t n = bmv.size();
+    std::vector<double> r(n), g(n), b(n), rgb(3 * n);
+    std::vector<float> rgbf(3 * n);
+
+    StarBatch::bmv2rgb(bmv.data(), r.data(), g.data(), b.data(), n);
+    StarBatch::bmv2rgb(bmv.data(), rgb.data(), n);
+    StarBatch::bmv2rgb(bmv.data(), rgbf.data(), n);
+    for (std::size_t i = 0; i < n; i++) {
+        double sr, sg, sb;
+        Star::bmv2rgb(bmv[i], sr, sg, sb);
+        ASSERT_EQ(r[i], sr);
+        ASSERT_EQ(g[i], sg);
+        ASSERT_EQ(b[i], sb);
+        ASSERT_EQ(rgb[3 * i + 0], sr);
+        ASSERT_EQ(rgb[3 * i + 1], sg);
+        ASSERT_EQ(rgb[3 * i + 2], sb);
+        ASSERT_EQ(rgbf[3 * i + 0], static_cast<float>(sr));
+        ASSERT_EQ(rgbf[3 * i + 1], static_cast<float>(sg));
+        ASSERT_EQ(rgbf[3 * i + 2], static_cast<float>(sb));
+    }
+}
+
+TEST(StarBatch, PolynomialErrorBound)
+{
+    std::vector<double> bmv, temp;
+    std::vector<int> lum;
+    for (double bv = -0.4; bv <= 2.0; bv += 0.001) {
+        bmv.push_back(bv);
+        lum.push_back(static_cast<int>(bmv.size() % 11));
+    }
+    for (double t = 2000; t <= 100000; t *= 1.001) {
+        temp.push_back(t);
+    }
+    std::vector<double> ct(bmv.size()), bc(temp.size());
+
+    StarBatch::colorTemperature(bmv.data(), lum.data(), ct.data(), bmv.size());
+    for (std::size_t i = 0; i < bmv.size(); i++) {
+        const double expected = Star::colorTemperature(bmv[i], lum[i]);
+        ASSERT_LE(std::fabs(ct[i] - expected), 1e-12 * expected);
+    }
+    StarBatch::bolometricCorrection(temp.data(), bc.data(), temp.size());
+    for (std::size_t i = 0; i < temp.size(); i++) {
+        ASSERT_LE(std::fabs(bc[i] - Star::bolometricCorrection(temp[i])), 5e-9);
+    }
+}
+
+/**
+ * Whether a is within ulps units in the last place of b, NaN matches NaN only
+ */
+static bool withinUlps(double a, double b, double ulps)
+{
+    if (std::isnan(a) || std::isnan(b) || std::isinf(a) || std::isinf(b) || a == b) {
+        return std::isnan(a) ? std::isnan(b) : a == b;
+    }
+    const double ulp = std::nextafter(std::fabs(b), INFINITY) - std::fabs(b);
+    return std::fabs(a - b) <= ulps * ulp;
+}
+
+/**
+ * Next number of a 64-bit linear congruential generator, uniform in [0, 1), reproducible across platforms
+ */
+static double uniform(std::uint64_t& state)
+{
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return static_cast<double>(state >> 11) / 9007199254740992.0;
+}
+
+TEST(StarBatch, MagnitudeConversions)
+{
+    std::vector<double> mag, dist, ratio;
+    for (double m = -800; m <= 800; m += 0.0173) {
+        mag.push_back(m);
+    }
+    for (double d = 1e-4; d < 1e12; d *= 1.0031) {
+        dist.push_back(d);
+    }
+    for (int e = -1074; e <= 1023; e++) {
+        ratio.push_back(std::ldexp(1.37, e));
+    }
+    // edge cases must come out exactly as from the scalar functions
+    for (const double edge : {0.0, -0.0, -1.0, HUGE_VAL, -HUGE_VAL, std::nan("")}) {
+        mag.push_back(edge);
+        dist.push_back(edge);
+        ratio.push_back(edge);
+    }
+    const std::size_t nm = mag.size(), nd = dist.size(), nr = ratio.size();
+    std::vector<double> appMag(nd), out(std::max({nm, nd, nr}));
+
+    for (std::size_t i = 0; i < nd; i++) {
+        appMag[i] = mag[i % nm];
+    }
+    StarBatch::absoluteMagnitude(appMag.data(), dist.data(), out.data(), nd);
+    for (std::size_t i = 0; i < nd; i++) {
+        const double expected = Star::absoluteMagnitude(appMag[i], dist[i]);
+        ASSERT_TRUE(withinUlps(out[i], expected, 2) || std::fabs(out[i] - expected) < 1e-13) << dist[i];
+    }
+    StarBatch::apparentMagnitude(appMag.data(), dist.data(), out.data(), nd);
+    for (std::size_t i = 0; i < nd; i++) {
+        const double expected = Star::apparentMagnitude(appMag[i], dist[i]);
+        ASSERT_TRUE(withinUlps(out[i], expected, 2) || std::fabs(out[i] - expected) < 1e-13) << dist[i];
+    }
+    StarBatch::distanceFromMagnitude(mag.data(), mag.data() + nm / 2, out.data(), nm / 2);
+    for (std::size_t i = 0; i < nm / 2; i++) {
+        ASSERT_TRUE(withinUlps(out[i], Star::distanceFromMagnitude(mag[i], mag[i + nm / 2]), 3)) << mag[i];
+    }
+    StarBatch::brightnessRatio(mag.data(), out.data(), nm);
+    for (std::size_t i = 0; i < nm; i++) {
+        ASSERT_TRUE(withinUlps(out[i], Star::brightnessRatio(mag[i]), 3)) << mag[i];
+    }
+    StarBatch::luminosity(mag.data(), mag.data() + nm / 2, out.data(), nm / 2);
+    for (std::size_t i = 0; i < nm / 2; i++) {
+        ASSERT_TRUE(withinUlps(out[i], Star::luminosity(mag[i], mag[i + nm / 2]), 3)) << mag[i];
+    }
+    StarBatch::magnitudeDifference(ratio.data(), out.data(), nr);
+    for (std::size_t i = 0; i < nr; i++) {
+        ASSERT_TRUE(withinUlps(out[i], Star::magnitudeDifference(ratio[i]), 4)) << ratio[i];
+    }
+}
+
+TEST(StarBatch, IsaLevels)
+{
+    std::vector<double> bmv, temp, dist, mag;
+    std::vector<int> lum;
+    for (double bv = -0.5; bv <= 2.1; bv += 0.003) {
+        bmv.push_back(bv);
+        lum.push_back(static_cast<int>(bmv.size() % 11));
+        temp.push_back(2000 + 100 * static_cast<double>(bmv.size()));
+        dist.push_back(bv * 100);
+        mag.push_back(bv * 20);
+    }
+    dist.back() = INFINITY;
+    mag.front() = -INFINITY;
+    mag.back()  = INFINITY;
+    const std::size_t n = bmv.size();
+    std::vector<double> r(n), g(n), b(n), ct(n), bc(n), absMag(n), ratio(n), diff(n);
+
+    const StarBatch::Isa initial = StarBatch::isa();
+    for (int level = StarBatch::Scalar; level <= StarBatch::AVX512; level++) {
+        const StarBatch::Isa isa = StarBatch::setIsa(static_cast<StarBatch::Isa>(level));
+        ASSERT_LE(isa, level);
+        ASSERT_EQ(StarBatch::isa(), isa);
+        if (isa != level) {
+            break;
+        }
+        StarBatch::bmv2rgb(bmv.data(), r.data(), g.data(), b.data(), n);
+        StarBatch::colorTemperature(bmv.data(), lum.data(), ct.data(), n);
+        StarBatch::bolometricCorrection(temp.data(), bc.data(), n);
+        StarBatch::absoluteMagnitude(mag.data(), dist.data(), absMag.data(), n);
+        StarBatch::brightnessRatio(mag.data(), ratio.data(), n);
+        StarBatch::magnitudeDifference(ratio.data(), diff.data(), n);
+        for (std::size_t i = 0; i < n; i++) {
+            double sr, sg, sb;
+            Star::bmv2rgb(bmv[i], sr, sg, sb);
+            ASSERT_EQ(r[i], sr) << StarBatch::isaName(isa);
+            ASSERT_EQ(g[i], sg) << StarBatch::isaName(isa);
+            ASSERT_EQ(b[i], sb) << StarBatch::isaName(isa);
+            const double expected = Star::colorTemperature(bmv[i], lum[i]);
+            ASSERT_LE(std::fabs(ct[i] - expected), 1e-12 * expected) << StarBatch::isaName(isa);
+            ASSERT_LE(std::fabs(bc[i] - Star::bolometricCorrection(temp[i])), 5e-9) << StarBatch::isaName(isa);
+            const double mv = Star::absoluteMagnitude(mag[i], dist[i]);
+            ASSERT_TRUE(withinUlps(absMag[i], mv, 2) || std::fabs(absMag[i] - mv) < 1e-13) << StarBatch::isaName(isa);
+            ASSERT_TRUE(withinUlps(ratio[i], Star::brightnessRatio(mag[i]), 3)) << StarBatch::isaName(isa);
+            ASSERT_TRUE(withinUlps(diff[i], Star::magnitudeDifference(ratio[i]), 4)) << StarBatch::isaName(isa);
+        }
+    }
+    ASSERT_STREQ(StarBatch::isaName(StarBatch::AVX2), "avx2");
+    ASSERT_EQ(StarBatch::setIsa(initial), initial);
+}
+
+TEST(StarMathF, MatchesDouble)
+{
+    for (float bv = -0.5f; bv <= 2.1f; bv += 0.0013f) {
+        float r, g, b;
+        double dr, dg, db;
+        StarMathF::bmv2rgb(bv, r, g, b);
+        StarMath::bmv2rgb(bv, dr, dg, db);
+        ASSERT_NEAR(r, dr, 1e-6) << bv;
+        ASSERT_NEAR(g, dg, 1e-6) << bv;
+        ASSERT_NEAR(b, db, 1e-6) << bv;
+        ASSERT_NEAR(StarMathF::bmv2temp(bv), StarMath::bmv2temp(bv), 1e-6 * StarMath::bmv2temp(bv)) << bv;
+        const double ct = StarMath::colorTemperature(bv, 5);
+        ASSERT_EQ(StarMathF::colorTemperatureLog(bv, 5), static_cast<float>(StarMath::colorTemperatureLog(bv, 5)));
+        ASSERT_NEAR(StarMathF::colorTemperature(bv, 5), ct, 1e-6 * ct) << bv;
+    }
+    for (float t = 2000; t <= 100000; t *= 1.0013f) {
+        ASSERT_NEAR(StarMathF::bolometricCorrection(t), StarMath::bolometricCorrection(t), 1e-5) << t;
+        const double lum = StarMath::Luminosity(6.957e8f, t);
+        ASSERT_NEAR(StarMathF::Luminosity(6.957e8f, t), lum, 1e-6 * lum) << t;
+        ASSERT_NEAR(StarMathF::radius(3.5f, t), StarMath::radius(3.5f, t), 1e-6 * StarMath::radius(3.5f, t)) << t;
+    }
+    for (float r2 = 0; r2 <= 100; r2 += 0.37f) {
+        const double z = StarMath::moffatFunction(1000, r2, 2.5);
+        ASSERT_NEAR(StarMathF::moffatFunction(1000, r2, 2.5f), z, 1e-6 * z) << r2;
+    }
+    for (float m = -20; m <= 20; m += 0.0173f) {
+        const double ratio = StarMath::brightnessRatio(m);
+        ASSERT_NEAR(StarMathF::brightnessRatio(m), ratio, 1e-5 * ratio) << m;
+        ASSERT_NEAR(StarMathF::absoluteMagnitude(m, 123.4f), StarMath::absoluteMagnitude(m, 123.4f), 1e-5) << m;
+    }
+    ASSERT_EQ(StarMathF::brightnessRatio(INFINITY), INFINITY);
+    ASSERT_EQ(StarMathF::apparentMagnitude(3, 0), -INFINITY);
+}
+
+/**
+ * Whether float a is b rounded to float or within tolerance of b, NaN matches NaN only
+ */
+static bool withinFloat(float a, double b, double tolerance)
+{
+    if (std::isnan(a) || std::isnan(b) || std::isinf(a) || std::isinf(b)) {
+        return std::isnan(a) ? std::isnan(b) : a == static_cast<float>(b);
+    }
+    return a == static_cast<float>(b) || std::fabs(a - b) <= tolerance;
+}
+
+TEST(StarBatch, Float)
+{
+    constexpr double EPS = 0x1p-24;
+    std::vector<float> mag, dist, ratio, bmv, temp;
+    std::vector<int> lum;
+    for (double m = -120; m <= 120; m += 0.0173) {
+        mag.push_back(static_cast<float>(m));
+    }
+    for (double d = 1e-4; d < 1e12; d *= 1.0031) {
+        dist.push_back(static_cast<float>(d));
+    }
+    for (int e = -149; e <= 127; e++) {
+        ratio.push_back(std::ldexp(1.37f, e));
+    }
+    for (double bv = -0.5; bv <= 2.1; bv += 0.0011) {
+        bmv.push_back(static_cast<float>(bv));
+        lum.push_back(static_cast<int>(bmv.size() % 11));
+    }
+    for (double t = 2000; t <= 100000; t *= 1.0007) {
+        temp.push_back(static_cast<float>(t));
+    }
+    // edge cases must come out exactly as from the double functions
+    for (const float edge : {0.0f, -0.0f, -1.0f, HUGE_VALF, -HUGE_VALF, std::nanf("")}) {
+        mag.push_back(edge);
+        dist.push_back(edge);
+        ratio.push_back(edge);
+    }
+    const std::size_t nm = mag.size(), nd = dist.size(), nr = ratio.size(), nb = bmv.size(), nt = temp.size();
+    std::vector<float> appMag(nd), out(std::max({nm, nd, nr, nb, nt})), g(nb), b(nb);
+    for (std::size_t i = 0; i < nd; i++) {
+        appMag[i] = mag[i % nm] / 3;
+    }
+    // exponentials are as exact as the float rounding of their decimal exponent e allows, relative 1 + ln(10) |e|
+    const auto exponential = [EPS](double expected, double e) {
+        return 2 * EPS * std::max(std::fabs(expected), static_cast<double>(FLT_MIN)) * (1 + 2.302585 * std::fabs(e));
+    };
+
+    const StarBatch::Isa initial = StarBatch::isa();
+    for (int level = StarBatch::Scalar; level <= StarBatch::AVX512; level++) {
+        const StarBatch::Isa isa = StarBatch::setIsa(static_cast<StarBatch::Isa>(level));
+        if (isa != level) {
+            break;
+        }
+        const char* name = StarBatch::isaName(isa);
+        StarBatch::absoluteMagnitude(appMag.data(), dist.data(), out.data(), nd);
+        for (std::size_t i = 0; i < nd; i++) {
+            const double expected = StarMath::absoluteMagnitude(appMag[i], dist[i]);
+            const double scale    = std::max<double>(std::fabs(appMag[i]), std::fabs(expected - appMag[i]));
+            ASSERT_TRUE(withinFloat(out[i], expected, 4 * EPS * scale)) << name << " " << dist[i];
+        }
+        StarBatch::apparentMagnitude(appMag.data(), dist.data(), out.data(), nd);
+        for (std::size_t i = 0; i < nd; i++) {
+            const double expected = StarMath::apparentMagnitude(appMag[i], dist[i]);
+            const double scale    = std::max<double>(std::fabs(appMag[i]), std::fabs(expected - appMag[i]));
+            ASSERT_TRUE(withinFloat(out[i], expected, 4 * EPS * scale)) << name << " " << dist[i];
+        }
+        StarBatch::distanceFromMagnitude(mag.data(), mag.data() + nm / 2, out.data(), nm / 2);
+        for (std::size_t i = 0; i < nm / 2; i++) {
+            const double expected = StarMath::distanceFromMagnitude(mag[i], mag[i + nm / 2]);
+            const double e        = (std::fabs(mag[i]) + std::fabs(mag[i + nm / 2])) / 5;
+            ASSERT_TRUE(withinFloat(out[i], expected, exponential(expected, e))) << name << " " << mag[i];
+        }
+        StarBatch::brightnessRatio(mag.data(), out.data(), nm);
+        for (std::size_t i = 0; i < nm; i++) {
+            const double expected = StarMath::brightnessRatio(mag[i]);
+            ASSERT_TRUE(withinFloat(out[i], expected, exponential(expected, mag[i] / 2.5))) << name << " " << mag[i];
+        }
+        StarBatch::luminosity(mag.data(), mag.data() + nm / 2, out.data(), nm / 2);
+        for (std::size_t i = 0; i < nm / 2; i++) {
+            const double expected = StarMath::luminosity(mag[i], mag[i + nm / 2]);
+            const double e        = (4.725 + std::fabs(mag[i]) + std::fabs(mag[i + nm / 2])) / 2.5;
+            ASSERT_TRUE(withinFloat(out[i], expected, exponential(expected, e))) << name << " " << mag[i];
+        }
+        StarBatch::magnitudeDifference(ratio.data(), out.data(), nr);
+        for (std::size_t i = 0; i < nr; i++) {
+            const double expected = StarMath::magnitudeDifference(ratio[i]);
+            ASSERT_TRUE(withinFloat(out[i], expected, 4 * EPS * std::fabs(expected))) << name << " " << ratio[i];
+        }
+
+        // computed in double, off the double reference by its rounding to float only
+        StarBatch::bmv2rgb(bmv.data(), out.data(), g.data(), b.data(), nb);
+        for (std::size_t i = 0; i < nb; i++) {
+            double dr, dg, db;
+            StarMath::bmv2rgb(bmv[i], dr, dg, db);
+            ASSERT_EQ(out[i], static_cast<float>(dr)) << name;
+            ASSERT_EQ(g[i], static_cast<float>(dg)) << name;
+            ASSERT_EQ(b[i], static_cast<float>(db)) << name;
+        }
+        StarBatch::colorTemperature(bmv.data(), lum.data(), out.data(), nb);
+        for (std::size_t i = 0; i < nb; i++) {
+            const double expected = StarMath::colorTemperature(bmv[i], lum[i]);
+            ASSERT_TRUE(withinFloat(out[i], expected, EPS * expected)) << name << " " << bmv[i];
+        }
+        StarBatch::bolometricCorrection(temp.data(), out.data(), nt);
+        for (std::size_t i = 0; i < nt; i++) {
+            const double expected = StarMath::bolometricCorrection(temp[i]);
+            ASSERT_TRUE(withinFloat(out[i], expected, 5e-9 + EPS * std::fabs(expected))) << name << " " << temp[i];
+        }
+    }
+    ASSERT_EQ(StarBatch::setIsa(initial), initial);
+}
+
+template <class Policy>
+static void checkFastStar()
+{
+    const double tol = Policy::tolerance;
+    for (double bv = -0.4; bv <= 2.0; bv += 0.0007) {
+        ASSERT_LE(std::fabs(FastStar<Policy>::bmv2temp(bv) / Star::bmv2temp(bv) - 1), tol);
+        ASSERT_LE(std::fabs(FastStar<Policy>::colorTemperature(bv, 2) / Star::colorTemperature(bv, 2) - 1), tol);
+        ASSERT_LE(std::fabs(FastStar<Policy>::colorTemperature(bv, 8) / Star::colorTemperature(bv, 8) - 1), tol);
+    }
+    for (double t = 2000; t <= 100000; t *= 1.0007) {
+        ASSERT_LE(std::fabs(FastStar<Policy>::bolometricCorrection(t) - Star::bolometricCorrection(t)), tol);
+    }
+    for (double m = -40; m <= 40; m += 0.0037) {
+        ASSERT_LE(std::fabs(FastStar<Policy>::brightnessRatio(m) / Star::brightnessRatio(m) - 1), tol);
+    }
+    ASSERT_EQ(FastStar<Policy>::brightnessRatio(INFINITY), INFINITY);
+    ASSERT_EQ(FastStar<Policy>::brightnessRatio(-INFINITY), 0.0);
+    ASSERT_EQ(FastStar<Policy>::bmv2temp(5.7553), Star::bmv2temp(5.7553));
+}
+
+TEST(FastStar, Policies)
+{
+    checkFastStar<PrecisePolicy>();
+    checkFastStar<FastPolicy>();
+    ASSERT_EQ(FastStar<ExactPolicy>::colorTemperature(1, 2), Star::colorTemperature(1, 2));
+    ASSERT_EQ(FastStar<ExactPolicy>::bolometricCorrection(123), Star::bolometricCorrection(123));
+}
+
+TEST(CatalogFile, RoundTrip)
+{
+    const std::string path = testing::TempDir() + "astrolib_roundtrip.astrocat";
+    StarCatalog catalog(1000);
+    for (std::size_t i = 0; i < catalog.Size(); i++) {
+        catalog.Mass()[i]            = 1.0 + i;
+        catalog.Vmagnitude()[i]      = 0.01 * i;
+        catalog.Declination()[i]     = 0.1 * i - 50.0;
+        catalog.SpectralType()[i]    = static_cast<int>(i % 140);
+        catalog.LuminosityClass()[i] = static_cast<int>(i % 10);
+    }
+    CatalogFile::Write(catalog, path);
+
+    CatalogFile file(path);
+    ASSERT_EQ(file.Size(), catalog.Size());
+    ASSERT_TRUE(file.Verify());
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(file.Vmagnitude()) % 64, 0);
+    const StarCatalog loaded = file.ToCatalog();
+    for (std::size_t i = 0; i < catalog.Size(); i++) {
+        ASSERT_EQ(file.Mass()[i], catalog.Mass()[i]);
+        ASSERT_EQ(loaded.Vmagnitude()[i], catalog.Vmagnitude()[i]);
+        ASSERT_EQ(file.Declination()[i], catalog.Declination()[i]);
+        ASSERT_EQ(loaded.SpectralType()[i], catalog.SpectralType()[i]);
+        ASSERT_EQ(file.LuminosityClass()[i], catalog.LuminosityClass()[i]);
+    }
+}
+
+TEST(CatalogFile, Corrupted)
+{
+    const std::string path = testing::TempDir() + "astrolib_corrupted.astrocat";
+    CatalogFile::Write(StarCatalog(10), path);
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(8);
+        file.put(99);
+    }
+    ASSERT_THROW(CatalogFile{path}, std::runtime_error);
+    ASSERT_THROW(CatalogFile{path + ".missing"}, std::runtime_error);
+
+    CatalogFile::Write(StarCatalog(10), path);
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(200);
+        file.put(1);
+    }
+    ASSERT_FALSE(CatalogFile(path).Verify());
+
+    // size whose column lengths wrap around 2^64 to a few bytes, under a valid header checksum
+    CatalogFile::Write(StarCatalog(10), path);
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        unsigned char header[136];
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+        const std::uint64_t size = (std::uint64_t{1} << 62) + 1;
+        std::memcpy(header + 16, &size, sizeof(size));
+        std::uint64_t hash = 0xcbf29ce484222325;
+        for (std::size_t i = 0; i < sizeof(header); i += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, header + i, 8);
+            hash = (hash ^ word) * 0x100000001b3;
+            hash ^= hash >> 29;
+        }
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+    }
+    ASSERT_THROW(CatalogFile{path}, std::runtime_error);
+}
+
+TEST(CatalogReader, Delimited)
+{
+    std::string text = "mass,radius,temp,plx,rv,V,B,sp\n";
+    for (int i = 0; i < 5000; i++) {
+        text += std::to_string(i) + ", 2.5,5800,0.1,,4.8,5.4, G2V\r\n";
+        if (i % 1000 == 0) {
+            text += "# comment\n\nbroken,line,x,1,2,3,4,A0\n";
+        }
+    }
+    std::istringstream input(text);
+    CatalogFormat format;
+    format.skipLines = 1;
+
+    StarCatalog catalog;
+    const CatalogReader::Stats stats =
+            CatalogReader(format, 4, 1000).Read(input, [&catalog](StarCatalog& batch) { catalog.Append(batch); });
+    ASSERT_EQ(stats.rows, 5000);
+    ASSERT_EQ(stats.malformed, 5);
+    ASSERT_EQ(stats.bytes, text.size());
+    ASSERT_EQ(catalog.Size(), 5000);
+    for (std::size_t i = 0; i < catalog.Size(); i++) {
+        ASSERT_EQ(catalog.Mass()[i], static_cast<double>(i));
+        ASSERT_EQ(catalog.Radius()[i], 2.5);
+        ASSERT_EQ(catalog.RadialVelocity()[i], 0.0);
+        ASSERT_EQ(catalog.Bmagnitude()[i], 5.4);
+        ASSERT_EQ(catalog.SpectralType()[i], Star::SpecType::G0 + 2);
+        ASSERT_EQ(catalog.LuminosityClass()[i], Star::LumClass::V);
+    }
+}
+
+TEST(CatalogReader, FixedWidth)
+{
+    std::istringstream input("  1.5  4.75K0III\n  2.0 -1.25A1V\n  3.0");
+    CatalogFormat format;
+    format.delimited                        = false;
+    format.start[CatalogFormat::Mass]       = 0;
+    format.width[CatalogFormat::Mass]       = 5;
+    format.start[CatalogFormat::Vmagnitude] = 5;
+    format.width[CatalogFormat::Vmagnitude] = 6;
+    format.start[CatalogFormat::Spectrum]   = 11;
+    format.width[CatalogFormat::Spectrum]   = 10;
+
+    StarCatalog catalog;
+    CatalogReader(format, 2).Read(input, [&catalog](StarCatalog& batch) { catalog.Append(batch); });
+    ASSERT_EQ(catalog.Size(), 3);
+    ASSERT_EQ(catalog.Vmagnitude()[1], -1.25);
+    ASSERT_EQ(catalog.Mass()[2], 3.0);
+    ASSERT_EQ(catalog.SpectralType()[0], Star::SpecType::K0);
+    ASSERT_EQ(catalog.LuminosityClass()[0], Star::LumClass::III);
+    ASSERT_EQ(catalog.LuminosityClass()[2], 0);
+}
+
+TEST(ThreadPool, ParallelFor)
+{
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> hits(100000);
+    pool.ParallelFor(0, hits.size(), 100, [&hits, &pool](std::size_t begin, std::size_t end) {
+        ASSERT_LE(end - begin, 100);
+        for (std::size_t i = begin; i < end; i++) {
+            hits[i]++;
+        }
+        // nested loops run on the same pool
+        std::atomic<std::size_t> inner{0};
+        pool.ParallelFor(0, 10, 1, [&inner](std::size_t b, std::size_t e) { inner += e - b; });
+        ASSERT_EQ(inner, 10);
+    });
+    for (const std::atomic<int>& hit : hits) {
+        ASSERT_EQ(hit, 1);
+    }
+
+    ASSERT_THROW(pool.ParallelFor(0, 1000, 10,
+                                  [](std::size_t begin, std::size_t) {
+                                      if (begin == 500) {
+                                          throw std::runtime_error("failed");
+                                      }
+                                  }),
+                 std::runtime_error);
+}
+
+TEST(StarPipeline, MatchesScalarChain)
+{
+    const char* samples[] = {"G2V", "K0III", "B1Ia0", "M4.5Ve", ""};
+    const std::size_t n   = 5000;
+    StarCatalog catalog(n);
+    std::vector<std::string_view> spectra(n);
+    for (std::size_t i = 0; i < n; i++) {
+        catalog.Vmagnitude()[i] = 2.0 + 0.001 * i;
+        catalog.Bmagnitude()[i] = catalog.Vmagnitude()[i] + 0.3 * (i % 7) - 0.2;
+        catalog.Parallax()[i]   = (i % 13 + 1) * 0.01;
+        spectra[i]              = samples[i % 5];
+        Star::parseSpectrum(spectra[i], catalog.SpectralType()[i], catalog.LuminosityClass()[i]);
+    }
+
+    std::vector<double> temperature(n), bc(n), mv(n), lum(n), radius(n);
+    DerivedColumns out;
+    out.temperature          = temperature.data();
+    out.bolometricCorrection = bc.data();
+    out.absoluteMagnitude    = mv.data();
+    out.luminosity           = lum.data();
+    out.radius               = radius.data();
+
+    ThreadPool pool(3);
+    for (int parse = 0; parse < 2; parse++) {
+        StarPipeline pipeline(pool, 700);
+        if (parse) {
+            pipeline.Run(catalog, spectra.data(), out);
+        } else {
+            pipeline.Run(catalog, out);
+        }
+        for (std::size_t i = 0; i < n; i++) {
+            const double t = Star::colorTemperature(catalog.Bmagnitude()[i] - catalog.Vmagnitude()[i],
+                                                    Star::luminosityClass(spectra[i]));
+            const double c = Star::bolometricCorrection(t);
+            const double m = Star::absoluteMagnitude(catalog.Vmagnitude()[i], 1 / catalog.Parallax()[i]);
+            const double l = Star::luminosity(m, c);
+            ASSERT_NEAR(temperature[i], t, 1e-12 * t);
+            ASSERT_NEAR(bc[i], c, 5e-9);
+            ASSERT_NEAR(mv[i], m, 1e-13);
+            ASSERT_NEAR(lum[i], l, 1e-8 * l);
+            ASSERT_NEAR(radius[i], Star::radius(l, t), 1e-8 * Star::radius(l, t));
+        }
+    }
+}
+
+TEST(StarFieldRenderer, MatchesPerPixel)
+{
+    const std::size_t width = 150, height = 110, n = 60;
+    const double threshold  = 1e-4;
+    std::vector<FieldStar> stars(n);
+    for (std::size_t i = 0; i < n; i++) {
+        stars[i].x    = -10.0 + 170.0 * std::fmod(i * 0.618034, 1.0);
+        stars[i].y    = -10.0 + 130.0 * std::fmod(i * 0.414214, 1.0);
+        stars[i].peak = 1.0 + 37.0 * (i % 11);
+        stars[i].beta = 1.5 + 0.25 * (i % 9);
+        stars[i].bmv  = -0.3 + 0.1 * (i % 23);
+    }
+
+    std::vector<float> image(width * height, 0.0f), serial(width * height, 0.0f), rgb(3 * width * height, 0.0f);
+    ThreadPool pool(3), single(1);
+    StarFieldRenderer(width, height, threshold, pool, 16).Render(stars.data(), n, image.data());
+    StarFieldRenderer(width, height, threshold, single, 37).Render(stars.data(), n, serial.data());
+    StarFieldRenderer(width, height, threshold, pool, 16).RenderRgb(stars.data(), n, rgb.data());
+
+    for (std::size_t y = 0; y < height; y++) {
+        for (std::size_t x = 0; x < width; x++) {
+            double expected = 0.0, red = 0.0;
+            for (const FieldStar& star : stars) {
+                const double r2 = (x - star.x) * (x - star.x) + (y - star.y) * (y - star.y);
+                double r, g, b;
+                Star::bmv2rgb(star.bmv, r, g, b);
+                expected += Star::moffatFunction(star.peak, r2, star.beta);
+                red += r * Star::moffatFunction(star.peak, r2, star.beta);
+            }
+            // every culled star contributes less than threshold
+            ASSERT_NEAR(image[y * width + x], expected, n * threshold + 1e-6 * expected);
+            ASSERT_NEAR(rgb[3 * (y * width + x)], red, n * threshold + 1e-6 * red);
+            ASSERT_EQ(image[y * width + x], serial[y * width + x]);
+        }
+    }
+}
+
+TEST(MoffatFitter, RecoversParameters)
+{
+    const std::size_t width = 17, height = 15, n = 40, pixels = width * height;
+    std::vector<MoffatParameters> truth(n);
+    std::vector<float> cutouts(n * pixels);
+    for (std::size_t i = 0; i < n; i++) {
+        MoffatParameters& p = truth[i];
+        p.x                 = 7.0 + 0.05 * (i % 17);
+        p.y                 = 6.5 + 0.07 * (i % 13);
+        p.peak              = 100.0 + 50.0 * (i % 7);
+        p.width             = 1.5 + 0.1 * (i % 11);
+        p.beta              = 2.0 + 0.2 * (i % 5);
+        p.background        = 10.0 + i % 3;
+        for (std::size_t k = 0; k < pixels; k++) {
+            const double dx = k % width - p.x, dy = k / width - p.y;
+            cutouts[i * pixels + k] = static_cast<float>(
+                    p.background + Star::moffatFunction(p.peak, (dx * dx + dy * dy) / (p.width * p.width), p.beta));
+        }
+    }
+
+    ThreadPool pool(3);
+    const MoffatFitter fitter(50, 1e-10, pool);
+    std::vector<MoffatFit> fits(n);
+    fitter.Fit(cutouts.data(), width, height, n, nullptr, fits.data());
+    for (std::size_t i = 0; i < n; i++) {
+        const MoffatParameters& p = fits[i].parameters;
+        ASSERT_TRUE(fits[i].converged);
+        ASSERT_NEAR(p.x, truth[i].x, 1e-4);
+        ASSERT_NEAR(p.y, truth[i].y, 1e-4);
+        ASSERT_NEAR(p.peak, truth[i].peak, 1e-4 * truth[i].peak);
+        ASSERT_NEAR(p.width, truth[i].width, 1e-4);
+        ASSERT_NEAR(p.beta, truth[i].beta, 1e-3);
+        ASSERT_NEAR(p.background, truth[i].background, 1e-3);
+
+        const float* cutout = cutouts.data() + i * pixels;
+        const MoffatFit fit = fitter.Fit(cutout, width, height, MoffatFitter::Guess(cutout, width, height));
+        ASSERT_EQ(fit.chi2, fits[i].chi2);
+        ASSERT_EQ(fit.parameters.x, p.x);
+    }
+}
+
+TEST(AperturePhotometry, Overlap)
+{
+    ASSERT_DOUBLE_EQ(AperturePhotometry::Overlap(-1.0, -1.0, 1.0, 1.0, 10.0), 4.0);
+    ASSERT_DOUBLE_EQ(AperturePhotometry::Overlap(0.0, 0.0, 10.0, 10.0, 1.0), PI_NUMBER / 4);
+    ASSERT_DOUBLE_EQ(AperturePhotometry::Overlap(0.0, -5.0, 5.0, 5.0, 2.0), 2.0 * PI_NUMBER);
+    ASSERT_DOUBLE_EQ(AperturePhotometry::Overlap(-0.5, -0.5, 0.5, 0.5, 0.5), PI_NUMBER / 4);
+    ASSERT_DOUBLE_EQ(AperturePhotometry::Overlap(2.0, 2.0, 3.0, 3.0, 2.5), 0.0);
+
+    // pixel weights of an aperture sum up to the disk area
+    const double r = 3.7;
+    for (const double cx : {0.0, 0.25, 0.5, 0.731}) {
+        double area = 0.0;
+        for (int j = -5; j <= 5; j++) {
+            for (int i = -5; i <= 5; i++) {
+                const double cy = 0.3 * cx;
+                area += AperturePhotometry::Overlap(i - 0.5 - cx, j - 0.5 - cy, i + 0.5 - cx, j + 0.5 - cy, r);
+            }
+        }
+        ASSERT_NEAR(area, PI_NUMBER * r * r, 1e-12);
+    }
+}
+
+TEST(AperturePhotometry, Measure)
+{
+    const std::size_t width = 64, height = 48;
+    std::vector<float> image(width * height, 10.0f);
+    const double x[] = {20.0, 40.3, 0.0, 31.6};
+    const double y[] = {20.0, 25.7, 0.0, 12.2};
+    image[20 * width + 20] += 1000.0f;
+    image[26 * width + 40] += 250.0f;
+    image[25 * width + 41] += 750.0f;
+    // hot pixels inside the annulus of the first source are clipped
+    image[29 * width + 20] = 1e4f;
+    image[20 * width + 11] = 1e4f;
+
+    ThreadPool pool(2);
+    const AperturePhotometry photometry(4.0, 8.0, 10.0, 25.0, 3.0, 5, pool);
+    ApertureMeasurement out[4];
+    photometry.Measure(image.data(), width, height, x, y, 4, out);
+
+    ASSERT_NEAR(out[0].area, PI_NUMBER * 16.0, 1e-9);
+    ASSERT_DOUBLE_EQ(out[0].background, 10.0);
+    ASSERT_DOUBLE_EQ(out[0].backgroundSigma, 0.0);
+    ASSERT_NEAR(out[0].flux, 1000.0, 1e-9);
+    ASSERT_NEAR(out[0].magnitude, 25.0 - 7.5, 1e-12);
+    ASSERT_NEAR(out[1].flux, 1000.0, 1e-9);
+    // only the part of the aperture inside the image counts
+    ASSERT_NEAR(out[2].area, AperturePhotometry::Overlap(-0.5, -0.5, 63.5, 47.5, 4.0), 1e-12);
+    ASSERT_NEAR(out[2].flux, 0.0, 1e-9);
+    ASSERT_NEAR(out[3].flux, 0.0, 1e-9);
+}
+
+TEST(StarDetector, StripsMatchWholeImage)
+{
+    const std::size_t width = 200, height = 150, n = 40;
+    std::vector<FieldStar> stars(n);
+    for (std::size_t i = 0; i < n; i++) {
+        stars[i].x    = 10.0 + 180.0 * std::fmod(i * 0.618034, 1.0);
+        stars[i].y    = 10.0 + 130.0 * std::fmod(i * 0.414214 + 0.1, 1.0);
+        stars[i].peak = 200.0 + 40.0 * (i % 9);
+        stars[i].beta = 3.0;
+    }
+    // a pair of stars crossing strip boundaries which merges into one source
+    stars[0].x = 100.0, stars[0].y = 63.5;
+    stars[1].x = 103.0, stars[1].y = 66.0;
+
+    std::vector<float> image(width * height, 100.0f);
+    ThreadPool pool(3);
+    StarFieldRenderer(width, height, 1.0, pool).Render(stars.data(), n, image.data());
+
+    const auto sorted = [](std::vector<DetectedSource> sources) {
+        std::sort(sources.begin(), sources.end(), [](const DetectedSource& a, const DetectedSource& b) {
+            return a.y != b.y ? a.y < b.y : a.x < b.x;
+        });
+        return sources;
+    };
+    StarDetector strips(5.0, 3, 8, 64, 3.0, pool);
+    StarDetector single(5.0, 3, 1000, 64, 3.0, pool);
+    const std::vector<DetectedSource> whole    = sorted(single.Detect(image.data(), width, height));
+    const std::vector<DetectedSource> detected = sorted(strips.Detect(image.data(), width, height));
+    strips.Begin(width);
+    for (std::size_t row = 0; row < height; row += 7) {
+        strips.Push(image.data() + row * width, std::min<std::size_t>(7, height - row));
+    }
+    const std::vector<DetectedSource> streamed = sorted(strips.Finish());
+
+    ASSERT_EQ(whole.size(), detected.size());
+    ASSERT_EQ(whole.size(), streamed.size());
+    for (std::size_t i = 0; i < whole.size(); i++) {
+        ASSERT_EQ(whole[i].pixels, detected[i].pixels);
+        ASSERT_NEAR(whole[i].x, detected[i].x, 1e-9);
+        ASSERT_NEAR(whole[i].y, detected[i].y, 1e-9);
+        ASSERT_NEAR(whole[i].flux, detected[i].flux, 1e-6 * whole[i].flux);
+        ASSERT_EQ(detected[i].pixels, streamed[i].pixels);
+        ASSERT_EQ(detected[i].flux, streamed[i].flux);
+    }
+
+    // every star but the merged pair is found near its position, the centroid is biased by the pixel grid cutting the
+    // profile at threshold
+    std::size_t found = 0;
+    for (std::size_t i = 2; i < n; i++) {
+        for (const DetectedSource& source : whole) {
+            if (std::hypot(source.x - stars[i].x, source.y - stars[i].y) < 0.1) {
+                // brightest pixel lies at most half a pixel away from centre along both axes
+                ASSERT_LE(source.moffat.peak, stars[i].peak);
+                ASSERT_GE(source.moffat.peak, Star::moffatFunction(stars[i].peak, 0.5, stars[i].beta));
+                found++;
+            }
+        }
+    }
+    ASSERT_EQ(found, n - 2);
+    ASSERT_EQ(whole.size(), n - 1);
+}
+
+TEST(StarDetector, DiagonalNeighbours)
+{
+    // two pairs of pixels touching only at corners, one pair across the seam of strips of 6 rows
+    const std::size_t width = 16, height = 16;
+    std::vector<float> image(width * height, 100.0f);
+    image[5 * width + 5]  = 200.0f;
+    image[6 * width + 6]  = 200.0f;
+    image[9 * width + 10] = 200.0f;
+    image[10 * width + 9] = 200.0f;
+
+    ThreadPool pool(2);
+    for (const std::size_t stripRows : {std::size_t{6}, std::size_t{1000}}) {
+        StarDetector detector(5.0, 2, stripRows, 64, 3.0, pool);
+        std::vector<DetectedSource> sources = detector.Detect(image.data(), width, height);
+        std::sort(sources.begin(), sources.end(),
+                  [](const DetectedSource& a, const DetectedSource& b) { return a.y < b.y; });
+        ASSERT_EQ(sources.size(), 2);
+        ASSERT_EQ(sources[0].pixels, 2);
+        ASSERT_DOUBLE_EQ(sources[0].x, 5.5);
+        ASSERT_DOUBLE_EQ(sources[0].y, 5.5);
+        ASSERT_EQ(sources[1].pixels, 2);
+        ASSERT_DOUBLE_EQ(sources[1].x, 9.5);
+        ASSERT_DOUBLE_EQ(sources[1].y, 9.5);
+    }
+}
+
+TEST(MagnitudeSum, Total)
+{
+    ThreadPool pool(3);
+    const std::size_t n = 1000000;
+    std::vector<double> mag(n, 20.0);
+    ASSERT_NEAR(MagnitudeSum::Total(mag.data(), n, pool), 5.0, 1e-12);
+
+    long double flux = 0.0L;
+    for (std::size_t i = 0; i < n; i++) {
+        mag[i] = 5.0 + 15.0 * std::fmod(i * 0.618034, 1.0);
+        flux += std::pow(10.0L, -mag[i] / 2.5L);
+    }
+    mag[17] = INFINITY;
+    flux -= std::pow(10.0L, -std::fmod(17 * 0.618034, 1.0) * 6.0L - 2.0L);
+    ASSERT_NEAR(MagnitudeSum::Total(mag.data(), n, pool), static_cast<double>(-2.5L * std::log10(flux)), 1e-12);
+
+    const double pair[] = {3.0, 3.0};
+    ASSERT_DOUBLE_EQ(MagnitudeSum::Total(pair, 2, pool), 3.0 - 2.5 * std::log10(2.0));
+    const double far[] = {-1233123.0, 567466.0};
+    ASSERT_DOUBLE_EQ(MagnitudeSum::Total(far, 2, pool), -1233123.0);
+
+    // infinite magnitudes are skipped as in Star::magnitudeSum
+    const double infinite[] = {INFINITY, 4.0, -INFINITY};
+    ASSERT_EQ(MagnitudeSum::Total(infinite, 3, pool), 4.0);
+    const double none[] = {-INFINITY, INFINITY};
+    ASSERT_EQ(MagnitudeSum::Total(none, 2, pool), Star::magnitudeSum(none[0], none[1]));
+    ASSERT_EQ(MagnitudeSum::Total(none + 1, 1, pool), INFINITY);
+    ASSERT_EQ(MagnitudeSum::Total(none, 0, pool), INFINITY);
+    const double nan[] = {1.0, NAN};
+    ASSERT_TRUE(std::isnan(MagnitudeSum::Total(nan, 2, pool)));
+}
+
+TEST(MagnitudeSum, Grouped)
+{
+    const std::size_t n = 300000, groups = 1000;
+    std::vector<double> mag(n);
+    std::vector<std::uint32_t> group(n);
+    for (std::size_t i = 0; i < n; i++) {
+        mag[i]   = i % 101 == 0 ? INFINITY : 8.0 + 10.0 * std::fmod(i * 0.414214, 1.0);
+        group[i] = static_cast<std::uint32_t>(i * 7919 % (groups + 3));
+    }
+
+    ThreadPool pool(3), single(1);
+    std::vector<double> out(groups), serial(groups);
+    MagnitudeSum::Grouped(mag.data(), group.data(), n, out.data(), groups, pool);
+    MagnitudeSum::Grouped(mag.data(), group.data(), n, serial.data(), groups, single);
+    for (std::size_t k = 0; k < groups; k++) {
+        std::vector<double> members;
+        for (std::size_t i = 0; i < n; i++) {
+            if (group[i] == k) {
+                members.push_back(mag[i]);
+            }
+        }
+        ASSERT_EQ(out[k], MagnitudeSum::Total(members.data(), members.size(), single));
+        ASSERT_EQ(out[k], serial[k]);
+    }
+}
+
+TEST(angularDistance, Star)
+{
+    ASSERT_NEAR(Star::angularDistance(10.0, 20.0, 10.0, 20.0), 0.0, 1e-12);
+    ASSERT_NEAR(Star::angularDistance(359.5, 0.0, 0.5, 0.0), 1.0, 1e-12);
+    ASSERT_NEAR(Star::angularDistance(0.0, 90.0, 123.0, 89.0), 1.0, 1e-12);
+    ASSERT_NEAR(Star::angularDistance(0.0, -45.0, 180.0, 45.0), 180.0, 1e-12);
+    ASSERT_NEAR(Star::angularDistance(0.0, 0.0, 90.0, 0.0), 90.0, 1e-12);
+}
+
+TEST(SkyIndex, MatchesBruteForce)
+{
+    const std::size_t n = 20000;
+    std::vector<double> ra(n), dec(n);
+    std::uint64_t state = 12345;
+    for (std::size_t i = 0; i < n; i++) {
+        ra[i]  = 360.0 * uniform(state);
+        dec[i] = std::asin(2.0 * uniform(state) - 1.0) * 180.0 / PI_NUMBER;
+    }
+    ra[7]  = NAN;
+    dec[9] = INFINITY;
+
+    ThreadPool pool(4);
+    const SkyIndex index(ra.data(), dec.data(), n, pool);
+    ASSERT_EQ(index.Size(), n - 2);
+
+    const auto sorted = [](std::vector<std::size_t> found) {
+        std::sort(found.begin(), found.end());
+        return found;
+    };
+    const double cones[][3] = {{0.0, 0.0, 3.0}, {359.0, 10.0, 5.0}, {42.0, 90.0, 10.0}, {200.0, -89.0, 4.0},
+                               {100.0, 30.0, 0.0}, {10.0, 20.0, 120.0}, {0.0, 0.0, 180.0}};
+    for (const auto& cone : cones) {
+        std::vector<std::size_t> expected;
+        for (std::size_t i = 0; i < n; i++) {
+            if (i != 7 && i != 9 && Star::angularDistance(cone[0], cone[1], ra[i], dec[i]) <= cone[2]) {
+                expected.push_back(i);
+            }
+        }
+        ASSERT_EQ(sorted(index.Cone(cone[0], cone[1], cone[2])), expected);
+    }
+
+    const double boxes[][4] = {{10.0, 30.0, -10.0, 20.0}, {350.0, 15.0, 60.0, 90.0}, {100.0, 320.0, -90.0, -70.0},
+                               {0.0, 360.0, -5.0, 5.0}, {200.0, 190.0, -30.0, 30.0}};
+    for (const auto& box : boxes) {
+        std::vector<std::size_t> expected;
+        for (std::size_t i = 0; i < n; i++) {
+            const bool inRa =
+                    box[0] <= box[1] ? ra[i] >= box[0] && ra[i] <= box[1] : ra[i] >= box[0] || ra[i] <= box[1];
+            if (i != 7 && i != 9 && inRa && dec[i] >= box[2] && dec[i] <= box[3]) {
+                expected.push_back(i);
+            }
+        }
+        ASSERT_EQ(sorted(index.Box(box[0], box[1], box[2], box[3])), expected);
+    }
+
+    for (const double point : {0.0, 0.5, 0.9}) {
+        const double qra = 360.0 * point, qdec = 80.0 * point;
+        std::vector<std::pair<double, std::size_t>> all;
+        for (std::size_t i = 0; i < n; i++) {
+            if (i != 7 && i != 9) {
+                all.emplace_back(Star::angularDistance(qra, qdec, ra[i], dec[i]), i);
+            }
+        }
+        std::sort(all.begin(), all.end());
+        const std::vector<std::size_t> nearest = index.Nearest(qra, qdec, 10);
+        ASSERT_EQ(nearest.size(), 10);
+        for (std::size_t k = 0; k < nearest.size(); k++) {
+            ASSERT_EQ(nearest[k], all[k].second);
+        }
+    }
+    ASSERT_EQ(index.Nearest(0.0, 0.0, 2 * n).size(), n - 2);
+}
+
+TEST(CrossMatcher, MatchesBruteForce)
+{
+    const std::size_t n1 = 3000, n2 = 2000;
+    std::vector<double> ra1(n1), dec1(n1), ra2(n2), dec2(n2);
+    std::uint64_t state = 777;
+    // a band around the north pole and across right ascension 0, dense enough for several matches per star
+    for (std::size_t i = 0; i < n2; i++) {
+        ra2[i]  = 360.0 * uniform(state);
+        dec2[i] = 60.0 + 30.0 * uniform(state);
+    }
+    for (std::size_t i = 0; i < n1; i++) {
+        ra1[i]  = i < n2 ? ra2[i] + 0.5 * (uniform(state) - 0.5) : 360.0 * uniform(state) - 180.0;
+        dec1[i] = i < n2 ? std::min(dec2[i] + 0.5 * (uniform(state) - 0.5), 90.0) : 60.0 + 30.0 * uniform(state);
+    }
+    dec1[3] = NAN;
+
+    const double radius = 2.0;
+    ThreadPool pool(4);
+    const CrossMatcher matcher(radius, pool);
+    const std::vector<CrossMatch> all  = matcher.All(ra1.data(), dec1.data(), n1, ra2.data(), dec2.data(), n2);
+    const std::vector<CrossMatch> best = matcher.Best(ra1.data(), dec1.data(), n1, ra2.data(), dec2.data(), n2);
+
+    std::size_t next = 0, nextBest = 0;
+    for (std::size_t i = 0; i < n1; i++) {
+        std::vector<std::pair<double, std::size_t>> expected;
+        for (std::size_t j = 0; i != 3 && j < n2; j++) {
+            const double separation = Star::angularDistance(ra1[i], dec1[i], ra2[j], dec2[j]);
+            if (separation <= radius - 1e-9) {
+                expected.emplace_back(separation, j);
+            } else if (separation <= radius + 1e-9) {
+                FAIL() << "star on the match circle";
+            }
+        }
+        std::sort(expected.begin(), expected.end());
+        for (const auto& [separation, j] : expected) {
+            ASSERT_LT(next, all.size());
+            ASSERT_EQ(all[next].first, i);
+            ASSERT_EQ(all[next].second, j);
+            ASSERT_NEAR(all[next].separation, separation, 1e-9);
+            next++;
+        }
+        if (!expected.empty()) {
+            ASSERT_EQ(best[nextBest].first, i);
+            ASSERT_EQ(best[nextBest].second, expected[0].second);
+            nextBest++;
+        }
+    }
+    ASSERT_EQ(next, all.size());
+    ASSERT_EQ(nextBest, best.size());
+    ASSERT_GT(all.size(), 10 * n1);
+}
+
+TEST(CrossMatcher, RadiusNotDividingZones)
+{
+    // 180 / 0.7 is not an integer, zones 180 / 258 high would be lower than radius and put the counterpart of a star
+    // just above a zone edge two zones below it
+    const double radius = 0.7;
+    const std::size_t n = 5000;
+    std::vector<double> ra(n), dec(n);
+    std::uint64_t state = 4242;
+    for (std::size_t i = 0; i < n; i++) {
+        ra[i]  = 360.0 * uniform(state);
+        dec[i] = -80.0 + 20.0 * uniform(state);
+    }
+    const double edge  = -90.0 + 200.0 * 180.0 / 258.0;
+    const double ra1[] = {100.0}, dec1[] = {edge + 0.0005};
+    ra[n / 2]  = 100.0;
+    dec[n / 2] = dec1[0] - 0.6995;
+
+    ThreadPool pool(2);
+    const CrossMatcher matcher(radius, pool);
+    const std::vector<CrossMatch> all = matcher.All(ra1, dec1, 1, ra.data(), dec.data(), n);
+    ASSERT_EQ(all.size(), 1);
+    ASSERT_EQ(all[0].second, n / 2);
+    ASSERT_NEAR(all[0].separation, 0.6995, 1e-9);
+    ASSERT_EQ(matcher.Best(ra1, dec1, 1, ra.data(), dec.data(), n).size(), 1);
+}
+
+TEST(EpochPropagator, MatchesLinearMotion)
+{
+    const std::size_t n = 1003;
+    StarCatalog catalog(n);
+    std::uint64_t state = 99;
+    for (std::size_t i = 0; i < n; i++) {
+        catalog.RightAscension()[i]  = 360.0 * uniform(state);
+        catalog.Declination()[i]     = std::asin(2.0 * uniform(state) - 1.0) * 180.0 / PI_NUMBER;
+        catalog.ProperMotionRa()[i]  = 20000.0 * (uniform(state) - 0.5);
+        catalog.ProperMotionDec()[i] = 20000.0 * (uniform(state) - 0.5);
+        catalog.Parallax()[i]        = i % 10 == 0 ? 0.0 : 0.01 + uniform(state);
+        catalog.RadialVelocity()[i]  = i % 7 == 0 ? INFINITY : 1e-3 * (uniform(state) - 0.5);
+        catalog.Vmagnitude()[i]      = 15.0 * uniform(state);
+        catalog.Bmagnitude()[i]      = catalog.Vmagnitude()[i] + 0.5;
+    }
+    // Barnard's star near the pole
+    catalog.RightAscension()[1]  = 12.0;
+    catalog.Declination()[1]     = 89.999;
+    catalog.ProperMotionRa()[1]  = -802.8;
+    catalog.ProperMotionDec()[1] = 10362.5;
+    catalog.Parallax()[1]        = 0.5469;
+    catalog.RadialVelocity()[1]  = -110.5 / 299792.458;
+
+    const double years       = 20000.0;
+    const StarCatalog before = catalog;
+    ThreadPool pool(4);
+    EpochPropagator(pool, 100).Propagate(catalog, years);
+
+    const double radian = PI_NUMBER / 180.0, mas = radian / 3600000.0;
+    for (std::size_t i = 0; i < n; i++) {
+        // position in parsecs and velocity in parsecs per year, stars of unknown distance at unit distance
+        const double ra = before.RightAscension()[i] * radian, dec = before.Declination()[i] * radian;
+        const double r[3] = {std::cos(dec) * std::cos(ra), std::cos(dec) * std::sin(ra), std::sin(dec)};
+        const double p[3] = {-std::sin(ra), std::cos(ra), 0.0};
+        const double q[3] = {-std::sin(dec) * std::cos(ra), -std::sin(dec) * std::sin(ra), std::cos(dec)};
+        const bool known  = before.Parallax()[i] > 0.0;
+        const double d0   = known ? 1.0 / before.Parallax()[i] : 1.0;
+        const double rv   = known && std::isfinite(before.RadialVelocity()[i]) ? before.RadialVelocity()[i] : 0.0;
+        double x[3], v[3];
+        for (int k = 0; k < 3; k++) {
+            v[k] = d0 * mas * (p[k] * before.ProperMotionRa()[i] + q[k] * before.ProperMotionDec()[i]) +
+                   r[k] * rv / LIGHT_YEARS_PER_PARSEC;
+            x[k] = r[k] * d0 + v[k] * years;
+        }
+        const double d1   = std::sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+        const double ra1  = std::atan2(x[1], x[0]);
+        const double dec1 = std::asin(x[2] / d1);
+        const double p1[3] = {-std::sin(ra1), std::cos(ra1), 0.0};
+        const double q1[3] = {-std::sin(dec1) * std::cos(ra1), -std::sin(dec1) * std::sin(ra1), std::cos(dec1)};
+        const double pmra  = (v[0] * p1[0] + v[1] * p1[1]) / d1 / mas;
+        const double pmdec = (v[0] * q1[0] + v[1] * q1[1] + v[2] * q1[2]) / d1 / mas;
+
+        ASSERT_NEAR(Star::angularDistance(catalog.RightAscension()[i], catalog.Declination()[i], ra1 / radian,
+                                          dec1 / radian),
+                    0.0, 1e-9);
+        ASSERT_NEAR(catalog.ProperMotionRa()[i], pmra, 1e-6 * std::max(1.0, std::fabs(pmra)));
+        ASSERT_NEAR(catalog.ProperMotionDec()[i], pmdec, 1e-6 * std::max(1.0, std::fabs(pmdec)));
+        if (known) {
+            const double mv = Star::apparentMagnitude(Star::absoluteMagnitude(before.Vmagnitude()[i], d0), d1);
+            ASSERT_NEAR(catalog.Parallax()[i], 1.0 / d1, 1e-12);
+            ASSERT_NEAR(catalog.Vmagnitude()[i], mv, 1e-12);
+            ASSERT_NEAR(catalog.Bmagnitude()[i] - catalog.Vmagnitude()[i], 0.5, 1e-12);
+        } else {
+            ASSERT_EQ(catalog.Parallax()[i], 0.0);
+            ASSERT_EQ(catalog.Vmagnitude()[i], before.Vmagnitude()[i]);
+        }
+        if (known && std::isfinite(before.RadialVelocity()[i])) {
+            const double radial = (v[0] * x[0] + v[1] * x[1] + v[2] * x[2]) / d1 * LIGHT_YEARS_PER_PARSEC;
+            ASSERT_NEAR(catalog.RadialVelocity()[i], radial, 1e-15);
+        } else {
+            ASSERT_EQ(catalog.RadialVelocity()[i], before.RadialVelocity()[i]);
+        }
+    }
+}
+
+TEST(HrDiagram, MatchesScalarBinning)
+{
+    const std::size_t n = 6000;
+    StarCatalog catalog(n), first(n / 2), second(n - n / 2);
+    std::vector<double> weight(n);
+    for (std::size_t i = 0; i < n; i++) {
+        catalog.Vmagnitude()[i]      = -1.0 + 0.003 * i;
+        catalog.Bmagnitude()[i]      = catalog.Vmagnitude()[i] + 0.37 * (i % 7) - 0.35;
+        catalog.Parallax()[i]        = i % 50 == 0 ? 0.0 : (i % 13 + 1) * 0.004;
+        catalog.LuminosityClass()[i] = static_cast<int>(i % 10) + 1;
+        weight[i]                    = 0.5 + 0.25 * (i % 3);
+        StarCatalog& half            = i < n / 2 ? first : second;
+        const std::size_t j          = i < n / 2 ? i : i - n / 2;
+        half.Vmagnitude()[j]         = catalog.Vmagnitude()[i];
+        half.Bmagnitude()[j]         = catalog.Bmagnitude()[i];
+        half.Parallax()[j]           = catalog.Parallax()[i];
+        half.LuminosityClass()[j]    = catalog.LuminosityClass()[i];
+    }
+
+    const HrAxis axes[][2] = {
+            {{HrAxis::Temperature, 40000.0, 2000.0, 37, true}, {HrAxis::Luminosity, 1e-4, 1e6, 29, true}},
+            {{HrAxis::ColorIndex, -0.5, 2.0, 25, false}, {HrAxis::AbsoluteMagnitude, 16.0, -10.0, 52, false}},
+    };
+    ThreadPool pool(3);
+    for (const auto& [x, y] : axes) {
+        for (int weighted = 0; weighted < 2; weighted++) {
+            std::vector<double> expected(x.bins * y.bins, 0.0);
+            double dropped = 0.0;
+            for (std::size_t i = 0; i < n; i++) {
+                const double bmv = catalog.Bmagnitude()[i] - catalog.Vmagnitude()[i];
+                const double t   = Star::colorTemperature(bmv, catalog.LuminosityClass()[i]);
+                const double m   = Star::absoluteMagnitude(catalog.Vmagnitude()[i],
+                                                           catalog.Parallax()[i] > 0.0 ? 1 / catalog.Parallax()[i]
+                                                                                       : INFINITY);
+                const double l   = Star::luminosity(m, Star::bolometricCorrection(t));
+                const double values[] = {bmv, t, m, l};
+                const auto bin        = [&values](const HrAxis& axis) {
+                    const double v  = values[axis.quantity];
+                    const double lo = axis.logarithmic ? std::log10(axis.min) : axis.min;
+                    const double hi = axis.logarithmic ? std::log10(axis.max) : axis.max;
+                    return ((axis.logarithmic ? std::log10(v) : v) - lo) / (hi - lo) * static_cast<double>(axis.bins);
+                };
+                const double w  = weighted ? weight[i] : 1.0;
+                const double bx = bin(x), by = bin(y);
+                if (bx >= 0.0 && bx < static_cast<double>(x.bins) && by >= 0.0 && by < static_cast<double>(y.bins)) {
+                    expected[static_cast<std::size_t>(by) * x.bins + static_cast<std::size_t>(bx)] += w;
+                } else {
+                    dropped += w;
+                }
+            }
+
+            HrDiagram whole(x, y, pool, 700), halves(x, y, pool, 700);
+            whole.Add(catalog, weighted ? weight.data() : nullptr);
+            halves.Add(first, weighted ? weight.data() : nullptr);
+            halves.Add(second, weighted ? weight.data() + n / 2 : nullptr);
+            for (std::size_t cell = 0; cell < expected.size(); cell++) {
+                ASSERT_DOUBLE_EQ(whole.Counts()[cell], expected[cell]);
+                ASSERT_DOUBLE_EQ(halves.Counts()[cell], expected[cell]);
+            }
+            ASSERT_DOUBLE_EQ(whole.Dropped(), dropped);
+            ASSERT_DOUBLE_EQ(halves.Dropped(), dropped);
+            ASSERT_GT(dropped, 0.0);
+            ASSERT_GT(whole.Count(x.bins / 2, y.bins / 2) + whole.Count(x.bins / 3, y.bins / 2), 0.0);
+
+            whole.Clear();
+            ASSERT_EQ(whole.Dropped(), 0.0);
+            ASSERT_EQ(*std::max_element(whole.Counts().begin(), whole.Counts().end()), 0.0);
+        }
+    }
+}
+
+TEST(Instrument, CountsCallsAndSegments)
+{
+    Instrument::Reset();
+    const double temperatures[] = {30000.0, 6000.0, 3000.0, 4000.0};
+    for (const double temperature : temperatures) {
+        Star::bolometricCorrection(temperature);
+    }
+    double bc[4];
+    StarBatch::bolometricCorrection(temperatures, bc, 4);
+    int spectype, lumclass;
+    Star::parseSpectrum("gK0", spectype, lumclass);
+    Star::parseSpectrum("G2V", spectype, lumclass);
+    Star::parseSpectrum("K5", spectype, lumclass);
+    Star::parseSpectrum("", spectype, lumclass);
+
+    ThreadPool pool(4);
+    pool.ParallelFor(0, 1000, 10, [](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            Star::absoluteMagnitude(10.0, i % 4 ? 10.0 : 0.0);
+        }
+    });
+
+    const Instrument::Snapshot snapshot = Instrument::Collect();
+    if (!Instrument::Enabled()) {
+        ASSERT_EQ(snapshot.probes[Instrument::StarBolometricCorrection].calls, 0U);
+        ASSERT_EQ(snapshot.segments[Instrument::BolometricCorrectionCool], 0U);
+        return;
+    }
+    ASSERT_EQ(snapshot.probes[Instrument::StarBolometricCorrection].calls, 4U);
+    ASSERT_EQ(snapshot.probes[Instrument::BatchBolometricCorrection].calls, 1U);
+    ASSERT_EQ(snapshot.probes[Instrument::BatchBolometricCorrection].elements, 4U);
+    ASSERT_EQ(snapshot.segments[Instrument::BolometricCorrectionHot], 2U);
+    ASSERT_EQ(snapshot.segments[Instrument::BolometricCorrectionWarm], 2U);
+    ASSERT_EQ(snapshot.segments[Instrument::BolometricCorrectionCool], 4U);
+    ASSERT_EQ(snapshot.probes[Instrument::StarParseSpectrum].calls, 4U);
+    ASSERT_EQ(snapshot.segments[Instrument::SpectrumPrefixClass], 1U);
+    ASSERT_EQ(snapshot.segments[Instrument::SpectrumRomanClass], 1U);
+    ASSERT_EQ(snapshot.segments[Instrument::SpectrumNoType], 1U);
+    ASSERT_EQ(snapshot.segments[Instrument::SpectrumNoClass], 2U);
+    ASSERT_EQ(snapshot.probes[Instrument::StarAbsoluteMagnitude].calls, 1000U);
+    ASSERT_EQ(snapshot.segments[Instrument::UnknownDistance], 250U);
+    ASSERT_GT(snapshot.probes[Instrument::StarAbsoluteMagnitude].nanoseconds, 0U);
+    const auto timed = [&snapshot](const Instrument::Probe probe) {
+        const std::uint64_t* latency = snapshot.probes[probe].latency;
+        return std::accumulate(latency, latency + Instrument::LATENCY_BUCKETS, std::uint64_t{0});
+    };
+    ASSERT_EQ(timed(Instrument::BatchBolometricCorrection), 1U);
+    ASSERT_GE(timed(Instrument::StarAbsoluteMagnitude), 1000U / 16);
+    ASSERT_LT(timed(Instrument::StarAbsoluteMagnitude), 1000U);
+    ASSERT_NE(snapshot.Text().find("latency ns"), std::string::npos);
+    ASSERT_NE(snapshot.Json().find("\"latency\": ["), std::string::npos);
+    ASSERT_NE(snapshot.Text().find("Star::parseSpectrum"), std::string::npos);
+    ASSERT_NE(snapshot.Json().find("\"bolometricCorrection.cool\": 4"), std::string::npos);
+
+    Instrument::Reset();
+    ASSERT_EQ(Instrument::Collect().probes[Instrument::StarAbsoluteMagnitude].calls, 0U);
+}
+
+TEST(Instrument, BatchSegmentsMatchBranches)
+{
+    // temperatures a few doubles around both breaks, where 10^3.7 and 10^3.9 round
+    std::vector<double> temperatures;
+    for (const double bound : {3.7, 3.9}) {
+        double t = std::pow(10.0, bound);
+        for (int k = 0; k < 8; k++) {
+            t = std::nextafter(t, 0.0);
+        }
+        for (int k = 0; k < 17; k++, t = std::nextafter(t, INFINITY)) {
+            temperatures.push_back(t);
+        }
+    }
+    std::vector<double> bc(temperatures.size());
+
+    Instrument::Reset();
+    for (const double temperature : temperatures) {
+        Star::bolometricCorrection(temperature);
+    }
+    const Instrument::Snapshot scalar = Instrument::Collect();
+    Instrument::Reset();
+    StarBatch::bolometricCorrection(temperatures.data(), bc.data(), temperatures.size());
+    const Instrument::Snapshot batch = Instrument::Collect();
+    if (!Instrument::Enabled()) {
+        return;
+    }
+    for (const Instrument::Segment segment : {Instrument::BolometricCorrectionHot, Instrument::BolometricCorrectionWarm,
+                                              Instrument::BolometricCorrectionCool}) {
+        ASSERT_GT(scalar.segments[segment], 0U) << Instrument::Name(segment);
+        ASSERT_EQ(batch.segments[segment], scalar.segments[segment]) << Instrument::Name(segment);
+    }
+}
+
+TEST(DerivedCache, RecomputesMarkedStars)
+{
+    const std::size_t n = 3000;
+    StarCatalog catalog(n);
+    for (std::size_t i = 0; i < n; i++) {
+        catalog.Radius()[i]                 = 5e8 + 1e6 * i;
+        catalog.PhotosphereTemperature()[i] = 2500.0 + 9.0 * i;
+        catalog.Vmagnitude()[i]             = -1.0 + 0.005 * i;
+        catalog.Bmagnitude()[i]             = catalog.Vmagnitude()[i] + 0.37 * (i % 7) - 0.35;
+        catalog.Parallax()[i]               = i % 50 == 0 ? 0.0 : (i % 13 + 1) * 0.004;
+        catalog.LuminosityClass()[i]        = static_cast<int>(i % 10) + 1;
+    }
+    DerivedCache cache(catalog);
+    const auto check = [&](const std::size_t i) {
+        const double temp     = catalog.PhotosphereTemperature()[i];
+        const double bc       = Star::bolometricCorrection(temp);
+        const double parallax = catalog.Parallax()[i];
+        const double mv = Star::absoluteMagnitude(catalog.Vmagnitude()[i], parallax > 0.0 ? 1.0 / parallax : INFINITY);
+        const double radius   = Star::radius(Star::luminosity(mv, bc), temp);
+        const double ct = Star::colorTemperature(catalog.Bmagnitude()[i] - catalog.Vmagnitude()[i],
+                                                 catalog.LuminosityClass()[i]);
+        const double lum = StarMath::Luminosity(catalog.Radius()[i], temp);
+        ASSERT_NEAR(cache.Get(DerivedCache::Luminosity, i), lum, 1e-14 * lum) << i;
+        ASSERT_NEAR(cache.Get(DerivedCache::BolometricCorrection, i), bc, 5e-9) << i;
+        ASSERT_NEAR(cache.Get(DerivedCache::ColorTemperature, i), ct, 1e-12 * ct) << i;
+        const double r = cache.Get(DerivedCache::Radius, i);
+        ASSERT_TRUE(r == radius || std::fabs(r - radius) <= 1e-8 * radius) << i;
+    };
+    const auto recomputed = [&cache]() {
+        std::vector<std::size_t> counts;
+        for (int column = 0; column < DerivedCache::ColumnCount; column++) {
+            counts.push_back(cache.Recomputed(static_cast<DerivedCache::Column>(column)));
+        }
+        return counts;
+    };
+
+    for (std::size_t i = 0; i < n; i++) {
+        check(i);
+    }
+    ASSERT_EQ(recomputed(), std::vector<std::size_t>(DerivedCache::ColumnCount, n));
+
+    // every setter marks the columns depending on its input only
+    cache.SetRadius(5, 7e8);
+    cache.SetMass(6, 2e30);
+    ASSERT_EQ(recomputed(), std::vector<std::size_t>({n, n, n, n}));
+    check(5);
+    ASSERT_EQ(recomputed(), std::vector<std::size_t>({n + 1, n, n, n}));
+    cache.SetPhotosphereTemperature(7, 30000);
+    cache.SetPhotosphereTemperature(7, 31000);
+    cache.Get(DerivedCache::Radius);
+    ASSERT_EQ(recomputed(), std::vector<std::size_t>({n + 1, n + 1, n, n + 1}));
+    check(7);
+    ASSERT_EQ(recomputed(), std::vector<std::size_t>({n + 2, n + 1, n, n + 1}));
+    cache.SetBmagnitude(8, 3);
+    cache.SetVmagnitude(9, catalog.Vmagnitude()[9] - 0.2);
+    cache.SetParallax(10, 0.1);
+    cache.SetLuminosityClass(11, 3);
+    for (std::size_t i = 8; i < 12; i++) {
+        check(i);
+    }
+    ASSERT_EQ(recomputed(), std::vector<std::size_t>({n + 2, n + 1, n + 3, n + 3}));
+
+    // appended stars are computed on the next read, many marked stars recompute the whole column
+    Star star;
+    star.SetRadius(6e8);
+    star.SetPhotosphereTemperature(5800);
+    star.SetParallax(0.2);
+    catalog.Add(star);
+    check(n);
+    ASSERT_EQ(recomputed(), std::vector<std::size_t>({n + 3, n + 2, n + 4, n + 4}));
+    for (std::size_t i = 0; i < n / 2; i++) {
+        cache.SetRadius(i, 6e8 + i);
+    }
+    check(n / 3);
+    ASSERT_EQ(cache.Recomputed(DerivedCache::Luminosity), 2 * n + 4);
+    catalog.Radius()[12] = 1e9;
+    cache.Invalidate(12);
+    check(12);
+    catalog.Resize(n / 2);
+    cache.Invalidate();
+    check(n / 2 - 1);
+    ASSERT_EQ(cache.Recomputed(DerivedCache::ColorTemperature), n + 5 + n / 2);
+}
+
+TEST(SpectrumDictionary, InternsConcurrently)
+{
+    SpectrumDictionary dictionary;
+    ASSERT_EQ(dictionary.Intern(""), SpectrumDictionary::EMPTY);
+    ASSERT_EQ(dictionary.Size(), 1U);
+
+    std::vector<std::string> spectra = {"dG2", "sdK5", "DA3", "gK0", "WN7"};
+    for (const char letter : std::string("OBAFGKM")) {
+        for (char digit = '0'; digit <= '9'; digit++) {
+            for (const char* lumclass : {"", "V", "III", "Ib", "IV-V", "Iab"}) {
+                spectra.push_back(std::string{letter, digit} + lumclass);
+            }
+        }
+    }
+    const std::size_t n = 200000;
+    std::vector<SpectrumDictionary::Id> ids(n);
+    ThreadPool pool(4);
+    pool.ParallelFor(0, n, 1000, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            ids[i] = dictionary.Intern(spectra[i * 7919 % spectra.size()]);
+        }
+    });
+    ASSERT_EQ(dictionary.Size(), spectra.size() + 1);
+
+    for (std::size_t i = 0; i < n; i++) {
+        const std::string& spectrum = spectra[i * 7919 % spectra.size()];
+        ASSERT_EQ(ids[i], ids[i % spectra.size()]) << spectrum;
+        ASSERT_EQ(dictionary.Spectrum(ids[i]), spectrum);
+        int spectype, lumclass;
+        ASSERT_EQ(dictionary.Parsed(ids[i]), Star::parseSpectrum(spectrum, spectype, lumclass));
+        ASSERT_EQ(dictionary.SpectralType(ids[i]), spectype) << spectrum;
+        ASSERT_EQ(dictionary.LuminosityClass(ids[i]), lumclass) << spectrum;
+        ASSERT_EQ(dictionary.Formatted(ids[i]), Star::formatSpectrum(spectype, lumclass)) << spectrum;
+    }
+    ASSERT_EQ(dictionary.Formatted(dictionary.Intern("dG2")), "G2V");
+    ASSERT_EQ(dictionary.Format(Star::SpecType::G0 + 2, Star::LumClass::V), dictionary.Intern("G2V"));
+    ASSERT_EQ(dictionary.Spectrum(dictionary.Format(Star::SpecType::K0 + 3, Star::LumClass::III)), "K3III");
+    ASSERT_EQ(dictionary.Spectrum(dictionary.Format(-5, 99)), Star::formatSpectrum(-5, 99));
+
+    Star star;
+    ASSERT_EQ(star.GetSpectrum(), "");
+    star.SetSpectrum("K3III");
+    ASSERT_EQ(star.GetSpectrumId(), SpectrumDictionary::Default().Intern("K3III"));
+    ASSERT_EQ(star.GetSpectrum(), "K3III");
+
+    // ids never handed out are rejected, whether or not their chunk exists
+    ASSERT_FALSE(dictionary.Contains(static_cast<SpectrumDictionary::Id>(dictionary.Size())));
+    ASSERT_FALSE(dictionary.Contains(5000000));
+    ASSERT_THROW((void)dictionary.Spectrum(5000000), std::out_of_range);
+    ASSERT_THROW((void)dictionary.Formatted(static_cast<SpectrumDictionary::Id>(dictionary.Size())), std::out_of_range);
+    ASSERT_THROW(star.SetSpectrumId(5000000), std::out_of_range);
+    ASSERT_EQ(star.GetSpectrum(), "K3III");
+}
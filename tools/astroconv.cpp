@@ -0,0 +1,30 @@
+#include <cstdio>
+#include <exception>
+#include "catalog.h"
+#include "catalogfile.h"
+#include "catalogreader.h"
+
+/**
+ * Converts comma separated text star catalog to binary catalog file. Every line holds mass, radius, photosphere
+ * temperature, parallax, radial velocity, V magnitude, B magnitude and spectral class string, empty lines and lines
+ * starting with # are skipped.
+ */
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        std::fprintf(stderr, "usage: %s <catalog.csv> <catalog.astrocat>\n", argv[0]);
+        return 2;
+    }
+
+    try {
+        StarCatalog catalog;
+        const CatalogReader::Stats stats = CatalogReader().Read(argv[1], catalog);
+        CatalogFile::Write(catalog, argv[2]);
+        std::printf("%zu stars read in %.3f s (%.0f rows/s), %zu malformed lines skipped\n", stats.rows,
+                    stats.seconds, stats.RowsPerSecond(), stats.malformed);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}